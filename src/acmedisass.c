@@ -1,442 +1,60 @@
 #include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
 #include <libgen.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include "acmedisass.h"
 
-enum {
-    NONE,
-    ACC,
-    IMP,
-    IMM,
-    ZP,
-    ZPX,
-    ZPY,
-    ABS,
-    ABSX,
-    ABSY,
-    ABSI,
-    INDX,
-    INDY,
-    REL
-}; // addressing modes
-
-enum {
-    MODE6502,
-    MODE6510
-}; // cpu modes (6510 includes 'illegal' opcodes)
-
-opcode opcodes[] = {
-    [0x69]{ "adc", 2, 2, IMM },
-    [0x65]{ "adc", 2, 3, ZP },
-    [0x75]{ "adc", 2, 4, ZPX },
-    [0x6D]{ "adc", 3, 4, ABS },
-    [0x7D]{ "adc", 3, 4, ABSX },
-    [0x79]{ "adc", 3, 4, ABSY },
-    [0x61]{ "adc", 2, 6, INDX },
-    [0x71]{ "adc", 2, 5, INDY },
-
-    [0x0B]{ "anc", 2, 2, IMM },
-    [0x2B]{ "anc", 2, 2, IMM },
-
-    [0x29]{ "and", 2, 2, IMM },
-    [0x25]{ "and", 2, 3, ZP },
-    [0x35]{ "and", 2, 4, ZPX },
-    [0x2D]{ "and", 3, 4, ABS },
-    [0x3D]{ "and", 3, 4, ABSX },
-    [0x39]{ "and", 3, 4, ABSY },
-    [0x21]{ "and", 2, 6, INDX },
-    [0x31]{ "and", 2, 5, INDY },
-
-    [0x8B]{ "ane", 2, 2, IMM },
-
-    [0x6B]{ "arr", 2, 2, IMM },
-
-    [0x4B]{ "asr", 2, 2, IMM },
-
-    [0x0A]{ "asl", 1, 2, ACC },
-    [0x06]{ "asl", 2, 5, ZP },
-    [0x16]{ "asl", 2, 6, ZPX },
-    [0x0E]{ "asl", 3, 6, ABS },
-    [0x1E]{ "asl", 3, 7, ABSX },
-
-    [0x90]{ "bcc", 2, 2, REL },
-
-    [0xB0]{ "bcs", 2, 2, REL },
-
-    [0xF0]{ "beq", 2, 2, REL },
-
-    [0x24]{ "bit", 2, 3, ZP },
-    [0x2C]{ "bit", 3, 4, ABS },
-
-    [0x30]{ "bmi", 2, 2, REL },
-
-    [0xD0]{ "bne", 2, 2, REL },
-
-    [0x10]{ "bpl", 2, 2, REL },
-
-    [0x00]{ "brk", 1, 7, IMP },
-
-    [0x50]{ "bvc", 2, 2, REL },
-
-    [0x70]{ "bvs", 2, 2, REL },
-
-    [0x18]{ "clc", 1, 2, IMP },
-
-    [0xD8]{ "cld", 1, 2, IMP },
-
-    [0x58]{ "cli", 1, 2, IMP },
-
-    [0xB8]{ "clv", 1, 2, IMP },
-
-    [0xC9]{ "cmp", 2, 2, IMM },
-    [0xC5]{ "cmp", 2, 3, ZP },
-    [0xD5]{ "cmp", 2, 4, ZPX },
-    [0xCD]{ "cmp", 3, 4, ABS },
-    [0xDD]{ "cmp", 3, 4, ABSX },
-    [0xD9]{ "cmp", 3, 4, ABSY },
-    [0xC1]{ "cmp", 2, 6, INDX },
-    [0xD1]{ "cmp", 2, 5, INDY },
-
-    [0xE0]{ "cpx", 2, 2, IMM },
-    [0xE4]{ "cpx", 2, 3, ZP },
-    [0xEC]{ "cpx", 3, 4, ABS },
-
-    [0xC0]{ "cpy", 2, 2, IMM },
-    [0xC4]{ "cpy", 2, 3, ZP },
-    [0xCC]{ "cpy", 3, 4, ABS },
-
-    [0xC7]{ "dcp", 2, 5, ZP },
-    [0xD7]{ "dcp", 2, 6, ZPX },
-    [0xCF]{ "dcp", 3, 6, ABS },
-    [0xDF]{ "dcp", 3, 7, ABSX },
-    [0xDB]{ "dcp", 3, 7, ABSY },
-    [0xC3]{ "dcp", 2, 8, INDX },
-    [0xD3]{ "dcp", 2, 8, INDY },
-
-    [0xC6]{ "dec", 2, 5, ZP },
-    [0xD6]{ "dec", 2, 6, ZPX },
-    [0xCE]{ "dec", 3, 6, ABS },
-    [0xDE]{ "dec", 3, 7, ABSX },
-
-    [0xCA]{ "dex", 1, 2, IMP },
-
-    [0x88]{ "dey", 1, 2, IMP },
-
-    [0x49]{ "eor", 2, 2, IMM },
-    [0x45]{ "eor", 2, 3, ZP },
-    [0x55]{ "eor", 2, 4, ZPX },
-    [0x4D]{ "eor", 3, 4, ABS },
-    [0x5D]{ "eor", 3, 4, ABSX },
-    [0x59]{ "eor", 3, 4, ABSY },
-    [0x41]{ "eor", 2, 6, INDX },
-    [0x51]{ "eor", 2, 5, INDY },
-
-    [0xE6]{ "inc", 2, 5, ZP },
-    [0xF6]{ "inc", 2, 6, ZPX },
-    [0xEE]{ "inc", 3, 6, ABS },
-    [0xFE]{ "inc", 3, 7, ABSX },
-
-    [0xE8]{ "inx", 1, 2, IMP },
-
-    [0xC8]{ "iny", 1, 2, IMP },
-
-    [0xE7]{ "isb", 2, 5, ZP },
-    [0xF7]{ "isb", 2, 6, ZPX },
-    [0xEF]{ "isb", 3, 6, ABS },
-    [0xFF]{ "isb", 3, 7, ABSX },
-    [0xFB]{ "isb", 3, 7, ABSY },
-    [0xE3]{ "isb", 2, 8, INDX },
-    [0xF3]{ "isb", 2, 8, INDY },
-
-    [0x02]{ "jam", 1, 0, IMP },
-    [0x12]{ "jam", 1, 0, IMP },
-    [0x22]{ "jam", 1, 0, IMP },
-    [0x32]{ "jam", 1, 0, IMP },
-    [0x42]{ "jam", 1, 0, IMP },
-    [0x52]{ "jam", 1, 0, IMP },
-    [0x62]{ "jam", 1, 0, IMP },
-    [0x72]{ "jam", 1, 0, IMP },
-    [0x92]{ "jam", 1, 0, IMP },
-    [0xB2]{ "jam", 1, 0, IMP },
-    [0xD2]{ "jam", 1, 0, IMP },
-    [0xF2]{ "jam", 1, 0, IMP },
-
-    [0x4C]{ "jmp", 3, 3, ABS },
-    [0x6C]{ "jmp", 3, 5, ABSI },
-
-    [0x20]{ "jsr", 3, 6, ABS },
-
-    [0xBB]{ "lae", 3, 4, ABSY },
-
-    [0xA7]{ "lax", 2, 3, ZP },
-    [0xB7]{ "lax", 2, 4, ZPY },
-    [0xAF]{ "lax", 3, 4, ABS },
-    [0xBF]{ "lax", 3, 4, ABSY },
-    [0xA3]{ "lax", 2, 6, INDX },
-    [0xB3]{ "lax", 2, 5, ABS },
-
-    [0xA9]{ "lda", 2, 2, IMM },
-    [0xA5]{ "lda", 2, 3, ZP },
-    [0xB5]{ "lda", 2, 4, ZPX },
-    [0xAD]{ "lda", 3, 4, ABS },
-    [0xBD]{ "lda", 3, 4, ABSX },
-    [0xB9]{ "lda", 3, 4, ABSY },
-    [0xA1]{ "lda", 2, 6, INDX },
-    [0xB1]{ "lda", 2, 5, INDY },
-
-    [0xA2]{ "ldx", 2, 2, IMM },
-    [0xA6]{ "ldx", 2, 3, ZP },
-    [0xB6]{ "ldx", 2, 4, ZPY },
-    [0xAE]{ "ldx", 3, 4, ABS },
-    [0xBE]{ "ldx", 3, 4, ABSY },
-
-    [0xA0]{ "ldy", 2, 2, IMM },
-    [0xA4]{ "ldy", 2, 3, ZP },
-    [0xB4]{ "ldy", 2, 4, ZPX },
-    [0xAC]{ "ldy", 3, 4, ABS },
-    [0xBC]{ "ldy", 3, 4, ABSX },
-
-    [0x4A]{ "lsr", 1, 2, ACC },
-    [0x46]{ "lsr", 2, 5, ZP },
-    [0x56]{ "lsr", 2, 6, ZPX },
-    [0x4E]{ "lsr", 3, 6, ABS },
-    [0x5E]{ "lsr", 3, 7, ABSX },
-
-    [0xAB]{ "lxa", 2, 2, IMM },
-
-    [0xEA]{ "nop", 1, 2, IMP },
-    [0x1A]{ "nop", 1, 2, IMP },
-    [0x3A]{ "nop", 1, 2, IMP },
-    [0x5A]{ "nop", 1, 2, IMP },
-    [0x7A]{ "nop", 1, 2, IMP },
-    [0xDA]{ "nop", 1, 2, IMP },
-    [0xFA]{ "nop", 1, 2, IMP },
-    [0x80]{ "nop", 2, 2, IMM },
-    [0x82]{ "nop", 2, 2, IMM },
-    [0x89]{ "nop", 2, 2, IMM },
-    [0xC2]{ "nop", 2, 2, IMM },
-    [0xE2]{ "nop", 2, 2, IMM },
-    [0x04]{ "nop", 2, 3, ZP },
-    [0x44]{ "nop", 2, 3, ZP },
-    [0x64]{ "nop", 2, 3, ZP },
-    [0x14]{ "nop", 2, 4, ZPX },
-    [0x34]{ "nop", 2, 4, ZPX },
-    [0x54]{ "nop", 2, 4, ZPX },
-    [0x74]{ "nop", 2, 4, ZPX },
-    [0xD4]{ "nop", 2, 4, ZPX },
-    [0xF4]{ "nop", 2, 4, ZPX },
-    [0x0C]{ "nop", 3, 4, ABS },
-    [0x1C]{ "nop", 3, 4, ABSX },
-    [0x3C]{ "nop", 3, 4, ABSX },
-    [0x5C]{ "nop", 3, 4, ABSX },
-    [0x7C]{ "nop", 3, 4, ABSX },
-    [0xDC]{ "nop", 3, 4, ABSX },
-    [0xFC]{ "nop", 3, 4, ABSX },
-
-    [0x09]{ "ora", 2, 2, IMM },
-    [0x05]{ "ora", 2, 3, ZP },
-    [0x15]{ "ora", 2, 4, ZPX },
-    [0x0D]{ "ora", 3, 4, ABS },
-    [0x1D]{ "ora", 3, 4, ABSX },
-    [0x19]{ "ora", 3, 4, ABSY },
-    [0x01]{ "ora", 2, 6, INDX },
-    [0x11]{ "ora", 2, 5, INDY },
-
-    [0x48]{ "pha", 1, 3, IMP },
-
-    [0x08]{ "php", 1, 3, IMP },
-
-    [0x68]{ "pla", 1, 4, IMP },
-
-    [0x28]{ "plp", 1, 4, IMP },
-
-    [0x27]{ "rla", 2, 5, ZP },
-    [0x37]{ "rla", 2, 6, ZPX },
-    [0x2F]{ "rla", 3, 6, ABS },
-    [0x3F]{ "rla", 3, 7, ABSX },
-    [0x3B]{ "rla", 3, 7, ABSY },
-    [0x23]{ "rla", 2, 8, INDX },
-    [0x33]{ "rla", 2, 8, INDY },
-
-    [0x2A]{ "rol", 1, 2, ACC },
-    [0x26]{ "rol", 2, 5, ZP },
-    [0x36]{ "rol", 2, 6, ZPX },
-    [0x2E]{ "rol", 3, 6, ABS },
-    [0x3E]{ "rol", 3, 7, ABSX },
-
-    [0x6A]{ "ror", 1, 2, ACC },
-    [0x66]{ "ror", 2, 5, ZP },
-    [0x76]{ "ror", 2, 6, ZPX },
-    [0x6E]{ "ror", 3, 6, ABS },
-    [0x7E]{ "ror", 3, 7, ABSX },
-
-    [0x67]{ "rra", 2, 5, ZP },
-    [0x77]{ "rra", 2, 6, ZPX },
-    [0x6F]{ "rra", 3, 6, ABS },
-    [0x7F]{ "rra", 3, 7, ABSX },
-    [0x7B]{ "rra", 3, 7, ABSY },
-    [0x63]{ "rra", 2, 8, INDX },
-    [0x73]{ "rra", 2, 8, INDY },
-
-    [0x40]{ "rti", 1, 6, IMP },
-
-    [0x60]{ "rts", 1, 6, IMP },
-
-    [0x87]{ "sax", 2, 3, ZP },
-    [0x97]{ "sax", 2, 4, ZPY },
-    [0x8F]{ "sax", 3, 4, ABS },
-    [0x83]{ "sax", 2, 6, INDX },
-
-    [0xE9]{ "sbc", 2, 2, IMM },
-    [0xE5]{ "sbc", 2, 3, ZP },
-    [0xF5]{ "sbc", 2, 4, ZPX },
-    [0xED]{ "sbc", 3, 4, ABS },
-    [0xFD]{ "sbc", 3, 4, ABSX },
-    [0xF9]{ "sbc", 3, 4, ABSY },
-    [0xE1]{ "sbc", 2, 6, INDX },
-    [0xF1]{ "sbc", 2, 5, INDY },
-
-    [0xEB]{ "sbc", 2, 2, IMM },
-
-    [0xCB]{ "sbx", 2, 2, IMM },
-
-    [0x38]{ "sec", 1, 2, IMP },
-
-    [0xF8]{ "sed", 1, 2, IMP },
-
-    [0x78]{ "sei", 1, 2, IMP },
-
-    [0x93]{ "sha", 3, 5, ABSX },
-    [0x9F]{ "sha", 3, 5, ABSY },
-
-    [0x9B]{ "shs", 3, 5, ABSY },
-
-    [0x9E]{ "shx", 3, 5, ABSY },
-
-    [0x9C]{ "shy", 3, 5, ABSX },
-
-    [0x07]{ "slo", 2, 5, ZP },
-    [0x17]{ "slo", 2, 6, ZPX },
-    [0x0F]{ "slo", 3, 6, ABS },
-    [0x1F]{ "slo", 3, 7, ABSX },
-    [0x1B]{ "slo", 3, 7, ABSY },
-    [0x03]{ "slo", 2, 8, INDX },
-    [0x13]{ "slo", 2, 8, INDY },
-
-    [0x47]{ "sre", 2, 5, ZP },
-    [0x57]{ "sre", 2, 6, ZPX },
-    [0x4F]{ "sre", 3, 6, ABS },
-    [0x5F]{ "sre", 3, 7, ABSX },
-    [0x5B]{ "sre", 3, 7, ABSY },
-    [0x43]{ "sre", 2, 8, INDX },
-    [0x53]{ "sre", 2, 8, INDY },
-
-    [0x85]{ "sta", 2, 3, ZP },
-    [0x95]{ "sta", 2, 4, ZPX },
-    [0x8D]{ "sta", 3, 4, ABS },
-    [0x9D]{ "sta", 3, 4, ABSX },
-    [0x99]{ "sta", 3, 4, ABSY },
-    [0x81]{ "sta", 2, 6, INDX },
-    [0x91]{ "sta", 2, 5, INDY },
-
-    [0x86]{ "stx", 2, 3, ZP },
-    [0x96]{ "stx", 3, 4, ZPY },
-    [0x8E]{ "stx", 3, 4, ABS },
-
-    [0x84]{ "sty", 2, 3, ZP },
-    [0x94]{ "sty", 2, 4, ZPX },
-    [0x8C]{ "sty", 3, 4, ABS },
-
-    [0xAA]{ "tax", 1, 2, IMP },
-
-    [0xA8]{ "tay", 1, 2, IMP },
-
-    [0xBA]{ "tsx", 1, 2, IMP },
-
-    [0x8A]{ "txa", 1, 2, IMP },
-
-    [0x9A]{ "txs", 1, 2, IMP },
-
-    [0x98]{ "tya", 1, 2, IMP },
-};
-
-int opcodes6502[] = {
-    // 0    1    2    3    4    5    6    7    8    9    A    B    C    D    E    F
-    0x00,0x01,0x05,0x06,0x08,0x09,0x0A,0x0D,0x0E,0x10,0x11,0x15,0x16,0x18,0x19,0x1D,    // 0
-    0x1E,0x20,0x21,0x24,0x25,0x26,0x28,0x29,0x2A,0x2C,0x2D,0x2E,0x30,0x31,0x35,0x36,    // 1
-    0x38,0x39,0x3D,0x3E,0x40,0x41,0x45,0x46,0x48,0x49,0x4A,0x4C,0x4D,0x4E,0x51,0x55,    // 2
-    0x56,0x58,0x59,0x5D,0x5E,0x60,0x61,0x65,0x66,0x68,0x69,0x6A,0x6C,0x6D,0x6E,0x70,    // 3
-    0x71,0x75,0x76,0x78,0x79,0x7D,0x7E,0x81,0x84,0x85,0x86,0x88,0x8A,0x8C,0x8D,0x8E,    // 4
-    0x90,0x91,0x94,0x95,0x96,0x98,0x99,0x9A,0x9D,0xA0,0xA1,0xA2,0xA4,0xA5,0xA6,0xA8,    // 5
-    0xA9,0xAA,0xAC,0xAD,0xAE,0xB0,0xB1,0xB4,0xB5,0xB6,0xB8,0xB9,0xBA,0xBC,0xBD,0xBE,    // 6
-    0xC0,0xC1,0xC4,0xC5,0xC6,0xC8,0xC9,0xCA,0xCC,0xCD,0xCE,0xD0,0xD1,0xD5,0xD6,0xD8,    // 7
-    0xD9,0xDD,0xDE,0xE0,0xE1,0xE4,0xE5,0xE6,0xE8,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xF0,    // 8
-    0xF1,0xF5,0xF6,0xF8,0xF9,0xFD,0xFE                                                  // 9
-};
-
-/* TODO:
- * update opcodes6510[]
- * was taken from aay64, but acme won't be able to compile all of them when set
- * to !cpu 6510
- */
-
-int opcodes6510[] = {
-    // 0    1    2    3    4    5    6    7    8    9    A    B    C    D    E    F
-    0x00,0x01,0x02,0x03,0x05,0x06,0x07,0x08,0x09,0x0A,0x0B,0x0D,0x0E,0x0F,0x10,0x11,    // 0
-    0x13,0x15,0x16,0x17,0x18,0x19,0x1B,0x1D,0x1E,0x1F,0x20,0x21,0x23,0x24,0x25,0x26,    // 1
-    0x27,0x28,0x29,0x2A,0x2B,0x2C,0x2D,0x2E,0x2F,0x30,0x31,0x33,0x35,0x36,0x37,0x38,    // 2
-    0x39,0x3B,0x3D,0x3E,0x3F,0x40,0x41,0x43,0x45,0x46,0x47,0x48,0x49,0x4A,0x4B,0x4C,    // 3
-    0x4D,0x4E,0x4F,0x51,0x53,0x55,0x56,0x57,0x58,0x59,0x5B,0x5D,0x5E,0x5F,0x60,0x61,    // 4
-    0x63,0x65,0x66,0x67,0x68,0x69,0x6A,0x6B,0x6C,0x6D,0x6E,0x6F,0x70,0x71,0x73,0x75,    // 5
-    0x76,0x77,0x78,0x79,0x7B,0x7D,0x7E,0x7F,0x81,0x83,0x84,0x85,0x86,0x87,0x88,0x8A,    // 6
-    0x8B,0x8C,0x8D,0x8E,0x8F,0x90,0x91,0x94,0x95,0x96,0x97,0x98,0x99,0x9A,0x9C,0x9D,    // 7
-    0x9E,0x9F,0xA0,0xA1,0xA2,0xA3,0xA4,0xA5,0xA6,0xA7,0xA8,0xA9,0xAA,0xAB,0xAC,0xAD,    // 8
-    0xAE,0xAF,0xB0,0xB1,0xB3,0xB4,0xB5,0xB6,0xB7,0xB8,0xB9,0xBA,0xBC,0xBD,0xBE,0xBF,    // 9
-    0xC0,0xC1,0xC3,0xC4,0xC5,0xC6,0xC7,0xC8,0xC9,0xCA,0xCB,0xCC,0xCD,0xCE,0xCF,0xD0,    // A
-    0xD1,0xD3,0xD5,0xD6,0xD7,0xD8,0xD9,0xDB,0xDD,0xDE,0xDF,0xE0,0xE1,0xE4,0xE5,0xE6,    // B
-    0xE8,0xE9,0xEA,0xEB,0xEC,0xED,0xEE,0xF0,0xF1,0xF5,0xF6,0xF8,0xF9,0xFD,0xFE          // C
-};
-
-enum {
-    DATATYPE_DATA,
-    DATATYPE_CODE,
-    DATATYPE_CODE_END
-}; // datatypes data and code
-
-int datamap[0xFFFF] = { DATATYPE_DATA };
-
-int valid_jumps[] = {
-    0xEA31,
-    0xEA81,
-    0xFCE2
+struct option long_options[] = {
+    { "watch",  no_argument,        NULL,   'w' },
+    { "stats",  optional_argument,  NULL,   'S' },
+    { "cycles", no_argument,        NULL,   'C' },
+    { NULL,     0,              NULL,   0 }
 };
 
-int labelmap[0xFFFF] = { 0 };
-
-datablock codeblocks[0xFFFF];
-int codeblocks_max_index = 0;
-
-datablock datablocks[0xFFFF];
-int datablocks_max_index = 0;
-
-virtual_file assembly;
-
-int     indent              = DEFAULT_INDENT;
-int     mode                = MODE6502;
-int     pc_end              = 0;
-int     pc_start            = 0x0801;
-
 int main(int argc, char *argv[])
 {
+    char    *batch_name         = NULL;
     char    *infile_name        = NULL;
-    char    *infile_nopath      = NULL;
+    char    *xref_name          = NULL;
+    char    *stats_name         = NULL;
+    char    *infile_nopath;
+    char    *ext;
+    char    outfile_name[4096];
     // char    *temp_string        = NULL;
 
     int     c                   = 0;
-    int     skipbytes           = 2;
+    int     entry               = 0;
+    int     num_threads         = 0;
+    int     result              = 0;
+    int     watch               = 0;
+    int     stats               = 0;
+    int     stdout_fd           = STDOUT_FILENO;
+    int     output_fds[SYNTAXES];
+    int     syntax;
+    int     i;
+    char    *format;
+
+    batch_jobs      jobs;
+    cli_options     options;
+    result_cache    cache;
+    annotations     notes;
+    signature_db    signatures;
+    xref_index      xref;
+    run_stats       file_stats;
+    stats_clock     start;
+    listing_output  outputs[SYNTAXES];
+    disass_context  *ctx;
 
     if ((argc == 1) ||
         (strcmp(argv[1], "-h") == 0) ||
@@ -449,503 +67,1254 @@ int main(int argc, char *argv[])
         exit(EXIT_SUCCESS);
     }
 
+    if (strcmp(argv[1], "xref") == 0)
+    {
+        exit((query_xref(argc - 2, argv + 2) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (strcmp(argv[1], "query") == 0)
+    {
+        exit((query_corpus(argc - 2, argv + 2) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    memset(&jobs, 0, sizeof(jobs));
+    jobs.outdir = ".";
+    jobs.options = &options;
+
+    memset(&options, 0, sizeof(options));
+    options.mode = MODE6502;
+    options.skipbytes = 2;
+    options.syntaxes[0] = SYNTAX_ACME;
+    options.syntaxes_count = 1;
+
     // getopt cmdline-argument handler
     opterr = 1;
 
-    while ((c = getopt (argc, argv, "m:s:")) != -1)
+    while ((c = getopt_long(argc, argv, "a:b:c:d:e:fF:i:j:m:o:s:t:u:wx:", long_options, NULL)) != -1)
     {
         switch (c)
         {
+        case 'a':
+            result = load_annotations(&notes, optarg);
+            if (result < 0)
+            {
+                printf("\nError: couldn't read annotation file \"%s\".\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            if (result > 0)
+            {
+                printf("\nError: %s:%d: invalid annotation.\n", optarg, result);
+                exit(EXIT_FAILURE);
+            }
+            options.notes = &notes;
+            options.notes_name = optarg;
+            break;
+        case 'b':
+            batch_name = optarg;
+            break;
+        case 'c':
+            if (open_cache(&cache, optarg) != 0)
+            {
+                printf("\nError: couldn't use \"%s\" as cache directory\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            options.cache = &cache;
+            break;
+        case 'd':
+            result = load_signatures(&signatures, optarg);
+            if (result < 0)
+            {
+                printf("\nError: couldn't read signature file \"%s\".\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            if (result > 0)
+            {
+                printf("\nError: %s:%d: invalid signature.\n", optarg, result);
+                exit(EXIT_FAILURE);
+            }
+            options.signatures = &signatures;
+            break;
+        case 'e':
+            if (sscanf(optarg, "%i", &entry) != 1 || entry < 0 || entry > 0xFFFF)
+            {
+                printf("\nError: -e needs an address between 0 and 0xFFFF\n");
+                exit(EXIT_FAILURE);
+            }
+            append_address(&options.entries, entry);
+            options.flow = 1;
+            break;
+        case 'f':
+            options.flow = 1;
+            break;
+        case 'F':
+            options.syntaxes_count = 0;
+            for (format = strtok(optarg, ","); format != NULL; format = strtok(NULL, ","))
+            {
+                syntax = find_syntax(format);
+                if (syntax < 0)
+                {
+                    printf("\nError: -F unknown format \"%s\"\n", format);
+                    exit(EXIT_FAILURE);
+                }
+                for (i = 0; i < options.syntaxes_count; i++)
+                {
+                    if (options.syntaxes[i] == syntax)
+                    {
+                        printf("\nError: -F format \"%s\" given twice\n", format);
+                        exit(EXIT_FAILURE);
+                    }
+                }
+                options.syntaxes[options.syntaxes_count++] = syntax;
+            }
+            if (options.syntaxes_count == 0)
+            {
+                printf("\nError: -F needs at least one format\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'i':
+            jobs.index_name = optarg;
+            break;
+        case 'j':
+            if (sscanf(optarg, "%i", &num_threads) != 1 || num_threads < 1)
+            {
+                printf("\nError: -j needs a positive integer value for number of threads\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 'm':
-            if (sscanf(optarg, "%i", &mode) != 1)
+            if (sscanf(optarg, "%i", &options.mode) != 1)
             {
                 printf("\nError: -m needs an integer value for file offset\n");
                 exit(EXIT_FAILURE);
             }
-            if (mode > 1)
+            if (options.mode > 1)
             {
                 printf("\nError: -m illegal mode\n");
                 exit(EXIT_FAILURE);
             }
             break;
+        case 'o':
+            jobs.outdir = optarg;
+            break;
         case 's':
-            if (sscanf(optarg, "%i", &skipbytes) != 1)
+            if (sscanf(optarg, "%i", &options.skipbytes) != 1)
             {
                 printf("\nError: -s needs an integer value for file offset\n");
                 exit(EXIT_FAILURE);
             }
-            if (skipbytes < 2)
+            if (options.skipbytes < 2)
             {
                 printf("\nError: -s must be at least 2 to calculate program counter\n");
                 exit(EXIT_FAILURE);
             }
             break;
+        case 't':
+            if (sscanf(optarg, "%li", &options.trace_cycles) != 1 || options.trace_cycles < 1)
+            {
+                printf("\nError: -t needs a positive number of cycles\n");
+                exit(EXIT_FAILURE);
+            }
+            options.flow = 1;
+            break;
+        case 'u':
+            if (sscanf(optarg, "%li", &options.unpack_cycles) != 1 || options.unpack_cycles < 1)
+            {
+                printf("\nError: -u needs a positive number of cycles\n");
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'w':
+            watch = 1;
+            break;
+        case 'x':
+            xref_name = optarg;
+            break;
+        case 'S':
+            stats = 1;
+            stats_name = optarg;
+            break;
+        case 'C':
+            options.timing = 1;
+            break;
         }
     }
 
-    // make sure a file was given
-    if ((optind) == argc)
+    if (xref_name != NULL && (watch || batch_name != NULL || jobs.index_name != NULL || optind + 1 != argc
+        || is_disk_image(argv[optind]) || is_container(argv[optind])))
     {
-        printf("\nError: no file specified.\n");
+        printf("\nError: -x needs exactly one PRG file\n");
         exit(EXIT_FAILURE);
     }
 
-    // open files
-    infile_name = newstr(argv[optind]);
-    infile_nopath = basename(infile_name);
-
-    printf("; input filename:   %s\n", infile_nopath);
-    printf("; skip bytes:       %d\n", skipbytes);
-    printf("\n");
-
-    assembly = read_file(infile_name, skipbytes);
-
-    pc_start = get_pc(infile_name, skipbytes);
-    pc_end = pc_start + assembly.length;
-
-    create_datamap();
-
-    fill_datablocks();
-
-    create_labelmap();
-
-    print_disassembly();
-
-    free(infile_name);
-    exit(EXIT_SUCCESS);
-}
-
-/* =============================================================================
- * code detection idea(s):
- *
- * assumption 1:    all code blocks will most likely end with
- *                  rts         (0x60)
- *                  jmp 0xHILO  (0x4c 0xLO 0xHI)
- *
- * assuption 2:     in case of jmp HI and LO will most likely be
- *
- *                  a)  an address 0xHILO within the range between pc_start and
- *                      pc_end
- *
- *                  b)  one of the typical IRQ end addresses:
- *                          0xEA31
- *                          0xEA81
- *                      or jump to reset:
- *                          0xFCE2
- *
- *                  c)  an address 0xHILO within the range 0xE000 - 0xFFFF
- *                      (KERNAL ROM)
- *
- *                  d)  an address 0xHILO within the range 0xA000 - 0xBFFF
- *                      (BASIC ROM)
- *
- *                  e)  if pc_end > 0xA000 c) is very unlikely
- *
- *                  f)  if 0xHILO points to an address that is not code it's
- *                      probably:
- *
- *                      f1) if 0xHILO > 0: not code, but data
- *
- *                      f2) if 0xHILO = 0: could be a jump to generated code
- *
- *
- *      step 1:     all code is DATATYPE_DATA by default
- *
- *      step 2:     find rts (0x60) and jmp (0x4C) codes in the assembly data
- *
- *      step 2b:    in case of jmp check the 0xHILO address according to
- *                  assumption 2
- *                  cases a) and b) should always be considered
- *                  maybe add a command line switch if KERNAL or BASIC ROM jumps
- *                  should be considered (?)
- *
- *      step 3:     mark the findings as DATATYPE_CODE_END in the datamap
- *
- *      step 4:     do one "normal" disassembly run and if the datamap is
- *                  not = DATATYPE_CODE_END
- *                  set DATATYPE_CODE in case of assumed "code"
- *
- *                  beware of the case that operand is DATATYPE_CODE_END
- *                  if that's the case the current code chunk could be
- *                  misaligned
- *
- *      step 5:     go through the resulting datamap again
- *                  mark beginning of blocks with DATATYPE_CODE
- *                  if it doesn't END with DATATYPE_CODE_END
- *                  go back and set everything to DATATYPE_DATA
- *
- *      step 6:     skip code output in the main loop when datamap is set to
- *                  DATATYPE_DATA
- * =============================================================================
- */
-
-void create_datamap()
-{
-    int i;
-    int address;
-    int pc = pc_start;
-
-    // step 2 + 3
-    for (i = 0; i < (pc_end - pc_start); i++)
+    if (watch)
     {
-        if (assembly.data[i] == 0x60)
+        if (jobs.index_name != NULL || batch_name != NULL || optind + 1 != argc
+            || is_disk_image(argv[optind]) || is_container(argv[optind]))
         {
-            datamap[pc] = DATATYPE_CODE_END;
+            printf("\nError: --watch needs exactly one PRG file\n");
+            exit(EXIT_FAILURE);
         }
-        else if (assembly.data[i] == 0x4C || assembly.data[i] == 0x6C)
+        if (options.signatures != NULL)
         {
-            // step 2b
-            address = ((assembly.data[i+1]) + (assembly.data[i+2] << 8));
-
-            if ((address >= pc_start) && (address < pc_end))
-            {
-                datamap[pc] = DATATYPE_CODE_END;
-            }
-            else if (is_in_array(address, valid_jumps, sizeof(valid_jumps)))
-            {
-                datamap[pc] = DATATYPE_CODE_END;
-            }
+            printf("\nError: --watch doesn't work with -d yet\n");
+            exit(EXIT_FAILURE);
+        }
+        if (stats)
+        {
+            printf("\nError: --watch doesn't work with --stats\n");
+            exit(EXIT_FAILURE);
+        }
+        if (options.syntaxes_count > 1 || syntaxes[options.syntaxes[0]].export != NULL)
+        {
+            printf("\nError: --watch writes only one assembler format\n");
+            exit(EXIT_FAILURE);
+        }
+        if (options.timing)
+        {
+            printf("\nError: --watch doesn't work with --cycles yet\n");
+            exit(EXIT_FAILURE);
         }
 
-        pc++;
+        watch_file(&options, argv[optind], jobs.outdir);
+        exit(EXIT_FAILURE);
     }
 
-    // step 4
-    pc = pc_start;
-    opcode *current_opcode;
-
-    while (pc < pc_end)
+    if (stats)
     {
-        i = pc - pc_start;
-        current_opcode = &opcodes[assembly.data[i]];
+        jobs.stats_file = (stats_name != NULL) ? fopen(stats_name, "w") : stderr;
+        if (jobs.stats_file == NULL)
+        {
+            printf("\nError: couldn't write file \"%s\".\n", stats_name);
+            exit(EXIT_FAILURE);
+        }
+    }
 
-        if (is_in_mode(assembly.data[i]) && datamap[pc] != DATATYPE_CODE_END)
+    if (batch_name != NULL)
+    {
+        if (batch_collect(&jobs, batch_name) != 0)
         {
-            int bytes = current_opcode->bytes;
+            printf("\nError: couldn't read file list \"%s\".\n", batch_name);
+            exit(EXIT_FAILURE);
+        }
 
-            switch (current_opcode->addressing_mode)
-            {
-            case ACC:
-            case IMP:
-            default:
-                datamap[pc] = DATATYPE_CODE;
-                break;
-            case IMM:
-            case ZP:
-            case ZPX:
-            case ZPY:
-            case INDX:
-            case INDY:
-                datamap[pc] = DATATYPE_CODE;
-                datamap[pc+1] = DATATYPE_CODE;
-                break;
-            case ABS:
-            case ABSI:
-            case ABSX:
-            case ABSY:
-                datamap[pc] = DATATYPE_CODE;
-                datamap[pc+1] = DATATYPE_CODE;
-                datamap[pc+2] = DATATYPE_CODE;
-                break;
-            case REL:
-                datamap[pc] = DATATYPE_CODE;
-                datamap[pc+1] = DATATYPE_CODE;
-                break;
-            }
-            pc += bytes;
+        // any further arguments are added to the batch as well
+        for (; optind < argc; optind++)
+        {
+            batch_add_file(&jobs, argv[optind]);
         }
-        else
+
+        if (num_threads == 0)
         {
-            if (datamap[pc] != DATATYPE_CODE_END)
-            {
-                datamap[pc] = DATATYPE_DATA;
-            }
-            else
-            {
-                if (assembly.data[i] == 0x4C || assembly.data[i] == 0x6C)
-                {
-                    datamap[pc+1] = DATATYPE_CODE_END;
-                    datamap[pc+2] = DATATYPE_CODE_END;
-                    pc += 2;
-                }
-            }
-            pc++;
+            num_threads = sysconf(_SC_NPROCESSORS_ONLN);
         }
-    };
 
-    // step 5
-    pc = pc_start;
-    int codeblock_start = 0;
-    int j;
+        result = batch_disassemble(&jobs, num_threads);
+        print_cache_info(options.cache);
+        exit((result == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // make sure a file was given
+    if ((optind) == argc)
+    {
+        printf("\nError: no file specified.\n");
+        exit(EXIT_FAILURE);
+    }
 
-    for (i = 0; i < (pc_end - pc_start); i++)
+    // disk images and containers always give one file per PRG / bank, so
+    // they're a batch. so is everything that goes into an index
+    if (jobs.index_name != NULL || is_disk_image(argv[optind]) || is_container(argv[optind]))
     {
-        if (datamap[pc] == DATATYPE_CODE && !codeblock_start)
+        for (; optind < argc; optind++)
         {
-            codeblock_start = pc;
+            batch_add_file(&jobs, argv[optind]);
         }
 
-        if (datamap[pc] == DATATYPE_DATA && codeblock_start)
+        if (num_threads == 0)
         {
-            for (j = codeblock_start; j < pc; j++)
-            {
-                datamap[j] = DATATYPE_DATA;
-            }
+            num_threads = sysconf(_SC_NPROCESSORS_ONLN);
         }
 
-        if (datamap[pc] == DATATYPE_CODE_END)
-        {
-            codeblock_start = 0;
+        result = batch_disassemble(&jobs, num_threads);
+        print_cache_info(options.cache);
+        exit((result == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
 
-            if (assembly.data[pc - pc_start] == 0x4C || assembly.data[pc - pc_start] == 0x6C)
-            {
-                pc += 2;
-            }
-        }
+    // open files
+    infile_name = newstr(argv[optind]);
+
+    ctx = new_context();
+    setup_context(ctx, &options);
+    set_output(ctx, output_to_fd, &stdout_fd);
 
-        pc++;
+    memset(&xref, 0, sizeof(xref));
+    if (xref_name != NULL)
+    {
+        ctx->xref = &xref;
     }
 
-    // step 6 in main output loop
-}
+    // the other formats of -F go to outdir/{name}.{format}.asm etc.
+    infile_nopath = strrchr(infile_name, '/');
+    infile_nopath = infile_nopath ? infile_nopath + 1 : infile_name;
+    ext = strrchr(infile_nopath, '.');
+    snprintf(outfile_name, sizeof(outfile_name), "%s/%.*s", jobs.outdir,
+        ext ? (int)(ext - infile_nopath) : (int)strlen(infile_nopath), infile_nopath);
+    if (open_outputs(ctx, &options, outfile_name, outputs, output_fds) != 0)
+    {
+        exit(EXIT_FAILURE);
+    }
 
-/* =============================================================================
- * labelmap concept
- *
- *      1.) less is more
- *          don't flood the disassembly with labels like other disass tools
- *
- *      2.) do not differentiate between label "types", so that the labelmap is
- *          just a simple int array representing the C64 memory with 0 = nolabel
- *          and 1 = label
- *
- *          every label for jmp and jsr should be:
- *              pcHILO:
- *
- *          if there are load / store references to an address that would not
- *          be at the beginning of the line in dissassembly (self modification)
- *          keep the labels "in order", i.e:
- *              pcC0DE:
- *              pcC0DF = *+1
- *                          lda #0x00
- *              pcC0E0:
- *              pcC0E1 = *+1
- *              pcC0E2 = *+2
- *                          sta 0xD020
- *
- *      3.) don't set direct labels for load / store references that are inside
- *          a DATATYPE_DATA block
- *          instead parse the load / store command target addresses relative to
- *          the beginning of the DATATYPE_DATA block, i.e.
- *                          lda pc1234+3
- *                          sta pc1234+2
- *                          [...]
- *          pc1234:             ; +0    +1    +2    +3    +4    +5
- *                          !byte 0x00, 0x00, 0xDD, 0xCC, 0x00, 0x00
- *
- *      4.) keep branches (type REL) simple:
- *          only use *-X and *+X if target address is not reference elsewhere
- *
- *      5.) no autolabels in zeropage
- *          (maybe only if it's crystal clear to be a pointer)
- *
- *      6.) no labels beyond pc_end to keep calls to KERNAL / BASIC "pure"
- * =============================================================================
- */
-void create_labelmap()
-{
-    int i;
-    int j;
+    memset(&file_stats, 0, sizeof(file_stats));
+    if (stats)
+    {
+        read_clock(&start, 1);
+        ctx->stats = &file_stats;
+        start_stats(ctx->stats);
+    }
+
+    if (disassemble_file(ctx, infile_name, options.skipbytes) != 0)
+    {
+        printf("\nError: couldn't read file \"%s\".\n", infile_name);
+        exit(EXIT_FAILURE);
+    }
+    print_cache_info(options.cache);
+    close_outputs(ctx, output_fds);
+
+    if (stats)
+    {
+        print_stats_report(jobs.stats_file, &infile_name, &file_stats, 1, 1, &start);
+    }
 
-    // label at the start of each datablock
-    for (i = 0; i < datablocks_max_index; i++)
+    if (xref_name != NULL)
     {
-        labelmap[datablocks[i].pc_start] = 1;
+        if (save_xref(&xref, xref_name) != 0)
+        {
+            printf("\nError: couldn't write file \"%s\".\n", xref_name);
+            exit(EXIT_FAILURE);
+        }
+        free_xref(&xref);
     }
 
-    // label at the start of each codeblock
-    for (i = 0; i < codeblocks_max_index; i++)
+    free_context(ctx);
+    free(infile_name);
+    free(options.entries.addresses);
+    if (options.notes != NULL)
     {
-        labelmap[codeblocks[i].pc_start] = 1;
+        free_annotations(options.notes);
     }
+    if (options.signatures != NULL)
+    {
+        free_signatures(options.signatures);
+    }
+    exit(EXIT_SUCCESS);
 }
 
 /* =============================================================================
- * void fill_datablocks()
+ * void batch_add_container(batch_jobs *jobs, char *filename)
+ *
+ * open the T64 / CRT filename and add every file or bank in it to the batch
  * =============================================================================
  */
-void fill_datablocks()
+void batch_add_container(batch_jobs *jobs, char *filename)
 {
-    int i;
-    datablock last_block = { 0, 0, -1 };
-    // datablock current_block;
-    int last_blocktype = -1;
-    int current_blocktype;
+    container   *cont;
+    int         i;
 
-    for (i = pc_start; i < pc_end; i++)
+    cont = malloc(sizeof(container));
+    if (cont == NULL)
     {
-        current_blocktype = datamap[i] == DATATYPE_CODE_END ? DATATYPE_CODE : datamap[i];
-
-        if (current_blocktype != last_blocktype)
-        {
-            last_block.pc_end = i;
-
-            if (last_block.type == DATATYPE_DATA)
-            {
-                datablocks[datablocks_max_index] = last_block;
-                datablocks_max_index++;
-            }
-            else if (last_block.type == DATATYPE_CODE)
-            {
-                codeblocks[codeblocks_max_index] = last_block;
-                codeblocks_max_index++;
-            }
-
-            last_block.pc_start = i;
-            last_block.pc_end = 0;
-            last_block.type = current_blocktype;
-        }
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
 
-        last_blocktype = current_blocktype;
+    if (open_container(cont, filename) != 0)
+    {
+        fprintf(stderr, "Error: couldn't read container \"%s\".\n", filename);
+        jobs->failed++;
+        free(cont);
+        return;
     }
 
-    // test output
-    /*
-    for (i = 0; i < codeblocks_max_index; i++)
+    if ((jobs->conts_count & 0x0F) == 0)
     {
-        printf("; codeblocks[%03i] 0x%04X - 0x%04X type: %i\n",
-            i,
-            codeblocks[i].pc_start,
-            codeblocks[i].pc_end,
-            codeblocks[i].type
-        );
+        jobs->conts = realloc(jobs->conts, (jobs->conts_count + 0x10) * sizeof(container *));
+        if (jobs->conts == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
     }
+    jobs->conts[jobs->conts_count] = cont;
+    jobs->conts_count++;
 
-    for (i = 0; i < datablocks_max_index; i++)
+    for (i = 0; i < cont->entries_count; i++)
     {
-        printf("; datablocks[%03i] 0x%04X - 0x%04X type: %i\n",
-            i,
-            datablocks[i].pc_start,
-            datablocks[i].pc_end,
-            datablocks[i].type
-        );
+        batch_add_job(jobs, filename, NULL, cont, i);
     }
-    */
 }
 
 /* =============================================================================
- * int get_pc(char *filename, int skipbytes)
- * return pc;
+ * void batch_add_disk(batch_jobs *jobs, char *filename)
  *
- * gets two bytes from a file named "filename" and returns the
- * program counter according to those bytes
+ * open the disk image filename and add every PRG on it to the batch
  * =============================================================================
  */
-int get_pc(char *filename, int skipbytes)
+void batch_add_disk(batch_jobs *jobs, char *filename)
 {
-    FILE    *infile             = NULL;
-    int     lobyte              = 0x00;
-    int     hibyte              = 0x00;
-    int     pc                  = 0x0801;
+    disk_image  *disk;
+    int         i;
 
-    infile = fopen(filename, "rb");
-    if (infile == NULL)
+    disk = malloc(sizeof(disk_image));
+    if (disk == NULL)
     {
-        printf("\nError: couldn't read file \"%s\".\n", filename);
+        printf("\nError: out of memory.\n");
         exit(EXIT_FAILURE);
     }
 
-    // forward infile according to skipbytes
-    if (skipbytes > 2)
+    if (open_disk(disk, filename) != 0)
     {
-        fseek(infile, skipbytes - 2, 0);
+        fprintf(stderr, "Error: couldn't read disk image \"%s\".\n", filename);
+        jobs->failed++;
+        free(disk);
+        return;
     }
 
-    lobyte = fgetc(infile);
-    hibyte = fgetc(infile);
-
-    fclose(infile);
-
-    pc = (lobyte + (hibyte << 8)) & 0xFFFF;
+    if ((jobs->disks_count & 0x0F) == 0)
+    {
+        jobs->disks = realloc(jobs->disks, (jobs->disks_count + 0x10) * sizeof(disk_image *));
+        if (jobs->disks == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    jobs->disks[jobs->disks_count] = disk;
+    jobs->disks_count++;
 
-    return pc;
+    for (i = 0; i < disk->entries_count; i++)
+    {
+        batch_add_job(jobs, filename, disk, NULL, i);
+    }
 }
 
 /* =============================================================================
- * int is_in_array(int needle, int haystack[], int haystack_len)
+ * void batch_add_file(batch_jobs *jobs, char *filename)
  *
- * return 0; // if needle not found in haystack array
- * return 1; // if needle was found in haystack array
- *
- * everything has to be type int
+ * add filename to the list of files to be disassembled, for disk images and
+ * containers every PRG / bank in it is added
  * =============================================================================
  */
-int is_in_array(int needle, int haystack[], int haystack_len)
+void batch_add_file(batch_jobs *jobs, char *filename)
 {
-    int i;
+    if (is_disk_image(filename))
+    {
+        batch_add_disk(jobs, filename);
+        return;
+    }
 
-    for (i = 0; i < haystack_len; i++)
+    if (is_container(filename))
     {
-        if (haystack[i] == needle) return 1;
+        batch_add_container(jobs, filename);
+        return;
     }
 
-    return 0;
+    batch_add_job(jobs, filename, NULL, NULL, 0);
 }
 
 /* =============================================================================
- * int is_in_mode(int opcode)
+ * void batch_add_job(batch_jobs *jobs, char *name, disk_image *disk,
+ *                    container *cont, int entry)
  *
- * return 0; // if opcode not found in mode
- * return 1; // if opcode was found in mode
+ * append a job with a copy of name to the batch
  * =============================================================================
  */
-int is_in_mode(int opcode)
+void batch_add_job(batch_jobs *jobs, char *name, disk_image *disk, container *cont, int entry)
 {
-    int i;
-
-    switch (mode)
+    if ((jobs->files_count & 0xFF) == 0)
     {
-    case MODE6502:
-    default:
-        for (i = 1; i < 0x97; i++)
+        jobs->files = realloc(jobs->files, (jobs->files_count + 0x100) * sizeof(batch_file));
+        if (jobs->files == NULL)
         {
-            if (opcode == opcodes6502[i])
-            {
-                return 1;
-            }
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
         }
-        break;
-    case MODE6510:
-        for (i = 1; i < 0xCF; i++)
-        {
-            if (opcode == opcodes6510[i])
-            {
-                return 1;
-            }
+    }
+
+    jobs->files[jobs->files_count].name = newstr(name);
+    jobs->files[jobs->files_count].disk = disk;
+    jobs->files[jobs->files_count].cont = cont;
+    jobs->files[jobs->files_count].entry = entry;
+    jobs->files_count++;
+}
+
+/* =============================================================================
+ * int batch_collect(batch_jobs *jobs, char *listname)
+ *
+ * return 0;  // on success
+ * return -1; // if listname couldn't be read
+ *
+ * listname is either a directory, then every *.prg file, disk image and
+ * container in it is added, or a plain textfile with one filename per line. empty lines and
+ * lines starting with '#' are ignored.
+ * =============================================================================
+ */
+int batch_collect(batch_jobs *jobs, char *listname)
+{
+    DIR             *dir;
+    FILE            *listfile;
+    struct dirent   *entry;
+    struct stat     st;
+    char            **names     = NULL;
+    char            line[4096];
+    int             len;
+    int             names_count = 0;
+    int             i;
+
+    if (stat(listname, &st) != 0)
+    {
+        return -1;
+    }
+
+    if (S_ISDIR(st.st_mode))
+    {
+        dir = opendir(listname);
+        if (dir == NULL)
+        {
+            return -1;
+        }
+
+        while ((entry = readdir(dir)) != NULL)
+        {
+            if (!is_input_file(entry->d_name))
+            {
+                continue;
+            }
+
+            if ((names_count & 0xFF) == 0)
+            {
+                names = realloc(names, (names_count + 0x100) * sizeof(char *));
+                if (names == NULL)
+                {
+                    printf("\nError: out of memory.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            snprintf(line, sizeof(line), "%s/%s", listname, entry->d_name);
+            names[names_count++] = newstr(line);
+        }
+        closedir(dir);
+
+        // readdir() order is arbitrary, keep runs reproducible
+        qsort(names, names_count, sizeof(char *), compare_strings);
+
+        for (i = 0; i < names_count; i++)
+        {
+            batch_add_file(jobs, names[i]);
+            free(names[i]);
+        }
+        free(names);
+
+        return 0;
+    }
+
+    listfile = fopen(listname, "r");
+    if (listfile == NULL)
+    {
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), listfile) != NULL)
+    {
+        len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+        {
+            line[--len] = '\0';
+        }
+
+        if (len == 0 || line[0] == '#')
+        {
+            continue;
+        }
+
+        batch_add_file(jobs, line);
+    }
+    fclose(listfile);
+
+    return 0;
+}
+
+/* =============================================================================
+ * int batch_disassemble(batch_jobs *jobs, int num_threads)
+ *
+ * return 0;  // if all files were disassembled
+ * return -1; // if at least one file failed, including disk images and
+ *            // containers that couldn't be opened by batch_add_file()
+ *
+ * spreads all files of a batch over num_threads workers
+ * =============================================================================
+ */
+int batch_disassemble(batch_jobs *jobs, int num_threads)
+{
+    pthread_t   *threads;
+    stats_clock start;
+    char        **names;
+    char        name[4096];
+    int         i;
+
+    if (num_threads > jobs->files_count)
+    {
+        num_threads = jobs->files_count;
+    }
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    pthread_mutex_init(&jobs->lock, NULL);
+    jobs->next_file = 0;
+
+    read_clock(&start, 1);
+    if (jobs->stats_file != NULL)
+    {
+        jobs->stats = calloc(jobs->files_count + 1, sizeof(run_stats));
+        if (jobs->stats == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (jobs->index_name != NULL)
+    {
+        jobs->summaries = calloc(jobs->files_count + 1, sizeof(file_summary));
+        if (jobs->summaries == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    threads = malloc(num_threads * sizeof(pthread_t));
+    if (threads == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < num_threads; i++)
+    {
+        if (pthread_create(&threads[i], NULL, batch_worker, jobs) != 0)
+        {
+            printf("\nError: couldn't start worker thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    pthread_mutex_destroy(&jobs->lock);
+
+    if (jobs->summaries != NULL)
+    {
+        if (save_corpus(jobs->summaries, jobs->files_count, jobs->index_name) != 0)
+        {
+            fprintf(stderr, "Error: couldn't write file \"%s\".\n", jobs->index_name);
+            jobs->failed++;
+        }
+
+        for (i = 0; i < jobs->files_count; i++)
+        {
+            free_summary(&jobs->summaries[i]);
+        }
+        free(jobs->summaries);
+        jobs->summaries = NULL;
+    }
+
+    if (jobs->stats != NULL)
+    {
+        names = malloc((jobs->files_count + 1) * sizeof(char *));
+        if (names == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+
+        for (i = 0; i < jobs->files_count; i++)
+        {
+            batch_job_name(&jobs->files[i], name, sizeof(name));
+            names[i] = newstr(name);
+        }
+
+        print_stats_report(jobs->stats_file, names, jobs->stats, jobs->files_count,
+            num_threads, &start);
+
+        for (i = 0; i < jobs->files_count; i++)
+        {
+            free(names[i]);
+        }
+        free(names);
+        free(jobs->stats);
+        jobs->stats = NULL;
+    }
+
+    for (i = 0; i < jobs->files_count; i++)
+    {
+        free(jobs->files[i].name);
+    }
+    free(jobs->files);
+    jobs->files = NULL;
+
+    for (i = 0; i < jobs->disks_count; i++)
+    {
+        close_disk(jobs->disks[i]);
+        free(jobs->disks[i]);
+    }
+    free(jobs->disks);
+    jobs->disks = NULL;
+
+    for (i = 0; i < jobs->conts_count; i++)
+    {
+        close_container(jobs->conts[i]);
+        free(jobs->conts[i]);
+    }
+    free(jobs->conts);
+    jobs->conts = NULL;
+
+    return jobs->failed ? -1 : 0;
+}
+
+/* =============================================================================
+ * void batch_job_name(const batch_file *job, char *name, int size)
+ *
+ * the name of the file, "{image}:{name}" for a file on a disk image or in a
+ * container. for messages, the index and the stats.
+ * =============================================================================
+ */
+void batch_job_name(const batch_file *job, char *name, int size)
+{
+    char        entry_name[64];
+
+    if (job->disk != NULL)
+    {
+        petscii_name(entry_name, job->disk->entries[job->entry].name, 0);
+        snprintf(name, size, "%s:%s", job->name, entry_name);
+    }
+    else if (job->cont != NULL)
+    {
+        petscii_name(entry_name, job->cont->entries[job->entry].name, 0);
+        snprintf(name, size, "%s:%s", job->name, entry_name);
+    }
+    else
+    {
+        snprintf(name, size, "%s", job->name);
+    }
+}
+
+/* =============================================================================
+ * void *batch_worker(void *arg)
+ *
+ * thread main loop: fetches the next file from the batch_jobs in arg and
+ * writes its disassembly to outdir/{name}.asm until the batch is empty.
+ * files from disk images and containers go to outdir/{image}_{name}.asm,
+ * CRT banks are named bank{NN}_{address}. every other format of -F goes to
+ * {name}.{format}.asm next to it.
+ * with an index (-i) nothing is written, every file is only analysed into
+ * jobs->summaries.
+ * the disass_context is allocated once per worker and reused for every file.
+ * =============================================================================
+ */
+void *batch_worker(void *arg)
+{
+    batch_jobs      *jobs           = arg;
+    batch_file      *job;
+    container_entry *cont_entry     = NULL;
+    disass_context  *ctx;
+    disk_entry      *entry          = NULL;
+    unsigned char   *buffer         = NULL;
+    output_buffer   discard;
+    char            outfile_name[4096];
+    char            base_name[4000];     // leaves room for the extension
+    char            entry_name[64];
+    char            *infile_nopath;
+    char            *ext;
+    long            length          = 0;
+    long            buffer_size     = 0;
+    int             i;
+    int             len;
+    int             outfile;
+    int             output_fds[SYNTAXES];
+    int             result;
+    listing_output  outputs[SYNTAXES];
+
+    ctx = new_context();
+    setup_context(ctx, jobs->options);
+    set_output(ctx, output_to_fd, &outfile);
+
+    // the header lines still arrive with an index
+    memset(&discard, 0, sizeof(discard));
+    if (jobs->summaries != NULL)
+    {
+        set_output(ctx, output_to_buffer, &discard);
+    }
+
+    for (;;)
+    {
+        pthread_mutex_lock(&jobs->lock);
+        i = jobs->next_file++;
+        pthread_mutex_unlock(&jobs->lock);
+
+        if (i >= jobs->files_count)
+        {
+            break;
+        }
+        job = &jobs->files[i];
+
+        if (jobs->stats != NULL)
+        {
+            ctx->stats = &jobs->stats[i];
+            start_stats(ctx->stats);
+        }
+
+        infile_nopath = strrchr(job->name, '/');
+        infile_nopath = infile_nopath ? infile_nopath + 1 : job->name;
+
+        ext = strrchr(infile_nopath, '.');
+        len = ext ? (int)(ext - infile_nopath) : (int)strlen(infile_nopath);
+
+        if (job->disk != NULL)
+        {
+            entry = &job->disk->entries[job->entry];
+            petscii_name(entry_name, entry->name, 1);
+            snprintf(base_name, sizeof(base_name), "%s/%.*s_%s",
+                jobs->outdir, len, infile_nopath, entry_name);
+        }
+        else if (job->cont != NULL)
+        {
+            cont_entry = &job->cont->entries[job->entry];
+            petscii_name(entry_name, cont_entry->name, 1);
+            snprintf(base_name, sizeof(base_name), "%s/%.*s_%s",
+                jobs->outdir, len, infile_nopath, entry_name);
+        }
+        else
+        {
+            snprintf(base_name, sizeof(base_name), "%s/%.*s",
+                jobs->outdir, len, infile_nopath);
+        }
+        if (job->disk != NULL)
+        {
+            // straight from the mapped image, the sectors only have to be
+            // joined. before any output is opened, a broken chain leaves none
+            length = read_disk_file(job->disk, entry, NULL, 0);
+            if (length < 0)
+            {
+                petscii_name(entry_name, entry->name, 0);
+                fprintf(stderr, "Error: couldn't read file \"%s:%s\".\n", infile_nopath, entry_name);
+                pthread_mutex_lock(&jobs->lock);
+                jobs->failed++;
+                pthread_mutex_unlock(&jobs->lock);
+                if (ctx->stats != NULL)
+                {
+                    ctx->stats->failed++;
+                }
+                continue;
+            }
+            if (length > buffer_size)
+            {
+                buffer_size = length;
+                buffer = realloc(buffer, buffer_size);
+                if (buffer == NULL)
+                {
+                    printf("\nError: out of memory.\n");
+                    exit(EXIT_FAILURE);
+                }
+            }
+            read_disk_file(job->disk, entry, buffer, length);
+        }
+
+        output_name(outfile_name, sizeof(outfile_name), base_name, jobs->options->syntaxes[0], 1);
+
+        if (jobs->summaries != NULL)
+        {
+            ctx->summary = &jobs->summaries[i];
+            discard.length = 0;
+            outfile = -1;
+        }
+        else if ((outfile = open(outfile_name, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+        {
+            fprintf(stderr, "Error: couldn't write file \"%s\".\n", outfile_name);
+            pthread_mutex_lock(&jobs->lock);
+            jobs->failed++;
+            pthread_mutex_unlock(&jobs->lock);
+            if (ctx->stats != NULL)
+            {
+                ctx->stats->failed++;
+            }
+            continue;
+        }
+        else if (open_outputs(ctx, jobs->options, base_name, outputs, output_fds) != 0)
+        {
+            close(outfile);
+            pthread_mutex_lock(&jobs->lock);
+            jobs->failed++;
+            pthread_mutex_unlock(&jobs->lock);
+            if (ctx->stats != NULL)
+            {
+                ctx->stats->failed++;
+            }
+            continue;
+        }
+
+        if (job->disk != NULL)
+        {
+            petscii_name(entry_name, entry->name, 0);
+            snprintf(outfile_name, sizeof(outfile_name), "%s:%s", infile_nopath, entry_name);
+
+            result = disassemble_data(ctx, outfile_name, buffer, length, jobs->options->skipbytes);
+        }
+        else if (job->cont != NULL)
+        {
+            petscii_name(entry_name, cont_entry->name, 0);
+            snprintf(outfile_name, sizeof(outfile_name), "%s:%s", infile_nopath, entry_name);
+
+            result = disassemble_block(ctx, outfile_name, cont_entry->data,
+                cont_entry->length, cont_entry->pc);
+        }
+        else
+        {
+            result = disassemble_file(ctx, job->name, jobs->options->skipbytes);
+        }
+
+        if (result != 0)
+        {
+            fprintf(stderr, "Error: couldn't read file \"%s\".\n",
+                (job->disk != NULL || job->cont != NULL) ? outfile_name : job->name);
+            pthread_mutex_lock(&jobs->lock);
+            jobs->failed++;
+            pthread_mutex_unlock(&jobs->lock);
+            if (ctx->stats != NULL)
+            {
+                ctx->stats->failed++;
+            }
+        }
+        else if (ctx->summary != NULL)
+        {
+            batch_job_name(job, outfile_name, sizeof(outfile_name));
+            ctx->summary->name = newstr(outfile_name);
+        }
+
+        if (outfile >= 0)
+        {
+            close(outfile);
+            close_outputs(ctx, output_fds);
         }
-        break;
     }
 
+    free(discard.data);
+    free(buffer);
+    free_context(ctx);
+    return NULL;
+}
+
+/* =============================================================================
+ * void close_outputs(disass_context *ctx, int *fds)
+ *
+ * close the files opened by open_outputs()
+ * =============================================================================
+ */
+void close_outputs(disass_context *ctx, int *fds)
+{
+    int i;
+
+    for (i = 0; i < ctx->outputs_count; i++)
+    {
+        close(fds[i]);
+    }
+    ctx->outputs = NULL;
+    ctx->outputs_count = 0;
+}
+
+/* =============================================================================
+ * int compare_strings(const void *a, const void *b)
+ *
+ * qsort() helper for arrays of char *
+ * =============================================================================
+ */
+int compare_strings(const void *a, const void *b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* =============================================================================
+ * int disassemble_block(disass_context *ctx, char *name,
+ *                       const unsigned char *data, int length, int pc)
+ *
+ * return 0;  // on success
+ * return -1; // if pc or length are invalid
+ *
+ * like disassemble_data() for data without a load address in front, e.g.
+ * T64 files and CRT banks. a CRT bank at 0x8000 with the "CBM80" signature
+ * starts at its cold start vector.
+ * =============================================================================
+ */
+int disassemble_block(disass_context *ctx, char *name, const unsigned char *data,
+    int length, int pc)
+{
+    if (load_buffer(ctx, data, length, pc) != 0)
+    {
+        return -1;
+    }
+
+    if (pc == 0x8000 && length >= 9 && memcmp(data + 4, "\xC3\xC2\xCD\x38\x30", 5) == 0)
+    {
+        ctx->entry = data[0] + (data[1] << 8);
+    }
+
+    disassemble_loaded(ctx, name, -1);
+
+    return 0;
+}
+
+/* =============================================================================
+ * int disassemble_data(disass_context *ctx, char *name,
+ *                      const unsigned char *data, size_t size, int skipbytes)
+ *
+ * return 0;  // on success
+ * return -1; // if data is too short
+ *
+ * load_prg() and disassemble_loaded() for one PRG in memory
+ * =============================================================================
+ */
+int disassemble_data(disass_context *ctx, char *name, const unsigned char *data,
+    size_t size, int skipbytes)
+{
+    if (load_prg(ctx, data, size, skipbytes) != 0)
+    {
+        return -1;
+    }
+
+    disassemble_loaded(ctx, name, skipbytes);
+
     return 0;
 }
 
+/* =============================================================================
+ * int disassemble_file(disass_context *ctx, char *filename, int skipbytes)
+ *
+ * return 0;  // on success
+ * return -1; // if the file couldn't be read
+ *
+ * disassemble_data() for a file
+ * =============================================================================
+ */
+int disassemble_file(disass_context *ctx, char *filename, int skipbytes)
+{
+    mapped_file infile;
+    int         result;
+
+    if (map_file(&infile, filename) != 0)
+    {
+        reset_context(ctx);
+        return -1;
+    }
+
+    result = disassemble_data(ctx, filename, infile.data, infile.size, skipbytes);
+
+    unmap_file(&infile);
+
+    return result;
+}
+
+/* =============================================================================
+ * void disassemble_loaded(disass_context *ctx, char *name, int skipbytes)
+ *
+ * runs the complete chain for the data loaded into ctx and sends the result
+ * to the output of ctx. name is only used for the header and messages, the
+ * skip bytes line is left out if skipbytes < 0.
+ * =============================================================================
+ */
+void disassemble_loaded(disass_context *ctx, char *name, int skipbytes)
+{
+    int         unpacked;
+
+    unpacked = prepare_loaded(ctx, name);
+
+    print_header(ctx, name, skipbytes, unpacked);
+
+    disassemble(ctx);
+}
+
+/* =============================================================================
+ * int is_input_file(const char *filename)
+ *
+ * return 1; // if filename is a *.prg, a disk image or a container
+ * =============================================================================
+ */
+int is_input_file(const char *filename)
+{
+    const char *ext = strrchr(filename, '.');
+
+    return (ext != NULL && strcasecmp(ext, ".prg") == 0)
+        || is_disk_image(filename) || is_container(filename);
+}
+
+/* =============================================================================
+ * int prepare_loaded(disass_context *ctx, char *name)
+ *
+ * return 0;  // if the data in ctx has been replaced by unpack_code()
+ * return -1; // if not
+ *
+ * warnings about the data loaded into ctx and -u, name is only used for the
+ * messages
+ * =============================================================================
+ */
+int prepare_loaded(disass_context *ctx, char *name)
+{
+    int         unpacked            = -1;
+
+    if (ctx->assembly.truncated)
+    {
+        fprintf(stderr, "Warning: \"%s\" doesn't fit into memory, %ld bytes ignored.\n",
+            name, ctx->assembly.truncated);
+    }
+
+    if (ctx->unpack_cycles > 0)
+    {
+        unpacked = unpack_code(ctx);
+        if (unpacked != 0)
+        {
+            fprintf(stderr, "Warning: nothing unpacked from \"%s\".\n", name);
+        }
+    }
+
+    return unpacked;
+}
+
 /* =============================================================================
  * char *newstr(char *initial_str)
  *
  * return new_str;
  * =============================================================================
  */
-char *newstr(char *initial_str)
+char *newstr(char *initial_str)
+{
+    int     num_chars;
+    char    *new_str;
+
+    num_chars = strlen(initial_str) + 1;
+    new_str = malloc (num_chars);
+
+    strcpy (new_str, initial_str);
+
+    return new_str;
+}
+
+/* =============================================================================
+ * int open_outputs(disass_context *ctx, const cli_options *options, const char *base,
+ *                  listing_output *outputs, int *fds)
+ *
+ * return 0;  // on success
+ * return -1; // if a file couldn't be written, nothing is left open then
+ *
+ * open the file of every format of -F but the first, see output_name().
+ * outputs and fds need room for SYNTAXES entries, ctx sends the disassembly
+ * to them until close_outputs().
+ * =============================================================================
+ */
+int open_outputs(disass_context *ctx, const cli_options *options, const char *base,
+    listing_output *outputs, int *fds)
+{
+    char    filename[4096];
+    int     i;
+
+    ctx->outputs = outputs;
+    ctx->outputs_count = 0;
+
+    for (i = 1; i < options->syntaxes_count; i++)
+    {
+        output_name(filename, sizeof(filename), base, options->syntaxes[i], 0);
+
+        fds[i-1] = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fds[i-1] < 0)
+        {
+            fprintf(stderr, "Error: couldn't write file \"%s\".\n", filename);
+            close_outputs(ctx, fds);
+            return -1;
+        }
+
+        outputs[i-1].syntax = options->syntaxes[i];
+        outputs[i-1].output = output_to_fd;
+        outputs[i-1].user = &fds[i-1];
+        ctx->outputs_count = i;
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * void output_name(char *dest, int size, const char *base, int syntax, int first)
+ *
+ * file name for the output of syntax: {base}.asm for the first format of -F,
+ * {base}.{format}.asm for any other assembler and {base}.jsonl etc. for an
+ * export
+ * =============================================================================
+ */
+void output_name(char *dest, int size, const char *base, int syntax, int first)
+{
+    if (syntaxes[syntax].extension != NULL)
+    {
+        snprintf(dest, size, "%s%s", base, syntaxes[syntax].extension);
+    }
+    else if (first)
+    {
+        snprintf(dest, size, "%s.asm", base);
+    }
+    else
+    {
+        snprintf(dest, size, "%s.%s.asm", base, syntaxes[syntax].name);
+    }
+}
+
+/* =============================================================================
+ * void petscii_name(char *dest, const char *name, int filename)
+ *
+ * convert a PETSCII file name (up to 16 characters) to ASCII, dest needs 17
+ * bytes. with filename set, everything but letters, digits, '-' and '.'
+ * becomes '_', so the result can be used as part of a file name.
+ * =============================================================================
+ */
+void petscii_name(char *dest, const char *name, int filename)
 {
-    int     num_chars;
-    char    *new_str;
+    int c;
 
-    num_chars = strlen(initial_str) + 1;
-    new_str = malloc (num_chars);
+    for (; *name != '\0'; name++, dest++)
+    {
+        c = (unsigned char)*name;
 
-    strcpy (new_str, initial_str);
+        if (c >= 0x41 && c <= 0x5A)
+        {
+            c += 0x20;      // unshifted letters are lower case
+        }
+        else if (c >= 0xC1 && c <= 0xDA)
+        {
+            c -= 0x80;
+        }
 
-    return new_str;
+        if (filename && !isalnum(c) && c != '-' && c != '.')
+        {
+            c = '_';
+        }
+        else if (c < 0x20 || c > 0x7E)
+        {
+            c = '_';
+        }
+
+        *dest = c;
+    }
+    *dest = '\0';
 }
 
 /* =============================================================================
@@ -962,116 +1331,69 @@ void print_bits(unsigned int x)
     printf("\n");
 }
 
-void print_disassembly()
+/* =============================================================================
+ * void print_cache_info(const result_cache *cache)
+ *
+ * report on stderr how much work the cache of -c saved, nothing without -c
+ * =============================================================================
+ */
+void print_cache_info(const result_cache *cache)
 {
-    int     i;
-    opcode  *current_opcode;
-    int     bytes_count         = 0;
-    int     bytes_per_row       = 8;
-    int     pc                  = pc_start;
+    if (cache == NULL)
+    {
+        return;
+    }
 
-    print_indent();
-    print_mode();
-    printf("\n");
+    fprintf(stderr, "cache: %ld hits, %ld misses, %ld stored\n",
+        cache->hits, cache->misses, cache->stores);
+}
+
+/* =============================================================================
+ * void print_header(disass_context *ctx, char *name, int skipbytes,
+ *                   int unpacked)
+ *
+ * the comment lines in front of each disassembly, see disassemble_loaded()
+ * =============================================================================
+ */
+void print_header(disass_context *ctx, char *name, int skipbytes, int unpacked)
+{
+    const char  *comment;
+    char        *infile_nopath;
+    int         start;
+    int         i;
 
-    print_indent();
-    printf("*= 0x%04x \n", pc);
+    infile_nopath = strrchr(name, '/');
+    infile_nopath = infile_nopath ? infile_nopath + 1 : name;
 
-    while (pc < pc_end)
-    {
-        i = pc - pc_start;
-        current_opcode = &opcodes[assembly.data[i]];
+    snprintf(ctx->assembly.name, sizeof(ctx->assembly.name), "%s", infile_nopath);
 
-        if (labelmap[pc] == 1)
+    // i == -1 is ctx->syntax, the others go straight to their output
+    for (i = -1; i < ctx->outputs_count; i++)
+    {
+        start = ctx->out.length;
+        comment = syntaxes[(i < 0) ? ctx->syntax : ctx->outputs[i].syntax].comment;
+        if (comment == NULL)
         {
-            printf("pc%04X:\n", pc);
+            continue;
         }
 
-        if (is_in_mode(assembly.data[i]) && datamap[pc] != DATATYPE_DATA)
+        output_printf(ctx, "%s input filename:   %s\n", comment, infile_nopath);
+        if (skipbytes >= 0)
         {
-            print_indent();
-
-            int bytes = current_opcode->bytes;
-            int operand = 0x0000;
-
-            switch (current_opcode->addressing_mode)
-            {
-            case ACC:
-            case IMP:
-            default:
-                break;
-            case IMM:
-            case ZP:
-            case ZPX:
-            case ZPY:
-            case INDX:
-            case INDY:
-                operand = assembly.data[i+1];
-                break;
-            case ABS:
-            case ABSI:
-            case ABSX:
-            case ABSY:
-                operand = (assembly.data[i+1]) + (assembly.data[i+2] << 8);
-                break;
-            case REL:
-                if (assembly.data[i+1] < 0x80)
-                {
-                    operand = pc + (assembly.data[i+1]) + 2;
-                }
-                else
-                {
-                    operand = pc - (0x100 - assembly.data[i+1]) + 2;
-                }
-                break;
-            }
-
-            print_instruction(*current_opcode, operand, pc);
-            // printf("        ; pc $%04X", pc);
-            printf("\n");
-
-            pc += bytes;
+            output_printf(ctx, "%s skip bytes:       %d\n", comment, skipbytes);
         }
-        else
+        if (unpacked == 0)
         {
-            if (datamap[pc-1] != DATATYPE_DATA || pc == pc_start)
-            {
-                // printf("pc%04X:\n", pc);
-                print_indent();
-                printf("!byte");
-                bytes_count = 0;
-            }
+            output_printf(ctx, "%s unpacked:         0x%04x - 0x%04x, entry 0x%04x after %ld cycles\n",
+                comment, ctx->pc_start, ctx->pc_end, ctx->entry, ctx->cpu->snapshot_cycles);
+        }
+        output_printf(ctx, "\n");
 
-            if (datamap[pc+1] == DATATYPE_CODE || datamap[pc+1] == DATATYPE_CODE_END || bytes_count == (bytes_per_row - 1))
-            {
-                printf(" 0x%02x\n", assembly.data[i]);
-                if (datamap[pc+1] == DATATYPE_DATA)
-                {
-                    print_indent();
-                    printf("!byte");
-                }
-                else
-                {
-                    // printf("pc%04X:\n", pc+1);
-                }
-                bytes_count = 0;
-            }
-            else
-            {
-                if (pc == (pc_end - 1))
-                {
-                    printf(" 0x%02x\n", assembly.data[i]);
-                }
-                else
-                {
-                    printf(" 0x%02x,", assembly.data[i]);
-                }
-                bytes_count++;
-            }
-            pc++;
+        if (i >= 0)
+        {
+            flush_output_to(ctx, start, &ctx->outputs[i]);
         }
-    };
-    // printf("\n");
+    }
 }
 
 /* =============================================================================
@@ -1083,6 +1405,11 @@ void print_help()
     printf("Usage:\n");
     printf("======\n");
     printf("   acmedisass [options] {file}\n");
+    printf("   acmedisass [options] -b {filelist|directory} [file...]\n");
+    printf("   acmedisass [options] {image.d64|image.d71|image.d81}...\n");
+    printf("   acmedisass [options] {tape.t64|cartridge.crt}...\n");
+    printf("   acmedisass xref {index} {address[-address]} [rwjc]\n");
+    printf("   acmedisass query {index} [address[-address]|mnemonic]...\n");
     printf("\n");
 
   //printf("===============================================================================\n");
@@ -1094,25 +1421,71 @@ void print_help()
     printf("                low-/highbyte combination in (skipbytes - 2)\n");
     printf("                will be used for initial program counter.\n");
     printf("                [default: 2]\n");
+    printf("   -f         : follow the control flow from the load address and the\n");
+    printf("                irq/nmi/reset vectors instead of guessing code.\n");
+    printf("                either way the targets of jump tables behind\n");
+    printf("                lda table,x / pha / rts and jmp (vector) become code\n");
+    printf("   -e address : additional entry point for -f, can be repeated.\n");
+    printf("                implies -f\n");
+    printf("   -t cycles  : run the program in a 6510 emulator for up to 'cycles'\n");
+    printf("                and use every executed address as entry point.\n");
+    printf("                implies -f\n");
+    printf("   -u cycles  : unpack. run the program for up to 'cycles' and\n");
+    printf("                disassemble the memory at the moment it jumps into\n");
+    printf("                the code it has unpacked, e.g. for crunched files\n");
+    printf("   -a file    : annotation file with forced code / data ranges, entry\n");
+    printf("                points and label names, one per line:\n");
+    printf("                  code 0x1000-0x10ff   data 0x2000-0x20ff\n");
+    printf("                  entry 0x1234         label 0x1000 main\n");
+    printf("   -d file    : signature file of known routines and tables, one per\n");
+    printf("                line: name, code or data and the bytes in hex, ?? for\n");
+    printf("                any byte:  sid_init code a2 18 a9 00 9d ?? d4 ca 10 fa\n");
+    printf("                every match gets the name as label, -a still wins\n");
+    printf("   -b list    : batch mode. disassemble every file named in textfile\n");
+    printf("                'list' (one per line) or every *.prg in directory\n");
+    printf("                'list'. writes one {name}.asm per input file.\n");
+    printf("                every PRG on a disk image (*.d64, *.d71, *.d81)\n");
+    printf("                is written to {image}_{name}.asm, also without -b\n");
+    printf("                the same goes for T64 files and CRT banks\n");
+    printf("                ({image}_bank{NN}_{address}.asm)\n");
+    printf("   -F formats : assembler syntax, one or more of acme, kickass, ca65\n");
+    printf("                and 64tass separated by ','. the first one is\n");
+    printf("                printed / written to {name}.asm, every other one\n");
+    printf("                to outdir/{name}.{format}.asm from the same run.\n");
+    printf("                jsonl and bin export every instruction / data row\n");
+    printf("                with pc, opcode, operand, mode, cycles and label as\n");
+    printf("                JSON Lines / fixed size records ({name}.jsonl / .bin),\n");
+    printf("                see src/export.c\n");
+    printf("                [default: acme]\n");
+    printf("   -o outdir  : output directory for batch mode and --watch\n");
+    printf("                [default: .]\n");
+    printf("   -w, --watch: keep running and write {name}.asm to outdir again\n");
+    printf("                whenever the file or the annotation file of -a\n");
+    printf("                changes, only the changed parts are redone\n");
+    printf("   -j threads : number of worker threads for batch mode\n");
+    printf("                [default: number of cpu cores]\n");
+    printf("   -c dir     : keep every result in cache directory 'dir' and reuse\n");
+    printf("                it for files with the same content and options.\n");
+    printf("                hits and misses are reported on stderr\n");
+    printf("   -x index   : write a cross reference index of the file to 'index'.\n");
+    printf("                list who reads (r), writes (w), jumps to (j) or calls\n");
+    printf("                (c) an address with: acmedisass xref index address\n");
+    printf("   -i index   : batch mode without .asm files. analyse every file and\n");
+    printf("                write the opcodes, referenced addresses and code size\n");
+    printf("                of all of them to 'index'. list the files that use\n");
+    printf("                all given mnemonics / addresses with\n");
+    printf("                  acmedisass query index 0xdd0d lax\n");
+    printf("   --stats[=file]: time every phase and count bytes, instructions and\n");
+    printf("                blocks per file and in total, peak memory. written\n");
+    printf("                as JSON to 'file' or stderr\n");
+    printf("   --cycles   : cycles of every instruction as a comment, with the\n");
+    printf("                range for page crossings and taken branches, and\n");
+    printf("                the fewest / most cycles of each straight-line\n");
+    printf("                block and of one pass through each loop\n");
     printf("\n");
     printf("Have fun!\n");
 }
 
-/* =============================================================================
- * void print_indent()
- *
- * print n spaces as indentation
- * =============================================================================
- */
-void print_indent()
-{
-    int i = 0;
-    for (i = 0; i < indent; i++)
-    {
-        printf(" ");
-    }
-}
-
 /* =============================================================================
  * void print_info()
  * =============================================================================
@@ -1131,137 +1504,534 @@ void print_info()
 }
 
 /* =============================================================================
- * void print_instruction(opcode opcode, int operand, int pc)
+ * void print_stats_report(FILE *file, char **names, const run_stats *stats,
+ *                         int count, int num_threads, const stats_clock *start)
  *
- * print cpu instruction
+ * --stats: one JSON object with the stats of every file, their sum, the wall
+ * clock and CPU time of the process since start and its peak memory. the
+ * phases of the files are per thread, so with several threads they add up
+ * to more than the wall clock time.
  * =============================================================================
  */
-void print_instruction(opcode opcode, int operand, int pc)
+void print_stats_report(FILE *file, char **names, const run_stats *stats, int count,
+    int num_threads, const stats_clock *start)
 {
-    printf("%s", opcode.name);
+    run_stats   total;
+    stats_clock end;
+    int         i;
 
-    int i       = pc - pc_start;
+    read_clock(&end, 1);
+    memset(&total, 0, sizeof(total));
 
-    if (assembly.data[i] == 0x4C && labelmap[operand] == 1)
+    fprintf(file, "{\n  \"files\": [");
+    for (i = 0; i < count; i++)
     {
-        printf(" pc%04X", pc);
-        return;
+        fprintf(file, "%s\n    {\"name\": ", i ? "," : "");
+        print_json_string(file, names[i]);
+        fprintf(file, ", \"stats\": ");
+        print_stats(file, &stats[i]);
+        fprintf(file, "}");
+
+        add_stats(&total, &stats[i]);
     }
 
-    int lobyte  = 0x00;
-    int hibyte  = 0x00;
+    fprintf(file, "\n  ],\n  \"total\": ");
+    print_stats(file, &total);
+    fprintf(file, ",\n  \"threads\": %d,\n  \"wall\": %.6f,\n  \"cpu\": %.6f,\n"
+        "  \"peak_memory_kb\": %ld\n}\n",
+        num_threads, end.wall - start->wall, end.cpu - start->cpu, peak_memory());
+    fflush(file);
+}
 
-    lobyte = operand & 0xFF;
+/* =============================================================================
+ * int query_corpus(int argc, char *argv[])
+ *
+ * return 0;  // on success
+ * return -1; // on invalid arguments or if the index couldn't be read
+ *
+ * acmedisass query index term...
+ *
+ * list every file in an index written with -i that matches all terms. a term
+ * is an address (range) the file has to reference or a mnemonic it has to
+ * use, e.g. "acmedisass query c64.idx 0xdd0d lax".
+ * =============================================================================
+ */
+int query_corpus(int argc, char *argv[])
+{
+    corpus_index        index;
+    unsigned long long  *matches;
+    unsigned long long  mask[4];
+    int                 words;
+    int                 start;
+    int                 end;
+    int                 count;
+    int                 found       = 0;
+    int                 i;
+    int                 j;
+
+    if (argc < 1)
+    {
+        printf("\nError: usage: acmedisass query index [address[-address]|mnemonic]...\n");
+        return -1;
+    }
 
-    if (operand > 0xFF)
+    if (load_corpus(&index, argv[0]) != 0)
     {
-        hibyte = (operand & 0xFF00) >> 8;
+        printf("\nError: couldn't read index file \"%s\".\n", argv[0]);
+        return -1;
     }
 
-    switch (opcode.addressing_mode)
+    words = (index.files_count + 63) / 64;
+    matches = malloc((words + 1) * sizeof(unsigned long long));
+    if (matches == NULL)
     {
-        case ACC:
-            // printf("a");
-            break;
-        case IMP:
-            break;
-        case IMM:
-            printf(" #0x%02x", lobyte);
-            break;
-        case ZP:
-            printf(" 0x%02x", lobyte);
-            break;
-        case ZPX:
-            printf(" 0x%02x,x", lobyte);
-            break;
-        case ZPY:
-            printf(" 0x%02x,y", lobyte);
-            break;
-        case ABS:
-            printf(" 0x%02x%02x", hibyte, lobyte);
-            break;
-        case ABSI:
-            printf(" (0x%02x%02x)", hibyte, lobyte);
-            break;
-        case ABSX:
-            printf(" 0x%02x%02x,x", hibyte, lobyte);
-            break;
-        case ABSY:
-            printf(" 0x%02x%02x,y", hibyte, lobyte);
-            break;
-        case INDX:
-            printf(" (0x%02x,x)", lobyte);
-            break;
-        case INDY:
-            printf(" (0x%02x),y", lobyte);
-            break;
-        case REL:
-            printf(" 0x%02x%02x", hibyte, lobyte);
-            break;
-        default:
-            break;
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(matches, 0xFF, (words + 1) * sizeof(unsigned long long));
+
+    for (i = 1; i < argc; i++)
+    {
+        count = sscanf(argv[i], "%i - %i", &start, &end);
+        if (count == 1)
+        {
+            end = start;
+        }
+
+        if (count >= 1)
+        {
+            if (start < 0 || end > 0xFFFF || end < start)
+            {
+                printf("\nError: invalid address \"%s\"\n", argv[i]);
+                return -1;
+            }
+            match_addresses(&index, start, end, matches);
+            continue;
+        }
+
+        memset(mask, 0, sizeof(mask));
+        for (j = 0; j < 256; j++)
+        {
+            if (opcodes[j].bytes > 0 && strcasecmp(opcodes[j].name, argv[i]) == 0)
+            {
+                mask[j / 64] |= 1ULL << (j % 64);
+            }
+        }
+        if ((mask[0] | mask[1] | mask[2] | mask[3]) == 0)
+        {
+            printf("\nError: neither an address nor a mnemonic: \"%s\"\n", argv[i]);
+            return -1;
+        }
+        match_opcodes(&index, mask, matches);
+    }
+
+    for (i = 0; i < index.files_count; i++)
+    {
+        if (matches[i / 64] & (1ULL << (i % 64)))
+        {
+            printf("%5.1f%% code  %s\n", (index.code_bytes[i] + index.data_bytes[i] > 0)
+                ? 100.0 * index.code_bytes[i] / (index.code_bytes[i] + index.data_bytes[i]) : 0.0,
+                index.names + index.name_offsets[i]);
+            found++;
+        }
+    }
+    fprintf(stderr, "%d of %d files\n", found, index.files_count);
+
+    free(matches);
+    close_corpus(&index);
+
+    return 0;
+}
+
+/* =============================================================================
+ * int query_xref(int argc, char *argv[])
+ *
+ * return 0;  // on success
+ * return -1; // on invalid arguments or if the index couldn't be read
+ *
+ * acmedisass xref index address[-address] [kinds]
+ *
+ * list who references the address (range) according to an index written
+ * with -x, optionally only references of the given kinds (r, w, j, c).
+ * =============================================================================
+ */
+int query_xref(int argc, char *argv[])
+{
+    xref_index  xref;
+    char        kind_name[5];
+    int         filter          = XREF_READ | XREF_WRITE | XREF_JUMP | XREF_CALL;
+    int         start;
+    int         end;
+    int         count;
+    int         kind;
+    int         i;
+    int         j;
+
+    if (argc < 2 || argc > 3)
+    {
+        printf("\nError: usage: acmedisass xref index address[-address] [rwjc]\n");
+        return -1;
+    }
+
+    count = sscanf(argv[1], "%i - %i", &start, &end);
+    if (count == 1)
+    {
+        end = start;
+    }
+    if (count < 1 || start < 0 || end > 0xFFFF || end < start)
+    {
+        printf("\nError: invalid address \"%s\"\n", argv[1]);
+        return -1;
+    }
+
+    if (argc == 3)
+    {
+        filter = 0;
+        for (i = 0; argv[2][i] != '\0'; i++)
+        {
+            switch (argv[2][i])
+            {
+            case 'r': filter |= XREF_READ; break;
+            case 'w': filter |= XREF_WRITE; break;
+            case 'j': filter |= XREF_JUMP; break;
+            case 'c': filter |= XREF_CALL; break;
+            default:
+                printf("\nError: invalid kind '%c', use r, w, j or c\n", argv[2][i]);
+                return -1;
+            }
+        }
+    }
+
+    if (load_xref(&xref, argv[0]) != 0)
+    {
+        printf("\nError: couldn't read index file \"%s\".\n", argv[0]);
+        return -1;
+    }
+
+    for (i = find_xref(&xref, start); i < xref.count && xref_target(&xref, i) <= end; i++)
+    {
+        kind = xref_kind(&xref, i);
+        if ((kind & filter) == 0)
+        {
+            continue;
+        }
+
+        j = 0;
+        if (kind & XREF_READ)  kind_name[j++] = 'r';
+        if (kind & XREF_WRITE) kind_name[j++] = 'w';
+        if (kind & XREF_JUMP)  kind_name[j++] = 'j';
+        if (kind & XREF_CALL)  kind_name[j++] = 'c';
+        kind_name[j] = '\0';
+
+        printf("0x%04x  %-2s  0x%04x\n", xref_target(&xref, i), kind_name, xref_pc(&xref, i));
     }
-    // printf("\n");
+
+    free_xref(&xref);
+
+    return 0;
 }
 
 /* =============================================================================
- * void print_mode()
+ * void setup_context(disass_context *ctx, cli_options *options)
  *
- * print acme cpu pseudo-op according to mode
+ * apply the command line options to a freshly allocated ctx
  * =============================================================================
  */
-void print_mode()
+void setup_context(disass_context *ctx, cli_options *options)
 {
-    switch (mode)
+    int i;
+
+    ctx->mode = options->mode;
+    ctx->syntax = options->syntaxes[0];
+    ctx->flow = options->flow;
+    ctx->trace_cycles = options->trace_cycles;
+    ctx->unpack_cycles = options->unpack_cycles;
+    ctx->timing = options->timing;
+    ctx->cache = options->cache;
+    ctx->notes = options->notes;
+    ctx->signatures = options->signatures;
+
+    for (i = 0; i < options->entries.count; i++)
     {
-        case MODE6502:
-        default:
-            printf("!cpu 6502");
-            break;
-        case MODE6510:
-            printf("!cpu 6510");
+        add_entry(ctx, options->entries.addresses[i]);
+    }
+}
+
+/* =============================================================================
+ * int watch_changes(int fd, const char *filename, const char *notes_name)
+ *
+ * return WATCH_INPUT | WATCH_NOTES; // which of the files have changed
+ *
+ * wait for inotify events on fd for the directories of filename and
+ * notes_name. editors write a file in several steps or rename a new one over
+ * it, so everything arriving within WATCH_SETTLE ms is collected as well.
+ * =============================================================================
+ */
+int watch_changes(int fd, const char *filename, const char *notes_name)
+{
+    const struct inotify_event  *event;
+    struct pollfd               pfd;
+    char                        events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const char                  *infile_nopath;
+    const char                  *notes_nopath   = NULL;
+    ssize_t                     length;
+    ssize_t                     i;
+    int                         changed         = 0;
+
+    infile_nopath = strrchr(filename, '/');
+    infile_nopath = infile_nopath ? infile_nopath + 1 : filename;
+    if (notes_name != NULL)
+    {
+        notes_nopath = strrchr(notes_name, '/');
+        notes_nopath = notes_nopath ? notes_nopath + 1 : notes_name;
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    // block until the first event, then only as long as more are coming
+    while (changed == 0 || poll(&pfd, 1, WATCH_SETTLE) > 0)
+    {
+        length = read(fd, events, sizeof(events));
+        if (length <= 0)
+        {
             break;
+        }
+
+        for (i = 0; i < length; i += sizeof(struct inotify_event) + event->len)
+        {
+            event = (const struct inotify_event *)(events + i);
+            if (event->len == 0)
+            {
+                continue;
+            }
+
+            if (strcmp(event->name, infile_nopath) == 0)
+            {
+                changed |= WATCH_INPUT;
+            }
+            if (notes_nopath != NULL && strcmp(event->name, notes_nopath) == 0)
+            {
+                changed |= WATCH_NOTES;
+            }
+        }
     }
 
-    printf("\n");
+    return changed;
 }
 
 /* =============================================================================
- * virtual_file read_file(char *filename, int skipbytes)
- * return vfile;
+ * int watch_file(cli_options *options, char *filename, char *outdir)
  *
- * reads a file into memory as "virtual_file" that includes:
- *      filename
- *      array of data
- *      filelength
+ * return -1; // if filename couldn't be read at the start, never returns
+ *            // otherwise
+ *
+ * --watch: disassemble filename to outdir/{name}.asm and do it again every
+ * time filename or the annotation file change. the context and project stay
+ * alive, so only what has changed is analysed and printed again (see
+ * update_project() and reload_project()). the .asm is only written when its
+ * content changes. filename is copied rather than mapped, a mapping would
+ * change under the context when the file is written in place.
  * =============================================================================
  */
-virtual_file read_file(char *filename, int skipbytes)
+int watch_file(cli_options *options, char *filename, char *outdir)
 {
-    FILE    *infile             = NULL;
-    int     i                   = 0;
-    int     input_data          = 0;
-    virtual_file vfile;
+    disass_context  *ctx;
+    mapped_file     file;
+    output_buffer   input;
+    output_buffer   new_input;
+    output_buffer   swap;
+    output_buffer   output;
+    output_buffer   written;
+    project         prj;
+    struct timespec start;
+    struct timespec end;
+    char            outfile_name[4096];
+    char            dir[4096];
+    char            *infile_nopath;
+    char            *ext;
+    int             changed;
+    int             fd;
+    int             len;
+    int             result;
+    int             unpacked;
+
+    infile_nopath = strrchr(filename, '/');
+    infile_nopath = infile_nopath ? infile_nopath + 1 : filename;
+    ext = strrchr(infile_nopath, '.');
+    len = ext ? (int)(ext - infile_nopath) : (int)strlen(infile_nopath);
+    snprintf(outfile_name, sizeof(outfile_name), "%s/%.*s.asm", outdir, len, infile_nopath);
+
+    memset(&input, 0, sizeof(input));
+    memset(&new_input, 0, sizeof(new_input));
+    memset(&output, 0, sizeof(output));
+    memset(&written, 0, sizeof(written));
+
+    if (open_project(&prj, options->notes_name) != 0)
+    {
+        printf("\nError: couldn't read annotation file \"%s\".\n", options->notes_name);
+        return -1;
+    }
+
+    ctx = new_context();
+    setup_context(ctx, options);
+    set_output(ctx, output_to_buffer, &output);
 
-    infile = fopen(filename, "rb");
-    if (infile == NULL)
+    if (map_file(&file, filename) != 0)
     {
         printf("\nError: couldn't read file \"%s\".\n", filename);
-        exit(EXIT_FAILURE);
+        return -1;
+    }
+    output_to_buffer(&input, (const char *)file.data, file.size);
+    unmap_file(&file);
+
+    if (load_prg(ctx, (unsigned char *)input.data, input.length, options->skipbytes) != 0)
+    {
+        printf("\nError: couldn't read file \"%s\".\n", filename);
+        return -1;
+    }
+
+    unpacked = prepare_loaded(ctx, filename);
+    print_header(ctx, filename, options->skipbytes, unpacked);
+    disassemble_project(ctx, &prj);
+
+    fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0)
+    {
+        printf("\nError: inotify isn't available.\n");
+        return -1;
+    }
+
+    // watch the directories, editors and linkers often replace the file
+    snprintf(dir, sizeof(dir), "%s", filename);
+    inotify_add_watch(fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (options->notes_name != NULL)
+    {
+        snprintf(dir, sizeof(dir), "%s", options->notes_name);
+        inotify_add_watch(fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+
+    for (;;)
+    {
+        if (output.length > 0 && (output.length != written.length
+            || memcmp(output.data, written.data, output.length) != 0))
+        {
+            if (write_file(outfile_name, &output) != 0)
+            {
+                fprintf(stderr, "Error: couldn't write file \"%s\".\n", outfile_name);
+            }
+            else
+            {
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                fprintf(stderr, "%s written, %d of %d segments printed",
+                    outfile_name, prj.printed, prj.printed + prj.reused);
+                if (written.data != NULL)
+                {
+                    fprintf(stderr, " in %.1f ms", (end.tv_sec - start.tv_sec) * 1e3
+                        + (end.tv_nsec - start.tv_nsec) / 1e6);
+                }
+                fprintf(stderr, "\n");
+            }
+
+            written.length = 0;
+            output_to_buffer(&written, output.data, output.length);
+        }
+        output.length = 0;
+
+        changed = watch_changes(fd, filename, options->notes_name);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        if (changed & WATCH_NOTES)
+        {
+            print_header(ctx, filename, options->skipbytes, unpacked);
+            result = update_project(ctx, &prj, options->notes_name);
+            if (result != 0)
+            {
+                fprintf(stderr, (result < 0) ? "Error: couldn't read annotation file \"%s\".\n"
+                    : "Error: %s:%d: invalid annotation.\n", options->notes_name, result);
+                output.length = 0;
+            }
+        }
+
+        if (!(changed & WATCH_INPUT))
+        {
+            continue;
+        }
+
+        if (map_file(&file, filename) != 0)
+        {
+            fprintf(stderr, "Error: couldn't read file \"%s\".\n", filename);
+            continue;
+        }
+        new_input.length = 0;
+        output_to_buffer(&new_input, (const char *)file.data, file.size);
+        unmap_file(&file);
+
+        if (new_input.length == input.length
+            && memcmp(new_input.data, input.data, input.length) == 0)
+        {
+            continue;
+        }
+
+        if (load_prg(ctx, (unsigned char *)new_input.data, new_input.length, options->skipbytes) != 0)
+        {
+            fprintf(stderr, "Error: couldn't read file \"%s\".\n", filename);
+
+            // ctx has been reset, go on with the last good file
+            load_prg(ctx, (unsigned char *)input.data, input.length, options->skipbytes);
+            prepare_loaded(ctx, filename);
+            disassemble_project(ctx, &prj);
+            output.length = 0;
+            continue;
+        }
+
+        swap = input;
+        input = new_input;
+        new_input = swap;
+
+        output.length = 0;
+        unpacked = prepare_loaded(ctx, filename);
+        print_header(ctx, filename, options->skipbytes, unpacked);
+        reload_project(ctx, &prj);
     }
+}
+
+/* =============================================================================
+ * int write_file(const char *filename, const output_buffer *buffer)
+ *
+ * return 0;  // on success
+ * return -1; // if filename couldn't be written, the old one is kept then
+ *
+ * write buffer to a temporary file next to filename and rename() it, so
+ * whoever watches filename never sees half of it
+ * =============================================================================
+ */
+int write_file(const char *filename, const output_buffer *buffer)
+{
+    char    tempname[4200];
+    int     fd;
 
-    // forward infile according to skipbytes
-    fseek(infile, skipbytes, 0);
+    snprintf(tempname, sizeof(tempname), "%s.XXXXXX", filename);
+    fd = mkstemp(tempname);
+    if (fd < 0)
+    {
+        return -1;
+    }
 
-    while  ((input_data = fgetc(infile)) != EOF)
+    // a short write must not replace the last good file
+    if (write_fd(fd, buffer->data, buffer->length) != 0)
     {
-        vfile.data[i] = input_data;
-        i++;
+        close(fd);
+        unlink(tempname);
+        return -1;
     }
-    vfile.length = i;
+    fchmod(fd, 0644);
 
-    strcpy(vfile.name, filename);
+    if (close(fd) != 0 || rename(tempname, filename) != 0)
+    {
+        unlink(tempname);
+        return -1;
+    }
 
-    fclose(infile);
-    return vfile;
+    return 0;
 }
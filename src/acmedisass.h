@@ -1,46 +1,111 @@
 #ifndef ACMEDISASS_H_
 #define ACMEDISASS_H_
 
+#include <pthread.h>
+#include "cache.h"
+#include "container.h"
+#include "corpus.h"
+#include "disass.h"
+#include "disk.h"
+#include "emu.h"
+#include "input.h"
+#include "listing.h"
+#include "project.h"
+#include "signature.h"
+#include "stats.h"
+#include "xref.h"
+
 #define VERSION         "1.0"
-#define MAX_FILESIZE    0xFFFF
-#define DEFAULT_INDENT  20
 
+#define WATCH_INPUT     1       // see watch_changes()
+#define WATCH_NOTES     2
+#define WATCH_SETTLE    20      // ms
+
+/* everything set on the command line that goes into each disass_context,
+ * see setup_context()
+ */
 typedef struct
 {
-    char name[128];
-    int data[MAX_FILESIZE];
-    int length;
-} virtual_file;
+    int             mode;
+    int             skipbytes;
+    int             flow;
+    long            trace_cycles;
+    long            unpack_cycles;
+    address_list    entries;
+    result_cache    *cache;         // -c, NULL without
+    annotations     *notes;         // -a, NULL without
+    char            *notes_name;    // file name of -a for --watch
+    signature_db    *signatures;    // -d, NULL without
+    int             syntaxes[SYNTAXES]; // -F, the first one goes to stdout / {name}.asm
+    int             syntaxes_count;
+    int             timing;         // --cycles
+} cli_options;
 
+/* one job of a batch, either a plain file, a file on a disk image or an
+ * entry of a T64 / CRT container
+ */
 typedef struct
 {
-    char name[3];
-    int bytes;
-    int cycles;
-    int addressing_mode;
-} opcode;
+    char        *name;      // name of the file, disk image or container
+    disk_image  *disk;      // NULL if not on a disk image
+    container   *cont;      // NULL if not in a container
+    int         entry;      // index into disk->entries or cont->entries
+} batch_file;
 
 typedef struct
 {
-    int pc_start;
-    int pc_end;     // make sure to set this to pc *after* the last instruction
-    int type;       // DATATYPE_DATA or DATATYPE_CODE
-} datablock;
-
-void create_datamap();
-void create_labelmap();
-void fill_datablocks();
-int get_pc(char *filename, int skipbytes);
-int is_in_array(int needle, int haystack[], int haystack_len);
-int is_in_mode(int opcode);
+    batch_file  *files;
+    int     files_count;
+    int     next_file;
+    int     failed;
+    disk_image  **disks;    // opened once, shared by all workers
+    int     disks_count;
+    container   **conts;    // same for containers
+    int     conts_count;
+    cli_options *options;
+    char    *outdir;
+    char    *index_name;    // -i, NULL: write the .asm files
+    file_summary *summaries;    // one per file with -i
+    FILE    *stats_file;    // --stats, NULL without
+    run_stats   *stats;     // one per file with --stats
+    pthread_mutex_t lock;   // guards next_file and failed
+} batch_jobs;
+
+void batch_add_container(batch_jobs *jobs, char *filename);
+void batch_add_disk(batch_jobs *jobs, char *filename);
+void batch_add_file(batch_jobs *jobs, char *filename);
+void batch_add_job(batch_jobs *jobs, char *name, disk_image *disk, container *cont, int entry);
+int batch_collect(batch_jobs *jobs, char *listname);
+int batch_disassemble(batch_jobs *jobs, int num_threads);
+void batch_job_name(const batch_file *job, char *name, int size);
+void *batch_worker(void *arg);
+void close_outputs(disass_context *ctx, int *fds);
+int compare_strings(const void *a, const void *b);
+int disassemble_block(disass_context *ctx, char *name, const unsigned char *data,
+    int length, int pc);
+int disassemble_data(disass_context *ctx, char *name, const unsigned char *data,
+    size_t size, int skipbytes);
+int disassemble_file(disass_context *ctx, char *filename, int skipbytes);
+void disassemble_loaded(disass_context *ctx, char *name, int skipbytes);
+int is_input_file(const char *filename);
+int prepare_loaded(disass_context *ctx, char *name);
+int open_outputs(disass_context *ctx, const cli_options *options, const char *base,
+    listing_output *outputs, int *fds);
+void output_name(char *dest, int size, const char *base, int syntax, int first);
+void petscii_name(char *dest, const char *name, int filename);
 void print_bits(unsigned int x);
-void print_disassembly();
+void print_cache_info(const result_cache *cache);
+void print_header(disass_context *ctx, char *name, int skipbytes, int unpacked);
 void print_help();
-void print_indent();
 void print_info();
-void print_instruction(opcode opcode, int operand, int pc);
-void print_mode();
+void print_stats_report(FILE *file, char **names, const run_stats *stats, int count,
+    int num_threads, const stats_clock *start);
+int query_corpus(int argc, char *argv[]);
+int query_xref(int argc, char *argv[]);
 char *newstr(char *initial_str);
-virtual_file read_file(char *filename, int skipbytes);
+void setup_context(disass_context *ctx, cli_options *options);
+int watch_changes(int fd, const char *filename, const char *notes_name);
+int watch_file(cli_options *options, char *filename, char *outdir);
+int write_file(const char *filename, const output_buffer *buffer);
 
 #endif // ACMEDISASS_H_
@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "disass.h"
+#include "listing.h"
+
+#define TOKEN_SYS   0x9E
+
+/* =============================================================================
+ * BASIC stubs
+ *
+ * most programs start with a tokenized BASIC line like "10 SYS2061" that
+ * starts the machine code. every BASIC line is stored as
+ *
+ *      +0  link    address of the next line, 0x0000 ends the program
+ *      +2  number  line number
+ *      +4  tokens  tokenized text, terminated by 0x00
+ *
+ * the stub is only accepted if all links point exactly behind their line, the
+ * program ends with a 0x0000 link inside the file and there is a SYS token
+ * followed by an address. anything else is left to the normal analysis.
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * int parse_basic(disass_context *ctx)
+ *
+ * return address;  // SYS target of the BASIC stub at pc_start
+ * return -1;       // if there is no valid BASIC stub
+ *
+ * sets ctx->basic_end to the address behind the stub and ctx->sys_address and
+ * ctx->entry to the SYS target, or basic_end / sys_address to "no stub"
+ * (pc_start / -1)
+ * =============================================================================
+ */
+int parse_basic(disass_context *ctx)
+{
+    int line        = ctx->pc_start;
+    int link;
+    int pc;
+    int sys_address = -1;
+
+    ctx->basic_end = ctx->pc_start;
+    ctx->sys_address = -1;
+
+    for (;;)
+    {
+        if (line + 2 > ctx->pc_end)
+        {
+            return -1;
+        }
+
+        link = get_byte(ctx, line - ctx->pc_start)
+            + (get_byte(ctx, line + 1 - ctx->pc_start) << 8);
+        if (link == 0x0000)
+        {
+            break;
+        }
+
+        // line text ends with 0x00 right before the next line
+        if (link <= line + 4 || link > ctx->pc_end
+            || get_byte(ctx, link - 1 - ctx->pc_start) != 0x00)
+        {
+            return -1;
+        }
+
+        for (pc = line + 4; pc < link - 1; pc++)
+        {
+            if (get_byte(ctx, pc - ctx->pc_start) == 0x00)
+            {
+                return -1;
+            }
+
+            if (get_byte(ctx, pc - ctx->pc_start) == TOKEN_SYS && sys_address < 0)
+            {
+                sys_address = parse_sys(ctx, pc + 1, link - 1);
+            }
+        }
+
+        line = link;
+    }
+
+    if (sys_address < 0)
+    {
+        return -1;
+    }
+
+    ctx->basic_end = line + 2;
+    ctx->sys_address = sys_address;
+    ctx->entry = sys_address;
+
+    return sys_address;
+}
+
+/* =============================================================================
+ * int parse_sys(disass_context *ctx, int pc, int pc_end)
+ *
+ * return address;  // decimal number in front of pc_end, as in "SYS (2061)"
+ * return -1;       // if there is none or it's beyond 0xFFFF
+ * =============================================================================
+ */
+int parse_sys(disass_context *ctx, int pc, int pc_end)
+{
+    int address = 0;
+    int digits  = 0;
+    int c;
+
+    while (pc < pc_end && (get_byte(ctx, pc - ctx->pc_start) == ' '
+        || get_byte(ctx, pc - ctx->pc_start) == '('))
+    {
+        pc++;
+    }
+
+    for (; pc < pc_end; pc++)
+    {
+        c = get_byte(ctx, pc - ctx->pc_start);
+        if (c < '0' || c > '9')
+        {
+            break;
+        }
+
+        address = address * 10 + c - '0';
+        if (address > 0xFFFF)
+        {
+            return -1;
+        }
+        digits++;
+    }
+
+    return digits ? address : -1;
+}
+
+/* =============================================================================
+ * int is_pet_char(int c)
+ *
+ * return 1; // if c can be printed as text, see LINE_TEXT
+ *
+ * !pet turns a-z into 0x41-0x5A, quotes would need escaping
+ * =============================================================================
+ */
+static int is_pet_char(int c)
+{
+    return c >= 0x20 && c <= 0x5A && c != '"';
+}
+
+/* =============================================================================
+ * void list_basic(disass_context *ctx, listing *list)
+ *
+ * add the BASIC stub between pc_start and basic_end to list as words, bytes
+ * and text
+ * =============================================================================
+ */
+void list_basic(disass_context *ctx, listing *list)
+{
+    int line    = ctx->pc_start;
+    int link;
+    int pc;
+    int start;
+
+    if (is_label(ctx, line))
+    {
+        append_line(list, LINE_LABEL, 0, line, 0, 0);
+    }
+
+    while (line + 2 < ctx->basic_end)
+    {
+        link = get_byte(ctx, line - ctx->pc_start)
+            + (get_byte(ctx, line + 1 - ctx->pc_start) << 8);
+
+        append_line(list, LINE_WORD, 0, line, 2, link);
+        append_line(list, LINE_WORD, LINE_DECIMAL, line + 2, 2,
+            get_byte(ctx, line + 2 - ctx->pc_start) + (get_byte(ctx, line + 3 - ctx->pc_start) << 8));
+
+        pc = line + 4;
+        while (pc < link - 1)
+        {
+            if (is_pet_char(get_byte(ctx, pc - ctx->pc_start)))
+            {
+                for (start = pc; pc < link - 1 && is_pet_char(get_byte(ctx, pc - ctx->pc_start)); pc++)
+                {
+                }
+                append_line(list, LINE_TEXT, 0, start, pc - start, 0);
+            }
+            else
+            {
+                append_line(list, LINE_BYTES, LINE_OPEN | LINE_END, pc, 1, 0);
+                pc++;
+            }
+        }
+
+        // the 0x00 at the end of the line
+        append_line(list, LINE_BYTES, LINE_OPEN | LINE_END, pc, 1, 0);
+
+        line = link;
+    }
+
+    append_line(list, LINE_WORD, 0, line, 2, 0x0000);
+}
@@ -0,0 +1,247 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../disk.h"
+
+/* =============================================================================
+ * check: files with broken sector chains on a D64
+ *
+ *      bench_disk [acmedisass]
+ *
+ * writes a D64 to a temporary directory with three PRGs:
+ *
+ *      GOOD    3 sectors at 1/0 - 1/2, 600 bytes
+ *      BROKEN  1/3 -> 1/4 -> 1/5 -> 99/0, a track the disk doesn't have
+ *      LOOP    1/6 -> 1/7 -> 1/6 ...
+ *
+ * read_disk_file() has to return the length of GOOD and -1 for the others,
+ * without touching the buffer for a negative size. then acmedisass (default
+ * ./acmedisass) runs on the image: it has to fail without a crash, write
+ * good.asm and leave no output behind for the broken files.
+ * =============================================================================
+ */
+
+#define D64_SIZE    174848
+#define GOOD_LENGTH 600
+
+/* =============================================================================
+ * long d64_offset(int track, int sector)
+ *
+ * return offset; // of a sector on tracks 1 - 18
+ * =============================================================================
+ */
+long d64_offset(int track, int sector)
+{
+    return ((track - 1) * 21L + sector) * 256;
+}
+
+/* =============================================================================
+ * void add_file(unsigned char *image, int entry, const char *name, int track,
+ *      int sector)
+ *
+ * directory entry number entry for a PRG that starts at track / sector
+ * =============================================================================
+ */
+void add_file(unsigned char *image, int entry, const char *name, int track, int sector)
+{
+    unsigned char   *dir_entry  = image + d64_offset(18, 1) + entry * 32;
+    int             i;
+
+    dir_entry[2] = 0x82;
+    dir_entry[3] = track;
+    dir_entry[4] = sector;
+    for (i = 0; i < 16; i++)
+    {
+        dir_entry[5 + i] = (i < (int)strlen(name)) ? name[i] : 0xA0;
+    }
+    dir_entry[30] = 3;
+}
+
+/* =============================================================================
+ * void link_sector(unsigned char *image, int sector, int next_track, int next_sector)
+ *
+ * make track 1 / sector point to the next one
+ * =============================================================================
+ */
+void link_sector(unsigned char *image, int sector, int next_track, int next_sector)
+{
+    image[d64_offset(1, sector)] = next_track;
+    image[d64_offset(1, sector) + 1] = next_sector;
+}
+
+/* =============================================================================
+ * int check_reads(const char *filename)
+ *
+ * return errors; // of read_disk_file() on the image
+ * =============================================================================
+ */
+int check_reads(const char *filename)
+{
+    disk_image      disk;
+    unsigned char   buffer[GOOD_LENGTH + 1];
+    long            length;
+    int             errors      = 0;
+    int             i;
+
+    if (open_disk(&disk, filename) != 0 || disk.entries_count != 3)
+    {
+        printf("open_disk(): can't read the directory\n");
+        return 1;
+    }
+
+    memset(buffer, 0x55, sizeof(buffer));
+    length = read_disk_file(&disk, &disk.entries[0], buffer, sizeof(buffer));
+    for (i = 2; i < GOOD_LENGTH && buffer[i] == (i & 0xFF); i++)
+    {
+    }
+    if (length != GOOD_LENGTH || i != GOOD_LENGTH || buffer[GOOD_LENGTH] != 0x55)
+    {
+        printf("GOOD: length %ld, bytes differ at %d\n", length, i);
+        errors++;
+    }
+
+    for (i = 1; i < 3; i++)
+    {
+        memset(buffer, 0x55, sizeof(buffer));
+        length = read_disk_file(&disk, &disk.entries[i], NULL, 0);
+        if (length != -1)
+        {
+            printf("%s: length %ld, not -1\n", disk.entries[i].name, length);
+            errors++;
+        }
+
+        read_disk_file(&disk, &disk.entries[i], buffer, length);
+        if (buffer[0] != 0x55)
+        {
+            printf("%s: buffer written with a size of -1\n", disk.entries[i].name);
+            errors++;
+        }
+    }
+
+    close_disk(&disk);
+
+    return errors;
+}
+
+/* =============================================================================
+ * int check_batch(const char *acmedisass, const char *dir, const char *filename)
+ *
+ * return errors; // of acmedisass on the image
+ * =============================================================================
+ */
+int check_batch(const char *acmedisass, const char *dir, const char *filename)
+{
+    DIR             *listing;
+    struct dirent   *file;
+    char            command[2048];
+    int             status;
+    int             errors      = 0;
+    int             good        = 0;
+
+    snprintf(command, sizeof(command), "%s -o %s %s > /dev/null 2>&1", acmedisass, dir, filename);
+    status = system(command);
+
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_FAILURE)
+    {
+        printf("acmedisass: didn't fail cleanly, status 0x%x\n", status);
+        errors++;
+    }
+
+    listing = opendir(dir);
+    while (listing != NULL && (file = readdir(listing)) != NULL)
+    {
+        if (strcmp(file->d_name, "broken.d64") == 0 || file->d_name[0] == '.')
+        {
+            continue;
+        }
+        if (strcmp(file->d_name, "broken_good.asm") == 0)
+        {
+            good = 1;
+        }
+        else
+        {
+            printf("acmedisass: left %s behind\n", file->d_name);
+            errors++;
+        }
+
+        snprintf(command, sizeof(command), "%s/%s", dir, file->d_name);
+        unlink(command);
+    }
+    if (listing != NULL)
+    {
+        closedir(listing);
+    }
+
+    if (!good)
+    {
+        printf("acmedisass: no broken_good.asm\n");
+        errors++;
+    }
+
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    FILE            *file;
+    unsigned char   *image;
+    char            dir[]           = "/tmp/bench_disk_XXXXXX";
+    char            filename[64];
+    int             errors;
+    int             i;
+
+    image = calloc(D64_SIZE, 1);
+    if (image == NULL || mkdtemp(dir) == NULL)
+    {
+        printf("\nError: can't set up the image\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the directory ends with its first sector
+    image[d64_offset(18, 1) + 1] = 0xFF;
+
+    add_file(image, 0, "GOOD", 1, 0);
+    link_sector(image, 0, 1, 1);
+    link_sector(image, 1, 1, 2);
+    link_sector(image, 2, 0, GOOD_LENGTH - 2 * 254 + 1);
+    for (i = 0; i < GOOD_LENGTH; i++)
+    {
+        image[d64_offset(1, i / 254) + 2 + i % 254] = (i < 2) ? ((i == 0) ? 0x00 : 0x10) : i;
+    }
+
+    add_file(image, 1, "BROKEN", 1, 3);
+    link_sector(image, 3, 1, 4);
+    link_sector(image, 4, 1, 5);
+    link_sector(image, 5, 99, 0);
+
+    add_file(image, 2, "LOOP", 1, 6);
+    link_sector(image, 6, 1, 7);
+    link_sector(image, 7, 1, 6);
+
+    snprintf(filename, sizeof(filename), "%s/broken.d64", dir);
+    file = fopen(filename, "wb");
+    if (file == NULL || fwrite(image, 1, D64_SIZE, file) != D64_SIZE || fclose(file) != 0)
+    {
+        printf("\nError: couldn't write \"%s\"\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    free(image);
+
+    errors = check_reads(filename);
+    errors += check_batch((argc > 1) ? argv[1] : "./acmedisass", dir, filename);
+
+    unlink(filename);
+    rmdir(dir);
+
+    if (errors > 0)
+    {
+        printf("\nError: %d checks of broken sector chains failed\n", errors);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("broken sector chains: ok\n");
+    exit(EXIT_SUCCESS);
+}
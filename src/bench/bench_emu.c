@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../disass.h"
+#include "../emu.h"
+
+/* =============================================================================
+ * microbenchmark: run_cpu() speed
+ *
+ * an endless loop that adds 1 to 256 bytes and calls a subroutine after each
+ * round, so loads, stores, indexed addressing, branches and jsr / rts are all
+ * in the mix. reports emulated instructions and cycles per second.
+ *
+ * before that every opcode that doesn't jump is run once on its own, the pc
+ * has to move on by the length of its addressing mode.
+ * =============================================================================
+ */
+
+#define CYCLES      200000000L
+
+unsigned char program[] = {
+    0xA2, 0x00,             // 1000 ldx #0x00
+    0xBD, 0x00, 0x20,       // 1002 lda 0x2000,x
+    0x18,                   // 1005 clc
+    0x69, 0x01,             // 1006 adc #0x01
+    0x9D, 0x00, 0x20,       // 1008 sta 0x2000,x
+    0xE8,                   // 100B inx
+    0xD0, 0xF4,             // 100C bne 0x1002
+    0xEE, 0x00, 0x21,       // 100E inc 0x2100
+    0x20, 0x17, 0x10,       // 1011 jsr 0x1017
+    0x4C, 0x00, 0x10,       // 1014 jmp 0x1000
+    0xAD, 0x00, 0x21,       // 1017 lda 0x2100
+    0x0A,                   // 101A asl
+    0x60                    // 101B rts
+};
+
+/* =============================================================================
+ * int check_steps()
+ *
+ * return errors; // opcodes whose pc step isn't the length of their mode
+ * =============================================================================
+ */
+int check_steps()
+{
+    static const int    mode_bytes[] = {
+        [NONE] = 1, [ACC] = 1, [IMP] = 1, [IMM] = 2, [ZP] = 2, [ZPX] = 2, [ZPY] = 2,
+        [ABS] = 3, [ABSX] = 3, [ABSY] = 3, [ABSI] = 3, [INDX] = 2, [INDY] = 2, [REL] = 2
+    };
+    unsigned char       code[3]     = { 0x00, 0x00, 0x00 };
+    disass_context      *ctx;
+    cpu6510             *cpu;
+    int                 errors      = 0;
+    int                 opcode;
+
+    ctx = new_context();
+    cpu = new_cpu();
+
+    for (opcode = 0; opcode < 0x100; opcode++)
+    {
+        // brk, jsr, rti, jmp, rts and jam don't go on to the next instruction,
+        // a branch by 0 does either way
+        if (opcode == 0x00 || opcode == 0x20 || opcode == 0x40 || opcode == 0x4C
+            || opcode == 0x60 || opcode == 0x6C || memcmp(opcodes[opcode].name, "jam", 3) == 0)
+        {
+            continue;
+        }
+
+        code[0] = opcode;
+        load_buffer(ctx, code, sizeof(code), 0x1000);
+        reset_cpu(cpu, ctx);
+        run_cpu(cpu, 1);
+
+        if (cpu->pc != 0x1000 + mode_bytes[opcodes[opcode].addressing_mode]
+            || opcodes[opcode].bytes != mode_bytes[opcodes[opcode].addressing_mode])
+        {
+            printf("opcode 0x%02x %.3s: pc +%d, %d bytes in opcodes[], mode needs %d\n", opcode,
+                opcodes[opcode].name, cpu->pc - 0x1000, opcodes[opcode].bytes,
+                mode_bytes[opcodes[opcode].addressing_mode]);
+            errors++;
+        }
+    }
+
+    free(cpu);
+    free_context(ctx);
+
+    return errors;
+}
+
+/* =============================================================================
+ * double seconds()
+ * =============================================================================
+ */
+double seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    disass_context  *ctx;
+    cpu6510         *cpu;
+    double          start;
+    double          elapsed;
+    int             i;
+
+    if (check_steps() != 0)
+    {
+        printf("\nError: wrong instruction lengths\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ctx = new_context();
+    cpu = new_cpu();
+
+    load_buffer(ctx, program, sizeof(program), 0x1000);
+    reset_cpu(cpu, ctx);
+
+    start = seconds();
+    run_cpu(cpu, CYCLES);
+    elapsed = seconds() - start;
+
+    printf("instructions: %ld in %.2f s\n", cpu->instructions, elapsed);
+    printf("   %8.1f million instructions/s\n", cpu->instructions / elapsed / 1e6);
+    printf("   %8.1f MHz (%.0fx a PAL C64)\n", cpu->cycles / elapsed / 1e6,
+        cpu->cycles / elapsed / 985248.0);
+
+    // every byte got one increment per round, like the round counter
+    for (i = 0; i < 0x100; i++)
+    {
+        if (cpu->memory[0x2000 + i] != cpu->memory[0x2100]
+            && cpu->memory[0x2000 + i] != ((cpu->memory[0x2100] + 1) & 0xFF))
+        {
+            printf("\nError: wrong result at 0x%04x\n", 0x2000 + i);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    free(cpu);
+    free_context(ctx);
+    exit(EXIT_SUCCESS);
+}
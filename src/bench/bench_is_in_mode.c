@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../disass.h"
+
+/* =============================================================================
+ * microbenchmark: opcode classification on a 64 KB random image
+ *
+ * "before" is the linear scan over a list of legal opcodes that is_in_mode()
+ * used to do, the list is rebuilt from opcodes[] so both sides agree on which
+ * opcodes are legal. "after" is the current is_in_mode() table lookup.
+ * =============================================================================
+ */
+
+#define IMAGE_SIZE  0x10000
+#define ROUNDS      200
+
+int legal_list[256];
+int legal_list_len = 0;
+
+/* =============================================================================
+ * int is_in_list(int opcode)
+ *
+ * the old is_in_mode() loop
+ * =============================================================================
+ */
+int is_in_list(int opcode)
+{
+    int i;
+
+    for (i = 0; i < legal_list_len; i++)
+    {
+        if (opcode == legal_list[i])
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * double seconds()
+ * =============================================================================
+ */
+double seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    disass_context  *ctx;
+    unsigned char   *image;
+    unsigned int    seed            = 0x6502;
+    double          start;
+    double          before;
+    double          after;
+    long            legal_before    = 0;
+    long            legal_after     = 0;
+    int             mode;
+    int             round;
+    int             i;
+
+    image = malloc(IMAGE_SIZE);
+    ctx = new_context();
+
+    for (i = 0; i < IMAGE_SIZE; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        image[i] = seed >> 16;
+    }
+
+    for (mode = MODE6502; mode <= MODE6510; mode++)
+    {
+        ctx->mode = mode;
+
+        legal_list_len = 0;
+        for (i = 0; i < 256; i++)
+        {
+            if (is_in_mode(ctx, i))
+            {
+                legal_list[legal_list_len++] = i;
+            }
+        }
+
+        start = seconds();
+        for (round = 0; round < ROUNDS; round++)
+        {
+            for (i = 0; i < IMAGE_SIZE; i++)
+            {
+                legal_before += is_in_list(image[i]);
+            }
+        }
+        before = seconds() - start;
+
+        start = seconds();
+        for (round = 0; round < ROUNDS; round++)
+        {
+            for (i = 0; i < IMAGE_SIZE; i++)
+            {
+                legal_after += is_in_mode(ctx, image[i]);
+            }
+        }
+        after = seconds() - start;
+
+        printf("mode %d (%3d legal opcodes):\n", mode, legal_list_len);
+        printf("   linear scan : %8.1f MB/s\n", ROUNDS * (IMAGE_SIZE / 1e6) / before);
+        printf("   table lookup: %8.1f MB/s\n", ROUNDS * (IMAGE_SIZE / 1e6) / after);
+        printf("   speedup     : %8.1fx\n", before / after);
+    }
+
+    if (legal_before != legal_after)
+    {
+        printf("\nError: results differ (%ld vs. %ld)\n", legal_before, legal_after);
+        exit(EXIT_FAILURE);
+    }
+
+    free_context(ctx);
+    free(image);
+    exit(EXIT_SUCCESS);
+}
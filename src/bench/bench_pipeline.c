@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "../disass.h"
+#include "../scan.h"
+
+/* =============================================================================
+ * benchmark: every phase of the disassembly on synthetic images
+ *
+ *      bench_pipeline [-r rounds] [-s seed] [-w dir]
+ *
+ * generates four images:
+ *
+ *      random  random bytes at 0x1000
+ *      code    subroutines of common instructions with a few tables at 0x1000
+ *      data    tables and text with a little code at 0x1000
+ *      full    a 64 KB memory dump from 0x0000: zero page, screen, code,
+ *              tables and the ROM areas
+ *
+ * and runs load_buffer(), create_datamap() / create_flowmap(),
+ * fill_datablocks(), create_labelmap() and print_disassembly() on each one,
+ * with the heuristic and the flow analysis. the mean time per round, bytes per
+ * second and the peak RSS so far go to stdout as JSON, so runs of different
+ * versions can be compared by a script. -w also writes the images to dir as
+ * PRG files, to time acmedisass itself with them.
+ * =============================================================================
+ */
+
+#define ROUNDS      50
+#define PHASES      5
+
+enum {
+    IMAGE_RANDOM,
+    IMAGE_CODE,
+    IMAGE_DATA,
+    IMAGE_FULL,
+    IMAGES
+};
+
+const char *image_names[IMAGES] = { "random", "code", "data", "full" };
+const char *phase_names[PHASES] = { "load", "datamap", "datablocks", "labelmap", "print" };
+const char *level_names[] = { "scalar", "sse2", "avx2" };
+
+// common instructions of real code, more often listed = more often used
+const unsigned char common_opcodes[] = {
+    0xA9, 0xA9, 0xA9, 0xAD, 0xAD, 0xA5, 0xA5, 0xBD, 0xB9, 0xB1,     // lda
+    0x8D, 0x8D, 0x8D, 0x85, 0x85, 0x9D, 0x99, 0x91,                 // sta
+    0xA2, 0xA2, 0xA0, 0xA0, 0xAE, 0xAC, 0x8E, 0x8C,                 // ldx ldy stx sty
+    0xE8, 0xC8, 0xCA, 0x88, 0xAA, 0xA8, 0x8A, 0x98,                 // inx iny dex dey t..
+    0xC9, 0xC9, 0xE0, 0xC0, 0xCD,                                   // cmp cpx cpy
+    0xD0, 0xD0, 0xF0, 0xF0, 0x10, 0x30, 0x90, 0xB0,                 // branches
+    0x18, 0x38, 0x69, 0xE9, 0x29, 0x09, 0x49, 0x0A, 0x4A, 0x2A,     // arithmetic
+    0xEE, 0xCE, 0xE6, 0xC6,                                         // inc dec
+    0x20, 0x20, 0x20, 0x48, 0x68, 0x78, 0x58, 0x2C                  // jsr pha pla sei cli bit
+};
+
+unsigned int seed = 1;
+
+/* =============================================================================
+ * int next_random()
+ *
+ * return value; // 0 - 0x7FFF
+ * =============================================================================
+ */
+int next_random()
+{
+    seed = seed * 1103515245 + 12345;
+
+    return (seed >> 16) & 0x7FFF;
+}
+
+/* =============================================================================
+ * int add_code(unsigned char *image, int i, int end, int pc_start, int pc_end)
+ *
+ * return i; // after one subroutine written to image from offset i
+ *
+ * jsr / jmp and most absolute operands point into the image, the rest into
+ * the I/O area. every subroutine ends with rts or a jmp.
+ * =============================================================================
+ */
+int add_code(unsigned char *image, int i, int end, int pc_start, int pc_end)
+{
+    int op;
+    int address;
+    int count   = 4 + next_random() % 40;
+
+    while (count-- > 0 && i + 6 < end)
+    {
+        op = common_opcodes[next_random() % sizeof(common_opcodes)];
+        image[i] = op;
+
+        switch (opcodes[op].addressing_mode)
+        {
+        case ABS:
+        case ABSX:
+        case ABSY:
+            if (op == 0x20 || next_random() % 4 != 0)
+            {
+                address = pc_start + next_random() * 2 % (pc_end - pc_start);
+            }
+            else
+            {
+                address = 0xD000 + next_random() % 0x0C00;
+            }
+            image[i+1] = address & 0xFF;
+            image[i+2] = address >> 8;
+            break;
+        case REL:
+            image[i+1] = 0x100 - 2 - next_random() % 16;
+            break;
+        case IMM:
+        case ZP:
+        case ZPX:
+        case ZPY:
+        case INDX:
+        case INDY:
+            image[i+1] = next_random() & 0xFF;
+            break;
+        default:
+            break;
+        }
+        i += opcodes[op].bytes;
+    }
+
+    if (next_random() % 4 != 0)
+    {
+        image[i++] = 0x60;
+    }
+    else
+    {
+        address = pc_start + next_random() * 2 % (pc_end - pc_start);
+        image[i++] = 0x4C;
+        image[i++] = address & 0xFF;
+        image[i++] = address >> 8;
+    }
+
+    return i;
+}
+
+/* =============================================================================
+ * int add_data(unsigned char *image, int i, int end)
+ *
+ * return i; // after one table or text written to image from offset i
+ * =============================================================================
+ */
+int add_data(unsigned char *image, int i, int end)
+{
+    const char  *text       = "PRESS FIRE TO PLAY  GAME OVER  HIGH SCORE ";
+    int         length      = 16 + next_random() % 240;
+    int         kind        = next_random() % 4;
+    int         j;
+
+    for (j = 0; j < length && i < end; j++, i++)
+    {
+        switch (kind)
+        {
+        case 0:     image[i] = j; break;                            // lookup table
+        case 1:     image[i] = text[j % strlen(text)]; break;       // text
+        case 2:     image[i] = (j & 1) ? 0x00 : 0xFF; break;        // sprite / charset
+        default:    image[i] = next_random() & 0xFF; break;         // packed / random
+        }
+    }
+
+    return i;
+}
+
+/* =============================================================================
+ * void generate_image(unsigned char *image, int type, int pc_start, int length)
+ * =============================================================================
+ */
+void generate_image(unsigned char *image, int type, int pc_start, int length)
+{
+    int i       = 0;
+    int code;
+    int pc;
+
+    // percent of the blocks that are code, the first one always is for the
+    // flow analysis
+    code = (type == IMAGE_CODE) ? 90 : (type == IMAGE_DATA) ? 20 : 60;
+
+    while (i < length)
+    {
+        pc = pc_start + i;
+
+        if (type == IMAGE_RANDOM)
+        {
+            image[i++] = next_random() & 0xFF;
+        }
+        else if (type == IMAGE_FULL && (pc < 0x0800 || (pc >= 0xD000 && pc < 0xE000)))
+        {
+            // zero page, stack, screen and I/O
+            image[i++] = (pc < 0x0400) ? next_random() & 0xFF : 0x20;
+        }
+        else if (length - i < 8)
+        {
+            image[i++] = 0xEA;
+        }
+        else if (i == 0 || next_random() % 100 < code)
+        {
+            i = add_code(image, i, length, pc_start, pc_start + length);
+        }
+        else
+        {
+            i = add_data(image, i, length);
+        }
+    }
+}
+
+/* =============================================================================
+ * void write_image(const char *dir, const char *name, const unsigned char *image,
+ *      int pc_start, int length)
+ *
+ * as dir/name.prg
+ * =============================================================================
+ */
+void write_image(const char *dir, const char *name, const unsigned char *image,
+    int pc_start, int length)
+{
+    FILE            *file;
+    char            filename[1024];
+    unsigned char   header[2];
+
+    snprintf(filename, sizeof(filename), "%s/%s.prg", dir, name);
+    file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        printf("\nError: couldn't write \"%s\"\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    header[0] = pc_start & 0xFF;
+    header[1] = pc_start >> 8;
+    fwrite(header, 1, 2, file);
+    fwrite(image, 1, length, file);
+    fclose(file);
+}
+
+/* =============================================================================
+ * double seconds()
+ * =============================================================================
+ */
+double seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* =============================================================================
+ * void run_image(disass_context *ctx, output_buffer *output,
+ *      const unsigned char *image, int pc_start, int length, double *times)
+ *
+ * one round of every phase, the time of each is added to times
+ * =============================================================================
+ */
+void run_image(disass_context *ctx, output_buffer *output,
+    const unsigned char *image, int pc_start, int length, double *times)
+{
+    double  start;
+    double  end;
+
+    start = seconds();
+    load_buffer(ctx, image, length, pc_start);
+    end = seconds();
+    times[0] += end - start;
+
+    start = end;
+    if (ctx->flow)
+    {
+        create_flowmap(ctx);
+    }
+    else
+    {
+        create_datamap(ctx);
+    }
+    end = seconds();
+    times[1] += end - start;
+
+    start = end;
+    fill_datablocks(ctx);
+    end = seconds();
+    times[2] += end - start;
+
+    start = end;
+    create_labelmap(ctx);
+    end = seconds();
+    times[3] += end - start;
+
+    start = end;
+    output->length = 0;
+    print_disassembly(ctx);
+    flush_output(ctx);
+    end = seconds();
+    times[4] += end - start;
+}
+
+int main(int argc, char *argv[])
+{
+    disass_context  *ctx;
+    output_buffer   output;
+    struct rusage   usage;
+    unsigned char   *image;
+    const char      *dir            = NULL;
+    double          times[PHASES];
+    double          total;
+    int             rounds          = ROUNDS;
+    int             pc_start;
+    int             length;
+    int             type;
+    int             flow;
+    int             round;
+    int             first           = 1;
+    int             option;
+    int             i;
+
+    while ((option = getopt(argc, argv, "r:s:w:")) != -1)
+    {
+        switch (option)
+        {
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            dir = optarg;
+            break;
+        default:
+            printf("usage: bench_pipeline [-r rounds] [-s seed] [-w dir]\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (rounds < 1)
+    {
+        printf("\nError: rounds must be at least 1\n");
+        exit(EXIT_FAILURE);
+    }
+
+    image = malloc(MEMORY_SIZE);
+    ctx = new_context();
+    memset(&output, 0, sizeof(output));
+    set_output(ctx, output_to_buffer, &output);
+    ctx->mode = MODE6510;
+
+    printf("{\n  \"rounds\": %d,\n  \"seed\": %u,\n  \"scan_level\": \"%s\",\n  \"runs\": [",
+        rounds, seed, level_names[best_scan_level()]);
+
+    for (type = 0; type < IMAGES; type++)
+    {
+        pc_start = (type == IMAGE_FULL) ? 0x0000 : 0x1000;
+        length = MEMORY_SIZE - pc_start;
+        generate_image(image, type, pc_start, length);
+
+        if (dir != NULL)
+        {
+            write_image(dir, image_names[type], image, pc_start, length);
+        }
+
+        for (flow = 0; flow <= 1; flow++)
+        {
+            ctx->flow = flow;
+            memset(times, 0, sizeof(times));
+
+            for (round = 0; round < rounds; round++)
+            {
+                run_image(ctx, &output, image, pc_start, length, times);
+            }
+
+            getrusage(RUSAGE_SELF, &usage);
+
+            printf("%s\n    {\n", first ? "" : ",");
+            printf("      \"image\": \"%s\",\n", image_names[type]);
+            printf("      \"analysis\": \"%s\",\n", flow ? "flow" : "heuristic");
+            printf("      \"pc_start\": %d,\n", pc_start);
+            printf("      \"bytes\": %d,\n", length);
+            printf("      \"output_bytes\": %d,\n", output.length);
+            printf("      \"phases\": {\n");
+
+            total = 0;
+            for (i = 0; i < PHASES; i++)
+            {
+                total += times[i] / rounds;
+                printf("        \"%s\": { \"seconds\": %.9f, \"bytes_per_second\": %.0f },\n",
+                    phase_names[i], times[i] / rounds, length / (times[i] / rounds));
+            }
+            printf("        \"total\": { \"seconds\": %.9f, \"bytes_per_second\": %.0f }\n",
+                total, length / total);
+
+            printf("      },\n");
+            printf("      \"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+            printf("    }");
+            first = 0;
+        }
+    }
+
+    printf("\n  ]\n}\n");
+
+    free_output_buffer(&output);
+    free_context(ctx);
+    free(image);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../disass.h"
+#include "../project.h"
+
+/* =============================================================================
+ * microbenchmark: update_project() against a complete run
+ *
+ * disassembles a synthetic 60K file with an annotation file, then changes a
+ * single label name or data range over and over (update_project()) and
+ * patches single bytes of the file (reload_project()). every update is
+ * checked against disassemble() of a fresh context with the same input.
+ *
+ * one of the labels renamed each round is that of a jmp target behind a
+ * data range, the jmp in front of it has to follow in its own segment.
+ * =============================================================================
+ */
+
+#define PC_START    0x1000
+#define LENGTH      0xF000
+#define ROUNDS      200
+#define JMP_PC      0xE000      // jmp TARGET_PC, data up to it
+#define TARGET_PC   0xE080
+
+unsigned char program[LENGTH];
+
+/* =============================================================================
+ * double seconds()
+ * =============================================================================
+ */
+double seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* =============================================================================
+ * void check_output(disass_context *check, const char *filename,
+ *                   output_buffer *output, output_buffer *expected, int round)
+ *
+ * a complete run must give exactly what the update gave
+ * =============================================================================
+ */
+void check_output(disass_context *check, const char *filename,
+    output_buffer *output, output_buffer *expected, int round)
+{
+    annotations notes;
+
+    load_annotations(&notes, filename);
+    check->notes = &notes;
+    expected->length = 0;
+    disassemble_buffer(check, program, LENGTH, PC_START);
+    free_annotations(&notes);
+
+    if (output->length != expected->length
+        || memcmp(output->data, expected->data, output->length) != 0)
+    {
+        printf("\nError: update %d differs from a complete run\n", round);
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* =============================================================================
+ * void write_notes(const char *filename, int round)
+ *
+ * the same annotations every time, apart from one label and one data range
+ * that move with round and the name of TARGET_PC
+ * =============================================================================
+ */
+void write_notes(const char *filename, int round)
+{
+    FILE    *file;
+    int     i;
+
+    file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        printf("\nError: couldn't write \"%s\"\n", filename);
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i < 64; i++)
+    {
+        fprintf(file, "label 0x%04x label%d\n", PC_START + i * 0x3C0, i);
+    }
+    fprintf(file, "code 0x2000-0x2100\n");
+    fprintf(file, "data 0x%04x-0x%04x\n", 0x4000 + (round % 16) * 0x400, 0x4010 + (round % 16) * 0x400);
+    fprintf(file, "label 0x%04x moving%d\n", 0x8000 + (round % 32) * 0x100, round % 7);
+    fprintf(file, "code 0x%04x-0x%04x\n", JMP_PC, JMP_PC + 2);
+    fprintf(file, "data 0x%04x-0x%04x\n", JMP_PC + 3, TARGET_PC - 1);
+    fprintf(file, "code 0x%04x-0x%04x\n", TARGET_PC, TARGET_PC);
+    fprintf(file, "label 0x%04x target%d\n", TARGET_PC, round % 2);
+    fclose(file);
+}
+
+int main(int argc, char *argv[])
+{
+    disass_context  *ctx;
+    disass_context  *check;
+    output_buffer   output;
+    output_buffer   expected;
+    project         prj;
+    char            filename[]      = "/tmp/bench_project_XXXXXX";
+    unsigned int    seed            = 1;
+    double          start;
+    double          full;
+    double          update          = 0;
+    double          reload          = 0;
+    long            reused          = 0;
+    long            printed         = 0;
+    int             flow;
+    int             fd;
+    int             i;
+
+    // opcodes and operands mixed like in real code, some long runs of data
+    for (i = 0; i < LENGTH; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        program[i] = ((i & 0x1FFF) < 0x1800) ? (seed >> 16) & 0xFF : i & 0x0F;
+    }
+    program[JMP_PC - PC_START] = 0x4C;
+    program[JMP_PC - PC_START + 1] = TARGET_PC & 0xFF;
+    program[JMP_PC - PC_START + 2] = TARGET_PC >> 8;
+    program[TARGET_PC - PC_START] = 0x60;
+
+    fd = mkstemp(filename);
+    if (fd < 0)
+    {
+        printf("\nError: couldn't create a temporary file\n");
+        exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    memset(&output, 0, sizeof(output));
+    memset(&expected, 0, sizeof(expected));
+
+    for (flow = 0; flow <= 1; flow++)
+    {
+        ctx = new_context();
+        check = new_context();
+        ctx->flow = flow;
+        check->flow = flow;
+        set_output(ctx, output_to_buffer, &output);
+        set_output(check, output_to_buffer, &expected);
+
+        write_notes(filename, 0);
+        if (open_project(&prj, filename) != 0)
+        {
+            printf("\nError: couldn't read \"%s\"\n", filename);
+            exit(EXIT_FAILURE);
+        }
+
+        load_buffer(ctx, program, LENGTH, PC_START);
+        start = seconds();
+        disassemble_project(ctx, &prj);
+        full = seconds() - start;
+
+        update = 0;
+        reload = 0;
+        reused = 0;
+        printed = 0;
+
+        for (i = 1; i <= ROUNDS; i++)
+        {
+            write_notes(filename, i);
+
+            output.length = 0;
+            start = seconds();
+            update_project(ctx, &prj, filename);
+            update += seconds() - start;
+            reused += prj.reused;
+            printed += prj.printed;
+
+            check_output(check, filename, &output, &expected, i);
+        }
+
+        printf("%s:\n", flow ? "flow analysis (-f)" : "default analysis");
+        printf("   complete run:  %8.3f ms\n", full * 1000);
+        printf("   update:        %8.3f ms, %ld of %ld segments reused\n",
+            update * 1000 / ROUNDS, reused / ROUNDS, (reused + printed) / ROUNDS);
+
+        reused = 0;
+        printed = 0;
+
+        for (i = 1; i <= ROUNDS; i++)
+        {
+            program[(i * 0x3A7) % LENGTH] ^= 0x20;
+
+            output.length = 0;
+            start = seconds();
+            load_buffer(ctx, program, LENGTH, PC_START);
+            reload_project(ctx, &prj);
+            reload += seconds() - start;
+            reused += prj.reused;
+            printed += prj.printed;
+
+            check_output(check, filename, &output, &expected, i);
+        }
+
+        printf("   reload:        %8.3f ms, %ld of %ld segments reused\n",
+            reload * 1000 / ROUNDS, reused / ROUNDS, (reused + printed) / ROUNDS);
+
+        close_project(&prj);
+        free_context(check);
+        free_context(ctx);
+    }
+
+    unlink(filename);
+    free_output_buffer(&output);
+    free_output_buffer(&expected);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,848 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../disass.h"
+#include "../listing.h"
+
+/* =============================================================================
+ * check: the kickass, ca65 and 64tass output assembles back to the input
+ *
+ *      bench_reassemble [-s seed] [file.prg ...]
+ *
+ * none of the assemblers has to be installed. each output is assembled again
+ * by a small assembler that knows what the real one documents: its cpu
+ * directives, number and string syntax, how to keep an operand below 0x100
+ * absolute and which illegal mnemonics it accepts, with the encoding it
+ * picks for them. like those it uses the zero page variant of an instruction
+ * whenever the operand fits. the bytes have to be those of the input, an
+ * instruction that runs past the end aside.
+ *
+ * without files it checks generated images: random bytes at 0x1000, a BASIC
+ * stub with random bytes after it and every opcode that goes on to the next
+ * one with an operand of 0x12 / 0x0012. every image goes through 6502 and
+ * 6510 mode, with the heuristic and with the flow analysis.
+ *
+ * acme isn't checked. its output is the one of the original disassembler,
+ * sbc 0xEB and anc 0x2B included, which acme assembles as 0xE9 and 0x0B.
+ * =============================================================================
+ */
+
+#define IMAGE_LENGTH    0x4000
+#define LINE_LENGTH     1024
+
+/* a mnemonic of an assembler that isn't in opcodes[] under that name, or
+ * stands for one opcode only
+ */
+typedef struct
+{
+    const char  *mnemonic;  // the assembler's
+    const char  *name;      // as in opcodes[], NULL: opcode
+    int         opcode;
+} illegal_mnemonic;
+
+typedef struct
+{
+    const char  *name;      // for -F
+    const char  *comment;
+    const char  *origin;    // followed by the start address
+    const char  *cpu[2];    // without / with illegal opcodes
+    const char  *text;      // string directive, NULL: none
+    int         byte_text;  // .byte takes strings as well
+    const char  *force;     // in front of an absolute operand, NULL: none
+    int         suffixes;   // .abs / .absx / .absy after the mnemonic instead
+    const illegal_mnemonic *illegal;
+} assembler;
+
+static const illegal_mnemonic kickass_illegal[] = {
+    { "ahx", "sha" }, { "alr", "asr" }, { "anc", "anc" }, { "anc2", NULL, 0x2B },
+    { "arr", "arr" }, { "axs", "sbx" }, { "dcp", "dcp" }, { "isc", "isb" },
+    { "las", "lae" }, { "lax", "lax" }, { "rla", "rla" }, { "rra", "rra" },
+    { "sax", "sax" }, { "sbc2", NULL, 0xEB }, { "shx", "shx" }, { "shy", "shy" },
+    { "slo", "slo" }, { "sre", "sre" }, { "tas", "shs" }, { "xaa", "ane" },
+    { NULL }
+};
+
+static const illegal_mnemonic ca65_illegal[] = {
+    { "alr", "asr" }, { "anc", "anc" }, { "arr", "arr" }, { "axs", "sbx" },
+    { "dcp", "dcp" }, { "isc", "isb" }, { "jam", "jam" }, { "las", "lae" },
+    { "lax", "lax" }, { "rla", "rla" }, { "rra", "rra" }, { "sax", "sax" },
+    { "slo", "slo" }, { "sre", "sre" }, { "tas", "shs" },
+    { NULL }
+};
+
+static const illegal_mnemonic tass_illegal[] = {
+    { "ahx", "sha" }, { "alr", "asr" }, { "anc", "anc" }, { "ane", "ane" },
+    { "arr", "arr" }, { "asr", "asr" }, { "axs", "sbx" }, { "dcp", "dcp" },
+    { "isb", "isb" }, { "isc", "isb" }, { "jam", "jam" }, { "las", "lae" },
+    { "lax", "lax" }, { "lds", "lae" }, { "lxa", "lxa" }, { "rla", "rla" },
+    { "rra", "rra" }, { "sax", "sax" }, { "sbx", "sbx" }, { "sha", "sha" },
+    { "shs", "shs" }, { "shx", "shx" }, { "shy", "shy" }, { "slo", "slo" },
+    { "sre", "sre" }, { "tas", "shs" }, { "xaa", "ane" },
+    { NULL }
+};
+
+static const assembler assemblers[] = {
+    {
+        "kickass", "//", "*=", { ".cpu _6502NoIllegals", ".cpu _6502" },
+        NULL, 0, NULL, 1, kickass_illegal
+    },
+    {
+        "ca65", ";", ".org", { ".setcpu \"6502\"", ".setcpu \"6502X\"" },
+        NULL, 1, "a:", 0, ca65_illegal
+    },
+    {
+        "64tass", ";", "* =", { ".cpu \"6502\"", ".cpu \"6502i\"" },
+        ".text", 0, "@w", 0, tass_illegal
+    }
+};
+
+#define ASSEMBLERS  (int)(sizeof(assemblers) / sizeof(assemblers[0]))
+
+// the documented instructions, the same in every assembler
+static const char official[] =
+    "adc and asl bcc bcs beq bit bmi bne bpl brk bvc bvs clc cld cli clv cmp cpx cpy dec dex "
+    "dey eor inc inx iny jmp jsr lda ldx ldy lsr nop ora pha php pla plp rol ror rti rts sbc "
+    "sec sed sei sta stx sty tax tay tsx txa txs tya";
+
+/* state of one pass over the source
+ */
+typedef struct
+{
+    const assembler *asm_def;
+    unsigned char   image[0x10000 + 2];     // an instruction may end 2 bytes after 0xFFFF
+    char            labels[0x10000];        // set where a label is defined
+    char            names[0x10000][8];      // pcXXXX and the like
+    int             label_count;
+    int             illegal;                // cpu[1] seen
+    int             pass;                   // 1: sizes and labels, 2: bytes
+    int             start;                  // -1 until the origin
+    int             pc;
+    int             line;
+} source;
+
+unsigned int seed = 1;
+
+/* =============================================================================
+ * int next_random()
+ *
+ * return value; // 0 - 0x7FFF
+ * =============================================================================
+ */
+int next_random()
+{
+    seed = seed * 1103515245 + 12345;
+
+    return (seed >> 16) & 0x7FFF;
+}
+
+/* =============================================================================
+ * int add_opcodes(unsigned char *image)
+ *
+ * return length; // of every opcode that goes on to the next instruction,
+ *                // written to image, with absolute operands below 0x100
+ * =============================================================================
+ */
+int add_opcodes(unsigned char *image)
+{
+    int length  = 0;
+    int op;
+
+    for (op = 0; op < 0x100; op++)
+    {
+        if (opcodes[op].cpus == 0 || is_flow_end(op) || op == 0x00 || op == 0x20)
+        {
+            continue;
+        }
+
+        image[length] = op;
+        if (opcodes[op].bytes > 1)
+        {
+            image[length+1] = (opcodes[op].addressing_mode == REL) ? 0x00 : 0x12;
+        }
+        if (opcodes[op].bytes > 2)
+        {
+            image[length+2] = 0x00;
+        }
+        length += opcodes[op].bytes;
+    }
+    image[length++] = 0x60;
+
+    return length;
+}
+
+/* =============================================================================
+ * int fail(source *src, const char *message, const char *text)
+ *
+ * return -1; // after printing where it went wrong
+ * =============================================================================
+ */
+int fail(source *src, const char *message, const char *text)
+{
+    printf("%s line %d: %s: \"%s\"\n", src->asm_def->name, src->line, message, text);
+
+    return -1;
+}
+
+/* =============================================================================
+ * void emit(source *src, int value)
+ *
+ * one byte at src->pc
+ * =============================================================================
+ */
+void emit(source *src, int value)
+{
+    if (src->pass == 2 && src->pc < (int)sizeof(src->image))
+    {
+        src->image[src->pc] = value;
+    }
+    src->pc++;
+}
+
+/* =============================================================================
+ * const char *skip_spaces(const char *s)
+ * =============================================================================
+ */
+const char *skip_spaces(const char *s)
+{
+    while (*s == ' ')
+    {
+        s++;
+    }
+
+    return s;
+}
+
+/* =============================================================================
+ * int find_label(source *src, const char *name)
+ *
+ * return pc;   // of the label called name
+ * return -1;   // if there is none
+ * =============================================================================
+ */
+int find_label(source *src, const char *name)
+{
+    int pc;
+
+    for (pc = 0; pc < 0x10000; pc++)
+    {
+        if (src->labels[pc] && strcmp(src->names[pc], name) == 0)
+        {
+            return pc;
+        }
+    }
+
+    return -1;
+}
+
+/* =============================================================================
+ * const char *parse_value(source *src, const char *s, int *value)
+ *
+ * return s;    // after a $hex or decimal number or a label
+ * return NULL; // if there is none
+ *
+ * labels aren't known in pass 1 yet, they're 0xFFFF until then
+ * =============================================================================
+ */
+const char *parse_value(source *src, const char *s, int *value)
+{
+    char    name[LINE_LENGTH];
+    char    *end;
+    int     i   = 0;
+
+    if (*s == '$' && isxdigit((unsigned char)s[1]))
+    {
+        *value = strtol(s + 1, &end, 16);
+        return end;
+    }
+    if (isdigit((unsigned char)*s))
+    {
+        *value = strtol(s, &end, 10);
+        return end;
+    }
+    if (!isalpha((unsigned char)*s) && *s != '_')
+    {
+        return NULL;
+    }
+
+    while (isalnum((unsigned char)*s) || *s == '_')
+    {
+        name[i++] = *s++;
+    }
+    name[i] = '\0';
+
+    *value = find_label(src, name);
+    if (*value < 0)
+    {
+        if (src->pass == 2)
+        {
+            return NULL;
+        }
+        *value = 0xFFFF;
+    }
+
+    return s;
+}
+
+/* =============================================================================
+ * const char *parse_string(source *src, const char *s)
+ *
+ * return s;    // after a string in quotes, its bytes emitted
+ * return NULL; // if it doesn't end
+ * =============================================================================
+ */
+const char *parse_string(source *src, const char *s)
+{
+    for (s++; *s != '"'; s++)
+    {
+        if (*s == '\0')
+        {
+            return NULL;
+        }
+        emit(src, (unsigned char)*s);
+    }
+
+    return s + 1;
+}
+
+/* =============================================================================
+ * int parse_data(source *src, const char *s, int size)
+ *
+ * return 0;    // after emitting the list of values and strings at s as
+ *              // bytes (size 1) or words (size 2)
+ * return -1;   // on a syntax error
+ * =============================================================================
+ */
+int parse_data(source *src, const char *s, int size)
+{
+    int value;
+
+    do
+    {
+        s = skip_spaces(s);
+
+        if (*s == '"' && size == 1 && src->asm_def->byte_text)
+        {
+            s = parse_string(src, s);
+        }
+        else if ((s = parse_value(src, s, &value)) != NULL && value < (1 << (size * 8)))
+        {
+            emit(src, value & 0xFF);
+            if (size == 2)
+            {
+                emit(src, value >> 8);
+            }
+        }
+        else
+        {
+            return -1;
+        }
+
+        if (s == NULL)
+        {
+            return -1;
+        }
+        s = skip_spaces(s);
+    }
+    while (*s++ == ',');
+
+    return (s[-1] == '\0') ? 0 : -1;
+}
+
+/* =============================================================================
+ * int find_opcode(source *src, const char *mnemonic, int mode)
+ *
+ * return opcode;   // mnemonic with mode assembles to
+ * return -1;       // if the assembler doesn't know it, with the cpu set
+ *
+ * the lowest opcode of that name and mode, as in opcodes[], unless the
+ * assembler has a mnemonic of its own for one of them
+ * =============================================================================
+ */
+int find_opcode(source *src, const char *mnemonic, int mode)
+{
+    const illegal_mnemonic  *illegal;
+    const char              *name       = NULL;
+    int                     op;
+
+    if (strlen(mnemonic) == 3 && strstr(official, mnemonic) != NULL)
+    {
+        name = mnemonic;
+    }
+
+    for (illegal = src->asm_def->illegal; src->illegal && name == NULL && illegal->mnemonic != NULL;
+        illegal++)
+    {
+        if (strcmp(illegal->mnemonic, mnemonic) != 0)
+        {
+            continue;
+        }
+        if (illegal->name == NULL)
+        {
+            return (opcodes[illegal->opcode].addressing_mode == mode) ? illegal->opcode : -1;
+        }
+        name = illegal->name;
+    }
+
+    if (name == NULL)
+    {
+        return -1;
+    }
+
+    for (op = 0; op < 0x100; op++)
+    {
+        if (opcodes[op].cpus != 0 && opcodes[op].addressing_mode == mode
+            && memcmp(opcodes[op].name, name, 3) == 0)
+        {
+            return op;
+        }
+    }
+
+    return -1;
+}
+
+/* =============================================================================
+ * int parse_instruction(source *src, const char *s)
+ *
+ * return 0;    // after emitting the instruction at s
+ * return -1;   // on a syntax error or an instruction the assembler rejects
+ * =============================================================================
+ */
+int parse_instruction(source *src, const char *s)
+{
+    static const char   *suffixes[] = { ".absx", ".absy", ".abs" };
+    const char          *statement  = s;
+    char                mnemonic[8];
+    int                 forced      = 0;
+    int                 value       = 0;
+    int                 mode        = NONE;
+    int                 op          = -1;
+    int                 i           = 0;
+
+    while (isalnum((unsigned char)*s) && i < 7)
+    {
+        mnemonic[i++] = *s++;
+    }
+    mnemonic[i] = '\0';
+
+    for (i = 0; src->asm_def->suffixes && *s == '.' && i < 3; i++)
+    {
+        if (strncmp(s, suffixes[i], strlen(suffixes[i])) == 0)
+        {
+            s += strlen(suffixes[i]);
+            forced = 1;
+        }
+    }
+
+    s = skip_spaces(s);
+    if (src->asm_def->force != NULL && strncmp(s, src->asm_def->force, strlen(src->asm_def->force)) == 0)
+    {
+        s = skip_spaces(s + strlen(src->asm_def->force));
+        forced = 1;
+    }
+
+    if (*s == '\0')
+    {
+        mode = IMP;
+        if ((op = find_opcode(src, mnemonic, IMP)) < 0)
+        {
+            mode = ACC;
+        }
+    }
+    else if (*s == '#')
+    {
+        mode = IMM;
+        s = parse_value(src, s + 1, &value);
+    }
+    else if (*s == '(')
+    {
+        s = parse_value(src, s + 1, &value);
+        mode = (s == NULL) ? NONE : (strcmp(s, ",x)") == 0) ? INDX : (strcmp(s, "),y") == 0) ? INDY
+            : (strcmp(s, ")") == 0) ? ABSI : NONE;
+        s = (mode == NONE) ? NULL : "";
+    }
+    else if ((s = parse_value(src, s, &value)) != NULL)
+    {
+        mode = (strcmp(s, ",x") == 0) ? ABSX : (strcmp(s, ",y") == 0) ? ABSY : (*s == '\0') ? ABS : NONE;
+        s = (mode == NONE) ? NULL : "";
+
+        if (mode == ABS && find_opcode(src, mnemonic, REL) >= 0)
+        {
+            mode = REL;
+        }
+    }
+
+    if (s == NULL || *s != '\0')
+    {
+        return fail(src, "syntax error", statement);
+    }
+
+    // the zero page variant wins where the operand fits and isn't forced
+    if ((mode == ABS || mode == ABSX || mode == ABSY) && value <= 0xFF && !forced)
+    {
+        op = find_opcode(src, mnemonic, (mode == ABS) ? ZP : (mode == ABSX) ? ZPX : ZPY);
+    }
+    if (op < 0)
+    {
+        op = find_opcode(src, mnemonic, mode);
+    }
+
+    if (op < 0)
+    {
+        return fail(src, "unknown instruction", statement);
+    }
+    if (opcodes[op].bytes == 2 && mode != REL && value > 0xFF)
+    {
+        return fail(src, "operand too large", statement);
+    }
+
+    if (mode == REL)
+    {
+        value -= src->pc + 2;
+        if (src->pass == 2 && (value < -128 || value > 127))
+        {
+            return fail(src, "branch out of range", statement);
+        }
+    }
+
+    emit(src, op);
+    if (opcodes[op].bytes > 1)
+    {
+        emit(src, value & 0xFF);
+    }
+    if (opcodes[op].bytes > 2)
+    {
+        emit(src, (value >> 8) & 0xFF);
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * int parse_line(source *src, char *line)
+ *
+ * return 0;    // after the label, directive or instruction in line
+ * return -1;   // on an error
+ * =============================================================================
+ */
+int parse_line(source *src, char *line)
+{
+    const assembler *asm_def    = src->asm_def;
+    const char      *s;
+    char            *comment;
+    int             length;
+    int             value;
+
+    // no comment in a string, the string directives have only one
+    comment = strstr(line, asm_def->comment);
+    if (comment != NULL && (strchr(line, '"') == NULL || strrchr(line, '"') < comment))
+    {
+        *comment = '\0';
+    }
+    length = strlen(line);
+    while (length > 0 && line[length-1] == ' ')
+    {
+        line[--length] = '\0';
+    }
+
+    if (length == 0)
+    {
+        return 0;
+    }
+
+    if (line[0] != ' ')
+    {
+        if (line[length-1] != ':' || length > 8)
+        {
+            return fail(src, "bad label", line);
+        }
+        line[length-1] = '\0';
+        if (src->pass == 1)
+        {
+            if (src->labels[src->pc])
+            {
+                return fail(src, "label defined twice", line);
+            }
+            src->labels[src->pc] = 1;
+            strcpy(src->names[src->pc], line);
+            src->label_count++;
+        }
+        return 0;
+    }
+
+    s = skip_spaces(line);
+
+    if (strcmp(s, asm_def->cpu[0]) == 0 || strcmp(s, asm_def->cpu[1]) == 0)
+    {
+        src->illegal = (strcmp(s, asm_def->cpu[1]) == 0);
+        return 0;
+    }
+
+    if (strncmp(s, asm_def->origin, strlen(asm_def->origin)) == 0)
+    {
+        s = parse_value(src, skip_spaces(s + strlen(asm_def->origin)), &value);
+        if (s == NULL || *s != '\0' || (src->start >= 0 && value != src->pc))
+        {
+            return fail(src, "bad origin", line);
+        }
+        if (src->start < 0)
+        {
+            src->start = value;
+        }
+        src->pc = value;
+        return 0;
+    }
+
+    if (src->start < 0)
+    {
+        return fail(src, "no origin", line);
+    }
+
+    if (strncmp(s, ".byte ", 6) == 0)
+    {
+        return (parse_data(src, s + 6, 1) == 0) ? 0 : fail(src, "bad .byte", line);
+    }
+    if (strncmp(s, ".word ", 6) == 0)
+    {
+        return (parse_data(src, s + 6, 2) == 0) ? 0 : fail(src, "bad .word", line);
+    }
+    if (asm_def->text != NULL && strncmp(s, asm_def->text, strlen(asm_def->text)) == 0
+        && s[strlen(asm_def->text)] == ' ')
+    {
+        s = skip_spaces(s + strlen(asm_def->text));
+        s = (*s == '"') ? parse_string(src, s) : NULL;
+        return (s != NULL && *s == '\0') ? 0 : fail(src, "bad text", line);
+    }
+    if (*s == '.' || *s == '!' || *s == '*')
+    {
+        return fail(src, "unknown directive", line);
+    }
+
+    return parse_instruction(src, s);
+}
+
+/* =============================================================================
+ * int assemble(source *src, const char *text)
+ *
+ * return 0;    // with text assembled to src->image from src->start up to
+ *              // src->pc
+ * return -1;   // on an error
+ * =============================================================================
+ */
+int assemble(source *src, const char *text)
+{
+    char        line[LINE_LENGTH];
+    const char  *s;
+    const char  *end;
+
+    memset(src->labels, 0, sizeof(src->labels));
+    src->label_count = 0;
+
+    for (src->pass = 1; src->pass <= 2; src->pass++)
+    {
+        src->illegal = 0;
+        src->start = -1;
+        src->pc = 0;
+        src->line = 0;
+
+        for (s = text; *s != '\0'; s = (*end == '\n') ? end + 1 : end)
+        {
+            end = strchr(s, '\n');
+            if (end == NULL)
+            {
+                end = s + strlen(s);
+            }
+            src->line++;
+
+            if (end - s >= LINE_LENGTH)
+            {
+                return fail(src, "line too long", "");
+            }
+            memcpy(line, s, end - s);
+            line[end - s] = '\0';
+
+            if (parse_line(src, line) != 0)
+            {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * int check_image(disass_context *ctx, output_buffer *output, source *src,
+ *      const char *name, const unsigned char *data, int length, int pc)
+ *
+ * return errors; // outputs that don't assemble back to data
+ * =============================================================================
+ */
+int check_image(disass_context *ctx, output_buffer *output, source *src,
+    const char *name, const unsigned char *data, int length, int pc)
+{
+    const char  *analysis;
+    int         errors      = 0;
+    int         mode;
+    int         flow;
+    int         i;
+    int         j;
+
+    for (mode = MODE6502; mode <= MODE6510; mode++)
+    {
+        for (flow = 0; flow <= 1; flow++)
+        {
+            for (i = 0; i < ASSEMBLERS; i++)
+            {
+                ctx->mode = mode;
+                ctx->flow = flow;
+                ctx->syntax = find_syntax(assemblers[i].name);
+                output->length = 0;
+                if (disassemble_buffer(ctx, data, length, pc) != 0)
+                {
+                    printf("\nError: can't load \"%s\"\n", name);
+                    exit(EXIT_FAILURE);
+                }
+                flush_output(ctx);
+
+                analysis = flow ? "flow" : "heuristic";
+                printf("%s, %s, %s, %s: ", name, (mode == MODE6510) ? "6510" : "6502", analysis,
+                    assemblers[i].name);
+
+                src->asm_def = &assemblers[i];
+                if (assemble(src, output->data) != 0)
+                {
+                    errors++;
+                    continue;
+                }
+
+                for (j = 0; j < length && src->start + j < src->pc && src->image[src->start + j] == data[j];
+                    j++)
+                {
+                }
+
+                if (src->start != pc || j < length)
+                {
+                    printf("differs at 0x%04x\n", pc + j);
+                    errors++;
+                    continue;
+                }
+
+                printf("ok, %d labels\n", src->label_count);
+            }
+        }
+    }
+
+    return errors;
+}
+
+/* =============================================================================
+ * unsigned char *read_prg(const char *filename, int *length, int *pc)
+ *
+ * return data; // the file without its load address, free() it
+ * =============================================================================
+ */
+unsigned char *read_prg(const char *filename, int *length, int *pc)
+{
+    FILE            *file;
+    unsigned char   *data;
+    int             c0;
+    int             c1;
+
+    file = fopen(filename, "rb");
+    if (file == NULL || (c0 = fgetc(file)) == EOF || (c1 = fgetc(file)) == EOF)
+    {
+        printf("\nError: couldn't read \"%s\"\n", filename);
+        exit(EXIT_FAILURE);
+    }
+    *pc = c0 + (c1 << 8);
+
+    data = malloc(MEMORY_SIZE);
+    if (data == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    *length = fread(data, 1, MEMORY_SIZE - *pc, file);
+    fclose(file);
+
+    return data;
+}
+
+int main(int argc, char *argv[])
+{
+    // 10 SYS2061
+    static const unsigned char  stub[] = {
+        0x0B, 0x08, 0x0A, 0x00, 0x9E, 0x32, 0x30, 0x36, 0x31, 0x00, 0x00, 0x00
+    };
+    disass_context              *ctx;
+    output_buffer               output;
+    source                      *src;
+    unsigned char               *data;
+    int                         errors      = 0;
+    int                         length;
+    int                         pc;
+    int                         option;
+    int                         i;
+
+    while ((option = getopt(argc, argv, "s:")) != -1)
+    {
+        switch (option)
+        {
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            printf("usage: bench_reassemble [-s seed] [file.prg ...]\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    src = malloc(sizeof(source));
+    data = malloc(MEMORY_SIZE);
+    if (src == NULL || data == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ctx = new_context();
+    memset(&output, 0, sizeof(output));
+    set_output(ctx, output_to_buffer, &output);
+
+    if (optind == argc)
+    {
+        for (length = 0; length < IMAGE_LENGTH; length++)
+        {
+            data[length] = next_random() & 0xFF;
+        }
+        errors += check_image(ctx, &output, src, "random", data, IMAGE_LENGTH, 0x1000);
+
+        memcpy(data, stub, sizeof(stub));
+        errors += check_image(ctx, &output, src, "basic", data, IMAGE_LENGTH, 0x0801);
+
+        length = add_opcodes(data);
+        errors += check_image(ctx, &output, src, "opcodes", data, length, 0x1000);
+    }
+
+    for (i = optind; i < argc; i++)
+    {
+        free(data);
+        data = read_prg(argv[i], &length, &pc);
+        errors += check_image(ctx, &output, src, argv[i], data, length, pc);
+    }
+
+    free_output_buffer(&output);
+    free_context(ctx);
+    free(data);
+    free(src);
+
+    if (errors > 0)
+    {
+        printf("\nError: %d outputs don't assemble back to the input\n", errors);
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
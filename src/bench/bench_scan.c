@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../disass.h"
+#include "../scan.h"
+
+/* =============================================================================
+ * microbenchmark: scan_terminators()
+ *
+ * "before" is the byte loop create_datamap() used for step 2 + 3, here filling
+ * the same masks. every implementation the CPU supports is checked against it
+ * on random images, with rts / jmp more common than in random bytes, for
+ * several load addresses and lengths, then timed on a 64 KB image.
+ * =============================================================================
+ */
+
+#define IMAGE_SIZE  0x10000
+#define ROUNDS      2000
+
+const char *level_names[] = { "scalar", "sse2", "avx2" };
+
+/* =============================================================================
+ * void scan_bytes(const disass_context *ctx, unsigned long long *ends,
+ *      unsigned long long *jumps)
+ *
+ * the old step 2 loop
+ * =============================================================================
+ */
+void scan_bytes(const disass_context *ctx, unsigned long long *ends, unsigned long long *jumps)
+{
+    int i;
+    int address;
+
+    memset(ends, 0, SCAN_WORDS * sizeof(unsigned long long));
+    memset(jumps, 0, SCAN_WORDS * sizeof(unsigned long long));
+
+    for (i = 0; i < ctx->assembly.length; i++)
+    {
+        if (ctx->assembly.data[i] == 0x60)
+        {
+            ends[i >> 6] |= 1ULL << (i & 63);
+        }
+        else if (ctx->assembly.data[i] == 0x4C || ctx->assembly.data[i] == 0x6C)
+        {
+            jumps[i >> 6] |= 1ULL << (i & 63);
+            address = (get_byte(ctx, i+1) + (get_byte(ctx, i+2) << 8));
+
+            if ((address >= ctx->pc_start) && (address < ctx->pc_end))
+            {
+                ends[i >> 6] |= 1ULL << (i & 63);
+            }
+        }
+    }
+}
+
+/* =============================================================================
+ * double seconds()
+ * =============================================================================
+ */
+double seconds()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    static unsigned long long   ends[SCAN_WORDS];
+    static unsigned long long   jumps[SCAN_WORDS];
+    static unsigned long long   ends_before[SCAN_WORDS];
+    static unsigned long long   jumps_before[SCAN_WORDS];
+    disass_context  *ctx;
+    unsigned char   *image;
+    unsigned int    seed            = 0x6502;
+    int             starts[]        = { 0x0000, 0x0801, 0x1000, 0x7FFF, 0xC000 };
+    int             lengths[]       = { 1, 2, 3, 17, 33, 34, 35, 1000, 0x4000, 0x10000 };
+    double          start;
+    double          before;
+    double          after;
+    int             best            = best_scan_level();
+    int             level;
+    int             round;
+    int             s;
+    int             l;
+    int             i;
+
+    image = malloc(IMAGE_SIZE);
+    ctx = new_context();
+
+    for (round = 0; round < 20; round++)
+    {
+        for (i = 0; i < IMAGE_SIZE; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            switch ((seed >> 16) & 15)
+            {
+            case 0:     image[i] = 0x60; break;
+            case 1:     image[i] = 0x4C; break;
+            case 2:     image[i] = 0x6C; break;
+            default:    image[i] = seed >> 24; break;
+            }
+        }
+
+        for (s = 0; s < (int)(sizeof(starts) / sizeof(starts[0])); s++)
+        {
+            for (l = 0; l < (int)(sizeof(lengths) / sizeof(lengths[0])); l++)
+            {
+                if (starts[s] + lengths[l] > IMAGE_SIZE)
+                {
+                    continue;
+                }
+
+                load_buffer(ctx, image, lengths[l], starts[s]);
+                scan_bytes(ctx, ends_before, jumps_before);
+
+                for (level = SCAN_SCALAR; level <= best; level++)
+                {
+                    scan_terminators(ctx, ends, jumps, level);
+                    if (memcmp(ends, ends_before, sizeof(ends)) != 0
+                        || memcmp(jumps, jumps_before, sizeof(jumps)) != 0)
+                    {
+                        printf("\nError: %s differs at 0x%04x, %d bytes\n",
+                            level_names[level], starts[s], lengths[l]);
+                        exit(EXIT_FAILURE);
+                    }
+                }
+            }
+        }
+    }
+
+    load_buffer(ctx, image, IMAGE_SIZE - 0x0801, 0x0801);
+
+    start = seconds();
+    for (round = 0; round < ROUNDS; round++)
+    {
+        scan_bytes(ctx, ends_before, jumps_before);
+    }
+    before = seconds() - start;
+
+    printf("byte loop    : %8.1f MB/s\n", ROUNDS * (ctx->assembly.length / 1e6) / before);
+
+    for (level = SCAN_SCALAR; level <= best; level++)
+    {
+        start = seconds();
+        for (round = 0; round < ROUNDS; round++)
+        {
+            scan_terminators(ctx, ends, jumps, level);
+        }
+        after = seconds() - start;
+
+        printf("%-13s: %8.1f MB/s (%.1fx)\n", level_names[level],
+            ROUNDS * (ctx->assembly.length / 1e6) / after, before / after);
+    }
+
+    free_context(ctx);
+    free(image);
+    exit(EXIT_SUCCESS);
+}
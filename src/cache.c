@@ -0,0 +1,256 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cache.h"
+#include "input.h"
+#include "output.h"
+#include "project.h"
+
+/* =============================================================================
+ * result cache
+ *
+ * archives are full of identical files, so the output of disassemble() is
+ * stored under a hash of everything it depends on: the loaded bytes, load
+ * address, entry points, annotations and the analysis options. a cache file is
+ *
+ *      +0  CACHE_MAGIC
+ *      +8  key, 8 bytes (lo first)
+ *      +16 the disassembly without the header lines of the CLI
+ *
+ * bump CACHE_MAGIC whenever the output format changes, old files are then
+ * simply never hit again.
+ * =============================================================================
+ */
+
+#define CACHE_MAGIC     "ADCACHE4"
+#define CACHE_HEADER    16
+
+#define HASH_SEED       0x9E3779B97F4A7C15ULL
+#define HASH_PRIME      0xFF51AFD7ED558CCDULL
+
+/* =============================================================================
+ * unsigned long long hash_mix(unsigned long long hash, unsigned long long value)
+ * =============================================================================
+ */
+static inline unsigned long long hash_mix(unsigned long long hash, unsigned long long value)
+{
+    hash = (hash ^ value) * HASH_PRIME;
+
+    return hash ^ (hash >> 32);
+}
+
+/* =============================================================================
+ * unsigned long long hash_annotations(unsigned long long hash,
+ *                                     const annotations *notes)
+ * =============================================================================
+ */
+static unsigned long long hash_annotations(unsigned long long hash, const annotations *notes)
+{
+    const char  *name;
+    int         i;
+
+    for (i = 0; i < notes->ranges.count; i++)
+    {
+        hash = hash_mix(hash, ((unsigned long long)notes->ranges.blocks[i].pc_start << 32)
+            | (notes->ranges.blocks[i].pc_end << 2) | notes->ranges.blocks[i].type);
+    }
+    hash = hash_mix(hash, notes->ranges.count);
+
+    for (i = 0; i < notes->entries.count; i++)
+    {
+        hash = hash_mix(hash, notes->entries.addresses[i]);
+    }
+    hash = hash_mix(hash, notes->entries.count);
+
+    for (i = 0; i < notes->labels_count; i++)
+    {
+        hash = hash_mix(hash, notes->labels[i].pc);
+        for (name = notes->labels[i].name; *name != '\0'; name++)
+        {
+            hash = hash_mix(hash, *name);
+        }
+    }
+
+    return hash_mix(hash, notes->labels_count);
+}
+
+/* =============================================================================
+ * void cache_filename(const result_cache *cache, unsigned long long key,
+ *                     char *filename, int size)
+ * =============================================================================
+ */
+static void cache_filename(const result_cache *cache, unsigned long long key,
+    char *filename, int size)
+{
+    snprintf(filename, size, "%s/%016llx.asm", cache->dir, key);
+}
+
+/* =============================================================================
+ * int cache_lookup(result_cache *cache, disass_context *ctx,
+ *                  unsigned long long key)
+ *
+ * return 0;  // hit, the stored result has been added to the output of ctx
+ * return -1; // miss
+ * =============================================================================
+ */
+int cache_lookup(result_cache *cache, disass_context *ctx, unsigned long long key)
+{
+    mapped_file         file;
+    char                filename[4200];
+    unsigned long long  stored_key  = 0;
+    int                 i;
+
+    cache_filename(cache, key, filename, sizeof(filename));
+
+    if (map_file(&file, filename) == 0)
+    {
+        if (file.size >= CACHE_HEADER && memcmp(file.data, CACHE_MAGIC, 8) == 0)
+        {
+            for (i = 7; i >= 0; i--)
+            {
+                stored_key = (stored_key << 8) | file.data[8 + i];
+            }
+        }
+
+        if (stored_key == key && file.size >= CACHE_HEADER)
+        {
+            output_chars(ctx, (const char *)file.data + CACHE_HEADER, file.size - CACHE_HEADER);
+            unmap_file(&file);
+
+            __atomic_fetch_add(&cache->hits, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        unmap_file(&file);
+    }
+
+    __atomic_fetch_add(&cache->misses, 1, __ATOMIC_RELAXED);
+    return -1;
+}
+
+/* =============================================================================
+ * void cache_store(result_cache *cache, unsigned long long key,
+ *                  const char *data, int length)
+ *
+ * write the result to a temporary file first and rename() it, so other
+ * threads or processes never see a half written entry. if any write fails,
+ * e.g. on a full disk, the temporary file is removed and the result just
+ * isn't cached.
+ * =============================================================================
+ */
+void cache_store(result_cache *cache, unsigned long long key, const char *data, int length)
+{
+    char            filename[4200];
+    char            tempname[4200];
+    unsigned char   header[CACHE_HEADER];
+    int             fd;
+    int             i;
+
+    memcpy(header, CACHE_MAGIC, 8);
+    for (i = 0; i < 8; i++)
+    {
+        header[8 + i] = (key >> (i * 8)) & 0xFF;
+    }
+
+    snprintf(tempname, sizeof(tempname), "%s/tmp.XXXXXX", cache->dir);
+    fd = mkstemp(tempname);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    // a short entry would be served on every hit, rather none at all
+    if (write_fd(fd, (const char *)header, CACHE_HEADER) != 0 || write_fd(fd, data, length) != 0)
+    {
+        close(fd);
+        unlink(tempname);
+        return;
+    }
+
+    if (close(fd) != 0)
+    {
+        unlink(tempname);
+        return;
+    }
+
+    cache_filename(cache, key, filename, sizeof(filename));
+    if (rename(tempname, filename) != 0)
+    {
+        unlink(tempname);
+        return;
+    }
+
+    __atomic_fetch_add(&cache->stores, 1, __ATOMIC_RELAXED);
+}
+
+/* =============================================================================
+ * unsigned long long hash_context(const disass_context *ctx)
+ * return key;
+ *
+ * hash of the data loaded into ctx and every setting that changes the output
+ * of disassemble(). the data is taken 8 bytes at a time, so hashing a full
+ * 64K file costs next to nothing compared to the analysis.
+ * =============================================================================
+ */
+unsigned long long hash_context(const disass_context *ctx)
+{
+    const unsigned char *data       = ctx->assembly.data;
+    unsigned long long  hash        = HASH_SEED;
+    unsigned long long  value;
+    int                 length      = ctx->assembly.length;
+    int                 i;
+
+    for (i = 0; i + 8 <= length; i += 8)
+    {
+        memcpy(&value, data + i, 8);
+        hash = hash_mix(hash, value);
+    }
+    for (value = 0; i < length; i++)
+    {
+        value = (value << 8) | data[i];
+    }
+    hash = hash_mix(hash, value);
+
+    hash = hash_mix(hash, ((unsigned long long)length << 32) | ctx->pc_start);
+    hash = hash_mix(hash, ((unsigned long long)ctx->entry << 32) | ctx->mode);
+    hash = hash_mix(hash, ((unsigned long long)ctx->flow << 32) | ctx->indent);
+    hash = hash_mix(hash, ctx->trace_cycles);
+    hash = hash_mix(hash, ((unsigned long long)ctx->timing << 32) | ctx->syntax);
+
+    for (i = 0; i < ctx->entries.count; i++)
+    {
+        hash = hash_mix(hash, ctx->entries.addresses[i]);
+    }
+    hash = hash_mix(hash, ctx->entries.count);
+
+    if (ctx->notes != NULL)
+    {
+        hash = hash_annotations(hash, ctx->notes);
+    }
+
+    return hash;
+}
+
+/* =============================================================================
+ * int open_cache(result_cache *cache, const char *dir)
+ *
+ * return 0;  // on success
+ * return -1; // if dir doesn't exist and couldn't be created
+ * =============================================================================
+ */
+int open_cache(result_cache *cache, const char *dir)
+{
+    struct stat st;
+
+    memset(cache, 0, sizeof(result_cache));
+    snprintf(cache->dir, sizeof(cache->dir), "%s", dir);
+
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST)
+    {
+        return -1;
+    }
+
+    return (stat(dir, &st) == 0 && S_ISDIR(st.st_mode)) ? 0 : -1;
+}
@@ -0,0 +1,23 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include "disass.h"
+
+/* on-disk cache of finished disassemblies, one file per result named after
+ * the key from hash_context(). any number of contexts and threads may share
+ * one result_cache, the counters are updated atomically.
+ */
+struct result_cache
+{
+    char            dir[4096];
+    long            hits;
+    long            misses;
+    long            stores;         // results written to dir
+};
+
+int cache_lookup(result_cache *cache, disass_context *ctx, unsigned long long key);
+void cache_store(result_cache *cache, unsigned long long key, const char *data, int length);
+unsigned long long hash_context(const disass_context *ctx);
+int open_cache(result_cache *cache, const char *dir);
+
+#endif // CACHE_H_
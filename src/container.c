@@ -0,0 +1,270 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "container.h"
+
+/* =============================================================================
+ * T64 tape archives
+ *
+ *      0x00    "C64..." signature
+ *      0x22    max. number of directory entries (lo / hi)
+ *      0x40    directory, 32 bytes per entry:
+ *                  +0  entry type, 0 is a free entry
+ *                  +2  start address (lo / hi)
+ *                  +4  end address (lo / hi), often wrong (0xC3C6)
+ *                  +8  offset of the data in the file (32 bit, lo first)
+ *                  +16 name, 16 bytes padded with 0x20
+ *
+ * the data has no load address in front, it's the start address.
+ *
+ * CRT cartridge images (all values big endian)
+ *
+ *      0x00    "C64 CARTRIDGE   " signature
+ *      0x10    header length
+ *      header  CHIP packets, one per ROM bank:
+ *                  +0  "CHIP"
+ *                  +4  packet length including these 16 bytes
+ *                  +10 bank number
+ *                  +12 load address, e.g. 0x8000, 0xA000 or 0xE000
+ *                  +14 ROM size
+ *                  +16 ROM data
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * void add_container_entry(container *cont, container_entry *entry)
+ * =============================================================================
+ */
+static void add_container_entry(container *cont, container_entry *entry)
+{
+    container_entry *new_entries;
+
+    if ((cont->entries_count & 0x3F) == 0)
+    {
+        new_entries = realloc(cont->entries, (cont->entries_count + 0x40) * sizeof(container_entry));
+        if (new_entries == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        cont->entries = new_entries;
+    }
+
+    cont->entries[cont->entries_count] = *entry;
+    cont->entries_count++;
+}
+
+/* =============================================================================
+ * unsigned long get_be(const unsigned char *data, int bytes)
+ * unsigned long get_le(const unsigned char *data, int bytes)
+ *
+ * return value; // big / little endian number of 1-4 bytes
+ * =============================================================================
+ */
+static unsigned long get_be(const unsigned char *data, int bytes)
+{
+    unsigned long value = 0;
+
+    while (bytes-- > 0)
+    {
+        value = (value << 8) | *data++;
+    }
+
+    return value;
+}
+
+static unsigned long get_le(const unsigned char *data, int bytes)
+{
+    unsigned long value = 0;
+
+    while (bytes-- > 0)
+    {
+        value = (value << 8) | data[bytes];
+    }
+
+    return value;
+}
+
+/* =============================================================================
+ * int read_t64(container *cont)
+ *
+ * return 0;  // on success
+ * return -1; // if the directory doesn't fit into the file
+ * =============================================================================
+ */
+static int read_t64(container *cont)
+{
+    const unsigned char *data       = cont->file.data;
+    const unsigned char *dir_entry;
+    container_entry     entry;
+    size_t              size        = cont->file.size;
+    unsigned long       offset;
+    unsigned long       next;
+    unsigned long       other;
+    int                 max_entries;
+    int                 i;
+    int                 j;
+
+    max_entries = get_le(data + 0x22, 2);
+    if (0x40 + max_entries * 32 > size)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < max_entries; i++)
+    {
+        dir_entry = data + 0x40 + i * 32;
+        offset = get_le(dir_entry + 8, 4);
+        if (dir_entry[0] == 0 || offset >= size)
+        {
+            continue;
+        }
+
+        memset(&entry, 0, sizeof(entry));
+        for (j = 0; j < 16; j++)
+        {
+            entry.name[j] = dir_entry[16 + j];
+        }
+        for (j = 15; j >= 0 && (entry.name[j] == 0x20 || (unsigned char)entry.name[j] == 0xA0); j--)
+        {
+            entry.name[j] = '\0';
+        }
+
+        // the end address can't be trusted, the next file limits the length
+        next = size;
+        for (j = 0; j < max_entries; j++)
+        {
+            other = get_le(data + 0x40 + j * 32 + 8, 4);
+            if (data[0x40 + j * 32] != 0 && other > offset && other < next)
+            {
+                next = other;
+            }
+        }
+
+        entry.pc = get_le(dir_entry + 2, 2);
+        entry.length = (int)get_le(dir_entry + 4, 2) - entry.pc;
+        if (entry.length <= 0 || offset + entry.length > next)
+        {
+            entry.length = next - offset;
+        }
+        entry.data = data + offset;
+
+        add_container_entry(cont, &entry);
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * int read_crt(container *cont)
+ *
+ * return 0;  // on success
+ * return -1; // if the header is broken
+ * =============================================================================
+ */
+static int read_crt(container *cont)
+{
+    const unsigned char *data       = cont->file.data;
+    container_entry     entry;
+    size_t              size        = cont->file.size;
+    unsigned long       offset;
+    unsigned long       packet_length;
+
+    offset = get_be(data + 0x10, 4);
+    if (offset < 0x40 || offset > size)
+    {
+        return -1;
+    }
+
+    while (offset + 0x10 <= size && memcmp(data + offset, "CHIP", 4) == 0)
+    {
+        packet_length = get_be(data + offset + 4, 4);
+
+        memset(&entry, 0, sizeof(entry));
+        entry.bank = get_be(data + offset + 10, 2);
+        entry.pc = get_be(data + offset + 12, 2);
+        entry.length = get_be(data + offset + 14, 2);
+        if (offset + 0x10 + entry.length > size)
+        {
+            entry.length = size - offset - 0x10;
+        }
+        entry.data = data + offset + 0x10;
+        snprintf(entry.name, sizeof(entry.name), "bank%02d_%04x", entry.bank, entry.pc);
+
+        add_container_entry(cont, &entry);
+
+        if (packet_length < 0x10)
+        {
+            break;
+        }
+        offset += packet_length;
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * void close_container(container *cont)
+ * =============================================================================
+ */
+void close_container(container *cont)
+{
+    unmap_file(&cont->file);
+    free(cont->entries);
+
+    memset(cont, 0, sizeof(container));
+}
+
+/* =============================================================================
+ * int is_container(const char *filename)
+ *
+ * return 1; // if filename ends with .t64 or .crt
+ * =============================================================================
+ */
+int is_container(const char *filename)
+{
+    const char *ext = strrchr(filename, '.');
+
+    return ext != NULL && (strcasecmp(ext, ".t64") == 0
+        || strcasecmp(ext, ".crt") == 0);
+}
+
+/* =============================================================================
+ * int open_container(container *cont, const char *filename)
+ *
+ * return 0;  // on success
+ * return -1; // if the file couldn't be read or is neither T64 nor CRT
+ *
+ * map the container and list its files or banks, see above
+ * =============================================================================
+ */
+int open_container(container *cont, const char *filename)
+{
+    int result = -1;
+
+    memset(cont, 0, sizeof(container));
+
+    if (map_file(&cont->file, filename) != 0)
+    {
+        return -1;
+    }
+
+    if (cont->file.size >= 0x40 && memcmp(cont->file.data, "C64 CARTRIDGE   ", 16) == 0)
+    {
+        cont->type = CONTAINER_CRT;
+        result = read_crt(cont);
+    }
+    else if (cont->file.size >= 0x40 && memcmp(cont->file.data, "C64", 3) == 0)
+    {
+        cont->type = CONTAINER_T64;
+        result = read_t64(cont);
+    }
+
+    if (result != 0)
+    {
+        close_container(cont);
+    }
+
+    return result;
+}
@@ -0,0 +1,38 @@
+#ifndef CONTAINER_H_
+#define CONTAINER_H_
+
+#include "input.h"
+
+enum {
+    CONTAINER_T64,
+    CONTAINER_CRT
+}; // container types
+
+/* one file of a T64 or one CHIP packet (bank) of a CRT, the data is never
+ * copied out of the mapped container
+ */
+typedef struct
+{
+    char                name[20];   // PETSCII file name (T64) or "bankNN_AAAA" (CRT)
+    const unsigned char *data;      // points into the mapped container
+    int                 length;
+    int                 pc;         // load address, there is none in data
+    int                 bank;       // CRT bank, 0 for T64
+} container_entry;
+
+/* a T64 or CRT mapped with map_file(), read-only after open_container(), so
+ * any number of threads can use its entries at the same time
+ */
+typedef struct
+{
+    mapped_file     file;
+    int             type;
+    container_entry *entries;
+    int             entries_count;
+} container;
+
+void close_container(container *cont);
+int is_container(const char *filename);
+int open_container(container *cont, const char *filename);
+
+#endif // CONTAINER_H_
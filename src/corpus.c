@@ -0,0 +1,404 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "corpus.h"
+#include "xref.h"
+
+/* =============================================================================
+ * corpus index
+ *
+ * one file for a whole archive that answers "which files use opcode x /
+ * reference address y" without disassembling anything again. it is stored
+ * column by column, so a query only touches the columns it needs:
+ *
+ *      +0  CORPUS_MAGIC
+ *      +8  number of files, references and bytes of names, 4 bytes each
+ *      +20 0, 4 bytes
+ *      +24 opcodes         4 * 8 bytes per file
+ *          code_bytes      4 bytes per file
+ *          data_bytes      4 bytes per file
+ *          name_offsets    4 bytes per file + 1
+ *          names           0-terminated
+ *          ref_starts      4 bytes per address + 1
+ *          refs            4 bytes per reference
+ *
+ * every column starts on a multiple of 8. numbers are in host byte order, the
+ * index is a cache of the archive rather than something to pass around.
+ * =============================================================================
+ */
+
+#define CORPUS_MAGIC    "ADCORPS1"
+#define CORPUS_HEADER   24
+
+#define ALIGN8(x)       (((x) + 7) & ~(size_t)7)
+
+/* =============================================================================
+ * int write_column(FILE *file, const void *data, size_t size)
+ *
+ * return 0;  // on success
+ * return -1; // on write errors
+ * =============================================================================
+ */
+static int write_column(FILE *file, const void *data, size_t size)
+{
+    static const char   padding[8]  = { 0 };
+
+    if (size > 0 && fwrite(data, size, 1, file) != 1)
+    {
+        return -1;
+    }
+
+    if (ALIGN8(size) > size && fwrite(padding, ALIGN8(size) - size, 1, file) != 1)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * void close_corpus(corpus_index *index)
+ * =============================================================================
+ */
+void close_corpus(corpus_index *index)
+{
+    unmap_file(&index->file);
+    memset(index, 0, sizeof(corpus_index));
+}
+
+/* =============================================================================
+ * void free_summary(file_summary *summary)
+ * =============================================================================
+ */
+void free_summary(file_summary *summary)
+{
+    free(summary->name);
+    free(summary->targets.addresses);
+    memset(summary, 0, sizeof(file_summary));
+}
+
+/* =============================================================================
+ * int load_corpus(corpus_index *index, const char *filename)
+ *
+ * return 0;  // on success
+ * return -1; // if filename couldn't be read or isn't a corpus index
+ *
+ * map an index written by save_corpus(), close it with close_corpus()
+ * =============================================================================
+ */
+int load_corpus(corpus_index *index, const char *filename)
+{
+    const unsigned char *data;
+    unsigned int        header[3];
+    size_t              offset;
+
+    memset(index, 0, sizeof(corpus_index));
+
+    if (map_file(&index->file, filename) != 0)
+    {
+        return -1;
+    }
+
+    data = index->file.data;
+    if (index->file.size < CORPUS_HEADER || memcmp(data, CORPUS_MAGIC, 8) != 0)
+    {
+        unmap_file(&index->file);
+        return -1;
+    }
+    memcpy(header, data + 8, sizeof(header));
+
+    index->files_count = header[0];
+    index->refs_count = header[1];
+
+    offset = CORPUS_HEADER;
+    index->opcodes = (const unsigned long long *)(data + offset);
+    offset += ALIGN8((size_t)header[0] * 4 * sizeof(unsigned long long));
+    index->code_bytes = (const unsigned int *)(data + offset);
+    offset += ALIGN8((size_t)header[0] * sizeof(unsigned int));
+    index->data_bytes = (const unsigned int *)(data + offset);
+    offset += ALIGN8((size_t)header[0] * sizeof(unsigned int));
+    index->name_offsets = (const unsigned int *)(data + offset);
+    offset += ALIGN8(((size_t)header[0] + 1) * sizeof(unsigned int));
+    index->names = (const char *)(data + offset);
+    offset += ALIGN8(header[2]);
+    index->ref_starts = (const unsigned int *)(data + offset);
+    offset += ALIGN8(0x10001 * sizeof(unsigned int));
+    index->refs = (const unsigned int *)(data + offset);
+    offset += ALIGN8((size_t)header[1] * sizeof(unsigned int));
+
+    if (offset != index->file.size
+        || index->name_offsets[index->files_count] != header[2]
+        || index->ref_starts[0x10000] != header[1])
+    {
+        close_corpus(index);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * void match_addresses(const corpus_index *index, int start, int end,
+ *                      unsigned long long *matches)
+ *
+ * clear the bit in matches (one per file) of every file that doesn't
+ * reference any address from start to end
+ * =============================================================================
+ */
+void match_addresses(const corpus_index *index, int start, int end, unsigned long long *matches)
+{
+    unsigned long long  *found;
+    unsigned int        file;
+    int                 words       = (index->files_count + 63) / 64;
+    int                 pc;
+    unsigned int        i;
+
+    found = calloc(words + 1, sizeof(unsigned long long));
+    if (found == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (pc = start; pc <= end; pc++)
+    {
+        for (i = index->ref_starts[pc]; i < index->ref_starts[pc + 1]; i++)
+        {
+            file = index->refs[i];
+            found[file / 64] |= 1ULL << (file % 64);
+        }
+    }
+
+    for (i = 0; i < (unsigned int)words; i++)
+    {
+        matches[i] &= found[i];
+    }
+
+    free(found);
+}
+
+/* =============================================================================
+ * void match_opcodes(const corpus_index *index,
+ *                    const unsigned long long mask[4],
+ *                    unsigned long long *matches)
+ *
+ * clear the bit in matches (one per file) of every file that uses none of
+ * the opcodes in mask. there are no branches in the inner loop, so the
+ * compiler is free to vectorise it.
+ * =============================================================================
+ */
+void match_opcodes(const corpus_index *index, const unsigned long long mask[4],
+    unsigned long long *matches)
+{
+    const unsigned long long    *opcodes;
+    unsigned long long          bits;
+    int                         count;
+    int                         file        = 0;
+    int                         i;
+
+    while (file < index->files_count)
+    {
+        count = index->files_count - file;
+        count = (count > 64) ? 64 : count;
+        opcodes = index->opcodes + (size_t)file * 4;
+
+        bits = 0;
+        for (i = 0; i < count; i++)
+        {
+            bits |= (unsigned long long)(((opcodes[i * 4] & mask[0]) | (opcodes[i * 4 + 1] & mask[1])
+                | (opcodes[i * 4 + 2] & mask[2]) | (opcodes[i * 4 + 3] & mask[3])) != 0) << i;
+        }
+
+        matches[file / 64] &= bits;
+        file += 64;
+    }
+}
+
+/* =============================================================================
+ * int save_corpus(const file_summary *summaries, int count,
+ *                 const char *filename)
+ *
+ * return 0;  // on success
+ * return -1; // if filename couldn't be written
+ *
+ * write the summaries with a name to a new corpus index, in their order
+ * =============================================================================
+ */
+int save_corpus(const file_summary *summaries, int count, const char *filename)
+{
+    FILE                *file;
+    unsigned long long  *opcodes;
+    unsigned int        *code_bytes;
+    unsigned int        *data_bytes;
+    unsigned int        *name_offsets;
+    unsigned int        *ref_starts;
+    unsigned int        *refs;
+    unsigned int        header[4]       = { 0, 0, 0, 0 };
+    char                *names;
+    int                 files           = 0;
+    int                 i;
+    int                 j;
+    int                 result;
+
+    for (i = 0; i < count; i++)
+    {
+        if (summaries[i].name != NULL)
+        {
+            header[1] += summaries[i].targets.count;
+            header[2] += strlen(summaries[i].name) + 1;
+            files++;
+        }
+    }
+    header[0] = files;
+
+    opcodes = malloc((size_t)files * 4 * sizeof(unsigned long long) + 1);
+    code_bytes = malloc((size_t)files * sizeof(unsigned int) + 1);
+    data_bytes = malloc((size_t)files * sizeof(unsigned int) + 1);
+    name_offsets = malloc(((size_t)files + 1) * sizeof(unsigned int));
+    names = malloc(header[2] + 1);
+    ref_starts = calloc(0x10001, sizeof(unsigned int));
+    refs = malloc((size_t)header[1] * sizeof(unsigned int) + 1);
+    if (opcodes == NULL || code_bytes == NULL || data_bytes == NULL || name_offsets == NULL
+        || names == NULL || ref_starts == NULL || refs == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // the columns and how many files reference each address
+    files = 0;
+    name_offsets[0] = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (summaries[i].name == NULL)
+        {
+            continue;
+        }
+
+        memcpy(opcodes + files * 4, summaries[i].opcodes, 4 * sizeof(unsigned long long));
+        code_bytes[files] = summaries[i].code_bytes;
+        data_bytes[files] = summaries[i].data_bytes;
+        strcpy(names + name_offsets[files], summaries[i].name);
+        name_offsets[files + 1] = name_offsets[files] + strlen(summaries[i].name) + 1;
+
+        for (j = 0; j < summaries[i].targets.count; j++)
+        {
+            ref_starts[summaries[i].targets.addresses[j] + 1]++;
+        }
+        files++;
+    }
+
+    for (i = 1; i <= 0x10000; i++)
+    {
+        ref_starts[i] += ref_starts[i - 1];
+    }
+
+    // file numbers come in ascending order, so every list is sorted
+    files = 0;
+    for (i = 0; i < count; i++)
+    {
+        if (summaries[i].name == NULL)
+        {
+            continue;
+        }
+
+        for (j = 0; j < summaries[i].targets.count; j++)
+        {
+            refs[ref_starts[summaries[i].targets.addresses[j]]++] = files;
+        }
+        files++;
+    }
+
+    // ... which moved every start to the next one
+    memmove(ref_starts + 1, ref_starts, 0x10000 * sizeof(unsigned int));
+    ref_starts[0] = 0;
+
+    result = -1;
+    file = fopen(filename, "wb");
+    if (file != NULL)
+    {
+        result = (fwrite(CORPUS_MAGIC, 8, 1, file) == 1
+            && fwrite(header, sizeof(header), 1, file) == 1
+            && write_column(file, opcodes, (size_t)files * 4 * sizeof(unsigned long long)) == 0
+            && write_column(file, code_bytes, (size_t)files * sizeof(unsigned int)) == 0
+            && write_column(file, data_bytes, (size_t)files * sizeof(unsigned int)) == 0
+            && write_column(file, name_offsets, ((size_t)files + 1) * sizeof(unsigned int)) == 0
+            && write_column(file, names, header[2]) == 0
+            && write_column(file, ref_starts, 0x10001 * sizeof(unsigned int)) == 0
+            && write_column(file, refs, (size_t)header[1] * sizeof(unsigned int)) == 0)
+            ? 0 : -1;
+
+        if (fclose(file) != 0)
+        {
+            result = -1;
+        }
+    }
+
+    free(opcodes);
+    free(code_bytes);
+    free(data_bytes);
+    free(name_offsets);
+    free(names);
+    free(ref_starts);
+    free(refs);
+
+    return result;
+}
+
+/* =============================================================================
+ * void summarize_file(disass_context *ctx, file_summary *summary)
+ *
+ * fill everything but the name of summary from the analysis in ctx, see
+ * disassemble(). the code is walked like print_disassembly() does.
+ * =============================================================================
+ */
+void summarize_file(disass_context *ctx, file_summary *summary)
+{
+    xref_index  xref;
+    int         pc          = ctx->pc_start;
+    int         i;
+
+    memset(summary->opcodes, 0, sizeof(summary->opcodes));
+    summary->code_bytes = 0;
+    summary->targets.count = 0;
+
+    if (ctx->basic_end > ctx->pc_start)
+    {
+        pc = ctx->basic_end;
+    }
+
+    while (pc < ctx->pc_end)
+    {
+        i = ctx->assembly.data[pc - ctx->pc_start];
+
+        if (is_in_mode(ctx, i) && get_datatype(ctx, pc) != DATATYPE_DATA)
+        {
+            summary->opcodes[i / 64] |= 1ULL << (i % 64);
+            summary->code_bytes += opcodes[i].bytes;
+            pc += opcodes[i].bytes;
+        }
+        else
+        {
+            pc++;
+        }
+    }
+
+    // the last instruction may reach beyond the end
+    if (summary->code_bytes > ctx->pc_end - ctx->pc_start)
+    {
+        summary->code_bytes = ctx->pc_end - ctx->pc_start;
+    }
+    summary->data_bytes = ctx->pc_end - ctx->pc_start - summary->code_bytes;
+
+    // sorted by target already
+    memset(&xref, 0, sizeof(xref));
+    build_xref(ctx, &xref);
+    for (i = 0; i < xref.count; i++)
+    {
+        if (i == 0 || xref_target(&xref, i) != xref_target(&xref, i - 1))
+        {
+            append_address(&summary->targets, xref_target(&xref, i));
+        }
+    }
+    free_xref(&xref);
+}
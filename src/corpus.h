@@ -0,0 +1,44 @@
+#ifndef CORPUS_H_
+#define CORPUS_H_
+
+#include "disass.h"
+#include "input.h"
+
+/* what the corpus index keeps of one file, see summarize_file()
+ */
+struct file_summary
+{
+    char                *name;          // malloc()ed, NULL if the file failed
+    unsigned long long  opcodes[4];     // bit n: opcode n is used by the code
+    int                 code_bytes;
+    int                 data_bytes;
+    address_list        targets;        // every address referenced, ascending, once
+};
+
+/* a corpus index mapped by load_corpus(). the columns are used straight from
+ * the file and hold one entry per file unless noted otherwise.
+ */
+typedef struct
+{
+    mapped_file                 file;
+    int                         files_count;
+    int                         refs_count;
+    const unsigned long long    *opcodes;       // 4 per file, see file_summary
+    const unsigned int          *code_bytes;
+    const unsigned int          *data_bytes;
+    const unsigned int          *name_offsets;  // files_count + 1, into names
+    const char                  *names;         // each one 0-terminated
+    const unsigned int          *ref_starts;    // 0x10001, into refs
+    const unsigned int          *refs;          // files referencing each address, ascending
+} corpus_index;
+
+void close_corpus(corpus_index *index);
+void free_summary(file_summary *summary);
+int load_corpus(corpus_index *index, const char *filename);
+void match_addresses(const corpus_index *index, int start, int end, unsigned long long *matches);
+void match_opcodes(const corpus_index *index, const unsigned long long mask[4],
+    unsigned long long *matches);
+int save_corpus(const file_summary *summaries, int count, const char *filename);
+void summarize_file(disass_context *ctx, file_summary *summary);
+
+#endif // CORPUS_H_
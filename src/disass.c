@@ -0,0 +1,791 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+#include "corpus.h"
+#include "disass.h"
+#include "listing.h"
+#include "output.h"
+#include "project.h"
+#include "scan.h"
+#include "signature.h"
+#include "stats.h"
+#include "timing.h"
+#include "xref.h"
+
+int valid_jumps[] = {
+    0xEA31,
+    0xEA81,
+    0xFCE2
+};
+
+/* =============================================================================
+ * void append_address(address_list *list, int pc)
+ *
+ * add pc to the end of list, list grows as needed
+ * =============================================================================
+ */
+void append_address(address_list *list, int pc)
+{
+    int         *new_addresses;
+    int         new_size;
+
+    if (list->count == list->size)
+    {
+        new_size = list->size ? list->size * 2 : 0x100;
+        new_addresses = realloc(list->addresses, new_size * sizeof(int));
+        if (new_addresses == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        list->addresses = new_addresses;
+        list->size = new_size;
+    }
+
+    list->addresses[list->count] = pc;
+    list->count++;
+}
+
+/* =============================================================================
+ * void append_block(block_list *list, datablock block)
+ *
+ * add block to the end of list, list grows as needed
+ * =============================================================================
+ */
+void append_block(block_list *list, datablock block)
+{
+    datablock   *new_blocks;
+    int         new_size;
+
+    if (list->count == list->size)
+    {
+        new_size = list->size ? list->size * 2 : 0x100;
+        new_blocks = realloc(list->blocks, new_size * sizeof(datablock));
+        if (new_blocks == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        list->blocks = new_blocks;
+        list->size = new_size;
+    }
+
+    list->blocks[list->count] = block;
+    list->count++;
+}
+
+/* =============================================================================
+ * code detection idea(s):
+ *
+ * assumption 1:    all code blocks will most likely end with
+ *                  rts         (0x60)
+ *                  jmp 0xHILO  (0x4c 0xLO 0xHI)
+ *
+ * assuption 2:     in case of jmp HI and LO will most likely be
+ *
+ *                  a)  an address 0xHILO within the range between pc_start and
+ *                      pc_end
+ *
+ *                  b)  one of the typical IRQ end addresses:
+ *                          0xEA31
+ *                          0xEA81
+ *                      or jump to reset:
+ *                          0xFCE2
+ *
+ *                  c)  an address 0xHILO within the range 0xE000 - 0xFFFF
+ *                      (KERNAL ROM)
+ *
+ *                  d)  an address 0xHILO within the range 0xA000 - 0xBFFF
+ *                      (BASIC ROM)
+ *
+ *                  e)  if pc_end > 0xA000 c) is very unlikely
+ *
+ *                  f)  if 0xHILO points to an address that is not code it's
+ *                      probably:
+ *
+ *                      f1) if 0xHILO > 0: not code, but data
+ *
+ *                      f2) if 0xHILO = 0: could be a jump to generated code
+ *
+ *
+ *      step 1:     all code is DATATYPE_DATA by default
+ *
+ *      step 2:     find rts (0x60) and jmp (0x4C) codes in the assembly data
+ *
+ *      step 2b:    in case of jmp check the 0xHILO address according to
+ *                  assumption 2
+ *                  cases a) and b) should always be considered
+ *                  maybe add a command line switch if KERNAL or BASIC ROM jumps
+ *                  should be considered (?)
+ *
+ *      step 3:     mark the findings as DATATYPE_CODE_END in the datamap
+ *
+ *      step 4:     do one "normal" disassembly run and if the datamap is
+ *                  not = DATATYPE_CODE_END
+ *                  set DATATYPE_CODE in case of assumed "code"
+ *
+ *                  beware of the case that operand is DATATYPE_CODE_END
+ *                  if that's the case the current code chunk could be
+ *                  misaligned
+ *
+ *      step 5:     go through the resulting datamap again
+ *                  mark beginning of blocks with DATATYPE_CODE
+ *                  if it doesn't END with DATATYPE_CODE_END
+ *                  go back and set everything to DATATYPE_DATA
+ *
+ *      step 6:     skip code output in the main loop when datamap is set to
+ *                  DATATYPE_DATA
+ *
+ *      step 7:     follow the jump tables of the code found so far, their
+ *                  targets are often left as data otherwise, see flow.c
+ * =============================================================================
+ */
+
+void create_datamap(disass_context *ctx)
+{
+    int i;
+    int address;
+    int pc = ctx->basic_end;
+    int first = ctx->basic_end - ctx->pc_start;
+    int word;
+    unsigned long long bits;
+    unsigned long long ends[SCAN_WORDS];
+    unsigned long long jumps[SCAN_WORDS];
+
+    // step 2 + 3, a BASIC stub is never code
+    scan_terminators(ctx, ends, jumps, best_scan_level());
+
+    for (word = first >> 6; word < (ctx->assembly.length + 63) >> 6; word++)
+    {
+        bits = ends[word];
+        if (word == first >> 6)
+        {
+            bits &= ~0ULL << (first & 63);
+        }
+
+        for (; bits != 0; bits &= bits - 1)
+        {
+            set_datatype(ctx, ctx->pc_start + (word << 6) + __builtin_ctzll(bits), DATATYPE_CODE_END);
+        }
+
+        // step 2b, jumps leaving the file are only ends if they go to the ROM
+        bits = jumps[word] & ~ends[word];
+        if (word == first >> 6)
+        {
+            bits &= ~0ULL << (first & 63);
+        }
+
+        for (; bits != 0; bits &= bits - 1)
+        {
+            i = (word << 6) + __builtin_ctzll(bits);
+            address = (get_byte(ctx, i+1) + (get_byte(ctx, i+2) << 8));
+
+            if (is_in_array(address, valid_jumps, sizeof(valid_jumps) / sizeof(valid_jumps[0])))
+            {
+                set_datatype(ctx, ctx->pc_start + i, DATATYPE_CODE_END);
+            }
+        }
+    }
+
+    // step 4
+    pc = ctx->basic_end;
+    opcode *current_opcode;
+
+    while (pc < ctx->pc_end)
+    {
+        i = pc - ctx->pc_start;
+        current_opcode = &opcodes[ctx->assembly.data[i]];
+
+        if (is_in_mode(ctx, ctx->assembly.data[i]) && get_datatype(ctx, pc) != DATATYPE_CODE_END)
+        {
+            int bytes = current_opcode->bytes;
+
+            switch (current_opcode->addressing_mode)
+            {
+            case ACC:
+            case IMP:
+            default:
+                set_datatype(ctx, pc, DATATYPE_CODE);
+                break;
+            case IMM:
+            case ZP:
+            case ZPX:
+            case ZPY:
+            case INDX:
+            case INDY:
+                set_datatype(ctx, pc, DATATYPE_CODE);
+                set_datatype(ctx, pc+1, DATATYPE_CODE);
+                break;
+            case ABS:
+            case ABSI:
+            case ABSX:
+            case ABSY:
+                set_datatype(ctx, pc, DATATYPE_CODE);
+                set_datatype(ctx, pc+1, DATATYPE_CODE);
+                set_datatype(ctx, pc+2, DATATYPE_CODE);
+                break;
+            case REL:
+                set_datatype(ctx, pc, DATATYPE_CODE);
+                set_datatype(ctx, pc+1, DATATYPE_CODE);
+                break;
+            }
+            pc += bytes;
+        }
+        else
+        {
+            if (get_datatype(ctx, pc) != DATATYPE_CODE_END)
+            {
+                set_datatype(ctx, pc, DATATYPE_DATA);
+            }
+            else
+            {
+                if (jumps[i >> 6] & (1ULL << (i & 63)))
+                {
+                    set_datatype(ctx, pc+1, DATATYPE_CODE_END);
+                    set_datatype(ctx, pc+2, DATATYPE_CODE_END);
+                    pc += 2;
+                }
+            }
+            pc++;
+        }
+    };
+
+    // step 5
+    pc = ctx->basic_end;
+    int codeblock_start = 0;
+    int j;
+
+    int blocktype;
+
+    for (i = ctx->basic_end - ctx->pc_start; i < (ctx->pc_end - ctx->pc_start); i++)
+    {
+        // pc runs ahead of i after each jmp, beyond memory it's all data
+        blocktype = (pc < MAP_SIZE) ? get_datatype(ctx, pc) : DATATYPE_DATA;
+
+        if (blocktype == DATATYPE_CODE && !codeblock_start)
+        {
+            codeblock_start = pc;
+        }
+
+        if (blocktype == DATATYPE_DATA && codeblock_start)
+        {
+            for (j = codeblock_start; j < pc && j < MAP_SIZE; j++)
+            {
+                set_datatype(ctx, j, DATATYPE_DATA);
+            }
+
+            // everything up to pc is data now, don't clear it again for
+            // every following data byte
+            codeblock_start = 0;
+        }
+
+        if (blocktype == DATATYPE_CODE_END)
+        {
+            codeblock_start = 0;
+
+            if (get_byte(ctx, pc - ctx->pc_start) == 0x4C || get_byte(ctx, pc - ctx->pc_start) == 0x6C)
+            {
+                pc += 2;
+            }
+        }
+
+        pc++;
+    }
+
+    // step 6 in main output loop
+
+    // step 7
+    follow_jump_tables(ctx);
+}
+
+/* =============================================================================
+ * labelmap concept
+ *
+ *      1.) less is more
+ *          don't flood the disassembly with labels like other disass tools
+ *
+ *      2.) do not differentiate between label "types", so that the labelmap is
+ *          just a simple int array representing the C64 memory with 0 = nolabel
+ *          and 1 = label
+ *
+ *          every label for jmp and jsr should be:
+ *              pcHILO:
+ *
+ *          if there are load / store references to an address that would not
+ *          be at the beginning of the line in dissassembly (self modification)
+ *          keep the labels "in order", i.e:
+ *              pcC0DE:
+ *              pcC0DF = *+1
+ *                          lda #0x00
+ *              pcC0E0:
+ *              pcC0E1 = *+1
+ *              pcC0E2 = *+2
+ *                          sta 0xD020
+ *
+ *      3.) don't set direct labels for load / store references that are inside
+ *          a DATATYPE_DATA block
+ *          instead parse the load / store command target addresses relative to
+ *          the beginning of the DATATYPE_DATA block, i.e.
+ *                          lda pc1234+3
+ *                          sta pc1234+2
+ *                          [...]
+ *          pc1234:             ; +0    +1    +2    +3    +4    +5
+ *                          !byte 0x00, 0x00, 0xDD, 0xCC, 0x00, 0x00
+ *
+ *      4.) keep branches (type REL) simple:
+ *          only use *-X and *+X if target address is not reference elsewhere
+ *
+ *      5.) no autolabels in zeropage
+ *          (maybe only if it's crystal clear to be a pointer)
+ *
+ *      6.) no labels beyond pc_end to keep calls to KERNAL / BASIC "pure"
+ * =============================================================================
+ */
+void create_labelmap(disass_context *ctx)
+{
+    int i;
+    int j;
+
+    // label at the start of each datablock
+    for (i = 0; i < ctx->datablocks.count; i++)
+    {
+        set_label(ctx, ctx->datablocks.blocks[i].pc_start);
+    }
+
+    // label at the start of each codeblock
+    for (i = 0; i < ctx->codeblocks.count; i++)
+    {
+        set_label(ctx, ctx->codeblocks.blocks[i].pc_start);
+    }
+
+    // every named label inside the file, see 6.)
+    if (ctx->notes != NULL)
+    {
+        for (i = 0; i < ctx->notes->labels_count; i++)
+        {
+            j = ctx->notes->labels[i].pc;
+            if (j >= ctx->pc_start && j < ctx->pc_end)
+            {
+                set_label(ctx, j);
+            }
+        }
+    }
+}
+
+/* =============================================================================
+ * void run_disassembly(disass_context *ctx)
+ *
+ * disassemble() with the annotations in ctx->notes as they are
+ * =============================================================================
+ */
+static void run_disassembly(disass_context *ctx)
+{
+    unsigned long long  key     = 0;
+    int                 start   = ctx->out.length;
+
+    if (ctx->cache != NULL && ctx->summary == NULL)
+    {
+        key = hash_context(ctx);
+        if (ctx->xref == NULL && ctx->outputs_count == 0 && cache_lookup(ctx->cache, ctx, key) == 0)
+        {
+            end_phase(ctx->stats, STATS_CACHE);
+            if (ctx->stats != NULL)
+            {
+                ctx->stats->cache_hits++;
+            }
+            flush_output(ctx);
+            end_phase(ctx->stats, STATS_PRINT);
+            return;
+        }
+        end_phase(ctx->stats, STATS_CACHE);
+    }
+
+    if (ctx->flow)
+    {
+        create_flowmap(ctx);
+    }
+    else
+    {
+        create_datamap(ctx);
+    }
+
+    if (ctx->notes != NULL)
+    {
+        apply_annotations(ctx);
+    }
+    end_phase(ctx->stats, STATS_ANALYSIS);
+
+    fill_datablocks(ctx);
+    end_phase(ctx->stats, STATS_DATABLOCKS);
+
+    create_labelmap(ctx);
+    end_phase(ctx->stats, STATS_LABELMAP);
+
+    if (ctx->stats != NULL)
+    {
+        ctx->stats->code_blocks += ctx->codeblocks.count;
+        ctx->stats->data_blocks += ctx->datablocks.count;
+    }
+
+    if (ctx->xref != NULL)
+    {
+        build_xref(ctx, ctx->xref);
+        end_phase(ctx->stats, STATS_INDEX);
+    }
+
+    if (ctx->summary != NULL)
+    {
+        summarize_file(ctx, ctx->summary);
+        end_phase(ctx->stats, STATS_INDEX);
+        flush_output(ctx);
+        end_phase(ctx->stats, STATS_PRINT);
+        return;
+    }
+
+    print_disassembly(ctx);
+
+    if (ctx->cache != NULL)
+    {
+        cache_store(ctx->cache, key, ctx->out.data + start, ctx->out.length - start);
+    }
+
+    flush_output(ctx);
+    end_phase(ctx->stats, STATS_PRINT);
+}
+
+/* =============================================================================
+ * void disassemble(disass_context *ctx)
+ *
+ * analyse the data loaded into ctx and send the disassembly to its output.
+ * with a cache the result of an identical earlier run is sent instead, the
+ * datamap and labelmap are left empty then. ctx->xref and ctx->outputs need
+ * the analysis, with either of them the cache isn't looked up, but the
+ * result is still stored in it. with ctx->summary nothing is printed, see
+ * summarize_file(). known routines found with ctx->signatures are added to
+ * ctx->notes for this run. with ctx->stats the time since start_stats()
+ * counts as reading the file.
+ * =============================================================================
+ */
+void disassemble(disass_context *ctx)
+{
+    const annotations   *notes      = ctx->notes;
+    annotations         matched;
+
+    if (ctx->stats != NULL)
+    {
+        end_phase(ctx->stats, STATS_READ);
+        ctx->stats->files++;
+        ctx->stats->bytes += ctx->assembly.length;
+    }
+
+    if (ctx->signatures == NULL || match_signatures(ctx, &matched) == 0)
+    {
+        end_phase(ctx->stats, STATS_ANALYSIS);
+        run_disassembly(ctx);
+        return;
+    }
+    end_phase(ctx->stats, STATS_ANALYSIS);
+
+    ctx->notes = &matched;
+    run_disassembly(ctx);
+    ctx->notes = notes;
+
+    free_annotations(&matched);
+}
+
+/* =============================================================================
+ * int disassemble_buffer(disass_context *ctx, const unsigned char *data,
+ *                        int length, int pc)
+ *
+ * return 0;  // on success
+ * return -1; // if pc or length are invalid
+ *
+ * load_buffer() and disassemble() in one go
+ * =============================================================================
+ */
+int disassemble_buffer(disass_context *ctx, const unsigned char *data, int length, int pc)
+{
+    if (load_buffer(ctx, data, length, pc) != 0)
+    {
+        return -1;
+    }
+
+    disassemble(ctx);
+
+    return 0;
+}
+
+/* =============================================================================
+ * void fill_datablocks(disass_context *ctx)
+ * =============================================================================
+ */
+void fill_datablocks(disass_context *ctx)
+{
+    int i;
+    datablock last_block = { 0, 0, -1 };
+    // datablock current_block;
+    int last_blocktype = -1;
+    int current_blocktype;
+
+    for (i = ctx->pc_start; i < ctx->pc_end; i++)
+    {
+        current_blocktype = get_datatype(ctx, i);
+        if (current_blocktype == DATATYPE_CODE_END)
+        {
+            current_blocktype = DATATYPE_CODE;
+        }
+
+        if (current_blocktype != last_blocktype)
+        {
+            last_block.pc_end = i;
+
+            if (last_block.type == DATATYPE_DATA)
+            {
+                append_block(&ctx->datablocks, last_block);
+            }
+            else if (last_block.type == DATATYPE_CODE)
+            {
+                append_block(&ctx->codeblocks, last_block);
+            }
+
+            last_block.pc_start = i;
+            last_block.pc_end = 0;
+            last_block.type = current_blocktype;
+        }
+
+        last_blocktype = current_blocktype;
+    }
+
+    // test output
+    /*
+    for (i = 0; i < ctx->codeblocks.count; i++)
+    {
+        printf("; codeblocks[%03i] 0x%04X - 0x%04X type: %i\n",
+            i,
+            ctx->codeblocks.blocks[i].pc_start,
+            ctx->codeblocks.blocks[i].pc_end,
+            ctx->codeblocks.blocks[i].type
+        );
+    }
+
+    for (i = 0; i < ctx->datablocks.count; i++)
+    {
+        printf("; datablocks[%03i] 0x%04X - 0x%04X type: %i\n",
+            i,
+            ctx->datablocks.blocks[i].pc_start,
+            ctx->datablocks.blocks[i].pc_end,
+            ctx->datablocks.blocks[i].type
+        );
+    }
+    */
+}
+
+/* =============================================================================
+ * void free_context(disass_context *ctx)
+ * =============================================================================
+ */
+void free_context(disass_context *ctx)
+{
+    free(ctx->codeblocks.blocks);
+    free(ctx->datablocks.blocks);
+    free(ctx->entries.addresses);
+    free(ctx->worklist.addresses);
+    free(ctx->cpu);
+    free(ctx->unpacked);
+    free(ctx->listing.lines);
+    free(ctx->timings.spans);
+    free(ctx->out.data);
+    free(ctx);
+}
+
+/* =============================================================================
+ * int is_in_array(int needle, int haystack[], int haystack_len)
+ *
+ * return 0; // if needle not found in haystack array
+ * return 1; // if needle was found in haystack array
+ *
+ * everything has to be type int
+ * =============================================================================
+ */
+int is_in_array(int needle, int haystack[], int haystack_len)
+{
+    int i;
+
+    for (i = 0; i < haystack_len; i++)
+    {
+        if (haystack[i] == needle) return 1;
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * int is_in_mode(disass_context *ctx, int opcode)
+ *
+ * return 0; // if opcode not found in mode
+ * return 1; // if opcode was found in mode
+ * =============================================================================
+ */
+int is_in_mode(disass_context *ctx, int opcode)
+{
+    int cpu = (ctx->mode == MODE6510) ? CPU_6510 : CPU_6502;
+
+    return (opcodes[opcode & 0xFF].cpus & cpu) != 0;
+}
+
+/* =============================================================================
+ * int load_buffer(disass_context *ctx, const unsigned char *data, int length,
+ *                 int pc)
+ *
+ * return 0;  // on success
+ * return -1; // if pc or length are invalid
+ *
+ * reset ctx and use length bytes of data at address pc as input. a BASIC
+ * stub at pc is recognized right away, see parse_basic().
+ *
+ * data is *not* copied, it has to stay valid until ctx is reset or reused.
+ * everything that doesn't fit below 0x10000 is cut off, the number of bytes
+ * that were dropped is left in ctx->assembly.truncated.
+ * =============================================================================
+ */
+int load_buffer(disass_context *ctx, const unsigned char *data, int length, int pc)
+{
+    reset_context(ctx);
+
+    if (length < 0 || pc < 0 || pc > 0xFFFF)
+    {
+        return -1;
+    }
+
+    if (pc + length > MEMORY_SIZE)
+    {
+        ctx->assembly.truncated = pc + length - MEMORY_SIZE;
+        length = MEMORY_SIZE - pc;
+    }
+
+    ctx->assembly.data = data;
+    ctx->assembly.length = length;
+
+    ctx->pc_start = pc;
+    ctx->pc_end = pc + length;
+    ctx->entry = pc;
+
+    parse_basic(ctx);
+
+    return 0;
+}
+
+/* =============================================================================
+ * disass_context *new_context()
+ * return ctx;
+ *
+ * allocates a cleared disass_context with default settings
+ * =============================================================================
+ */
+disass_context *new_context()
+{
+    disass_context *ctx;
+
+    ctx = calloc(1, sizeof(disass_context));
+    if (ctx == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    ctx->indent = DEFAULT_INDENT;
+    ctx->mode = MODE6502;
+    ctx->pc_start = 0x0801;
+    ctx->output = output_to_file;
+    ctx->output_user = stdout;
+
+    return ctx;
+}
+
+/* =============================================================================
+ * void print_disassembly(disass_context *ctx)
+ *
+ * print the complete disassembly according to datamap and labelmap, in
+ * ctx->syntax. it's rendered from the same listing in the syntax of each of
+ * ctx->outputs as well, which get their text right away. with ctx->timing
+ * the cycles of blocks, loops and instructions go into comments.
+ * =============================================================================
+ */
+void print_disassembly(disass_context *ctx)
+{
+    int start;
+    int i;
+
+    ctx->listing.count = 0;
+    list_disassembly(ctx, &ctx->listing);
+    if (ctx->timing)
+    {
+        analyse_timing(ctx, &ctx->listing);
+    }
+    render_listing(ctx, &ctx->listing, ctx->syntax);
+
+    for (i = 0; i < ctx->outputs_count; i++)
+    {
+        start = ctx->out.length;
+        render_listing(ctx, &ctx->listing, ctx->outputs[i].syntax);
+        flush_output_to(ctx, start, &ctx->outputs[i]);
+    }
+}
+
+/* =============================================================================
+ * int print_range(disass_context *ctx, int pc, int pc_end, int *row)
+ * return pc; // after the last instruction / byte printed
+ *
+ * print everything from pc up to pc_end in ctx->syntax, see list_range()
+ * =============================================================================
+ */
+int print_range(disass_context *ctx, int pc, int pc_end, int *row)
+{
+    ctx->listing.count = 0;
+    pc = list_range(ctx, &ctx->listing, pc, pc_end, row);
+    if (ctx->timing)
+    {
+        analyse_timing(ctx, &ctx->listing);
+    }
+    render_listing(ctx, &ctx->listing, ctx->syntax);
+
+    return pc;
+}
+
+/* =============================================================================
+ * void print_indent(disass_context *ctx)
+ *
+ * print n spaces as indentation
+ * =============================================================================
+ */
+void print_indent(disass_context *ctx)
+{
+    output_spaces(ctx, ctx->indent);
+}
+
+/* =============================================================================
+ * void reset_context(disass_context *ctx)
+ *
+ * clear everything the last file left behind in ctx, so that it can be reused
+ * for the next one. the block lists keep their memory.
+ * =============================================================================
+ */
+void reset_context(disass_context *ctx)
+{
+    // DATATYPE_DATA is 0
+    memset(ctx->datamap, 0, sizeof(ctx->datamap));
+    memset(ctx->labelmap, 0, sizeof(ctx->labelmap));
+
+    ctx->assembly.data = NULL;
+    ctx->assembly.length = 0;
+    ctx->assembly.truncated = 0;
+
+    ctx->codeblocks.count = 0;
+    ctx->datablocks.count = 0;
+    ctx->pc_start = 0;
+    ctx->pc_end = 0;
+    ctx->basic_end = 0;
+    ctx->sys_address = -1;
+    ctx->entry = 0;
+}
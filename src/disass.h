@@ -0,0 +1,302 @@
+#ifndef DISASS_H_
+#define DISASS_H_
+
+#include <stdio.h>
+#include <string.h>
+
+#define MEMORY_SIZE     0x10000
+#define MAP_SIZE        (MEMORY_SIZE + 2)   // operands of an instruction at 0xFFFF
+#define DEFAULT_INDENT  20
+
+enum {
+    NONE,
+    ACC,
+    IMP,
+    IMM,
+    ZP,
+    ZPX,
+    ZPY,
+    ABS,
+    ABSX,
+    ABSY,
+    ABSI,
+    INDX,
+    INDY,
+    REL
+}; // addressing modes
+
+enum {
+    MODE6502,
+    MODE6510
+}; // cpu modes (6510 includes 'illegal' opcodes)
+
+#define CPU_6502        (1 << MODE6502)
+#define CPU_6510        (1 << MODE6510)
+#define CPU_ALL         (CPU_6502 | CPU_6510)
+
+enum {
+    DATATYPE_DATA,
+    DATATYPE_CODE,
+    DATATYPE_CODE_END
+}; // datatypes data and code, stored with 2 bits per address in the datamap
+
+typedef struct
+{
+    char name[128];
+    const unsigned char *data;  // not owned, see load_buffer()
+    int length;
+    long truncated;             // bytes dropped beyond 0xFFFF
+} virtual_file;
+
+typedef struct
+{
+    char name[3];
+    int bytes;
+    int cycles;
+    int addressing_mode;
+    int cpus;       // CPU_6502 and/or CPU_6510 if legal in that mode
+} opcode;
+
+typedef struct
+{
+    int pc_start;
+    int pc_end;     // make sure to set this to pc *after* the last instruction
+    int type;       // DATATYPE_DATA or DATATYPE_CODE
+} datablock;
+
+typedef struct
+{
+    datablock   *blocks;
+    int         count;
+    int         size;       // allocated entries
+} block_list;
+
+/* growing list of 16 bit addresses, see append_address()
+ */
+typedef struct
+{
+    int         *addresses;
+    int         count;
+    int         size;       // allocated entries
+} address_list;
+
+/* receives every piece of disassembly output. data is *not* 0-terminated.
+ */
+typedef void (*output_func)(void *user, const char *data, int length);
+
+/* one line of the decoded program, see listing.h
+ */
+typedef struct
+{
+    unsigned char   type;       // LINE_INSTRUCTION etc.
+    unsigned char   flags;      // LINE_OPEN etc.
+    unsigned short  count;      // bytes covered
+    int             pc;
+    int             value;      // operand, word or cpu mode
+} listing_line;
+
+/* the decoded program, filled by list_disassembly() and printed by
+ * render_listing() in any syntax
+ */
+typedef struct
+{
+    listing_line    *lines;
+    int             count;
+    int             size;       // allocated entries
+} listing;
+
+/* another output of the same run in its own syntax, see ctx->outputs
+ */
+typedef struct
+{
+    int             syntax;     // SYNTAX_ACME etc.
+    output_func     output;
+    void            *user;
+} listing_output;
+
+/* cycles of a straight-line block or of one iteration of a loop, see
+ * analyse_timing()
+ */
+typedef struct
+{
+    int             pc_start;
+    int             pc_end;     // pc after the last instruction
+    int             type;       // TIMING_BLOCK or TIMING_LOOP
+    int             min;
+    int             max;
+} cycle_span;
+
+typedef struct
+{
+    cycle_span      *spans;
+    int             count;
+    int             size;       // allocated entries
+} span_list;
+
+/* growing memory buffer, see output_to_buffer()
+ */
+typedef struct
+{
+    char    *data;
+    int     length;
+    int     size;
+} output_buffer;
+
+struct cpu6510;  // see emu.h
+typedef struct result_cache result_cache;   // see cache.h
+typedef struct annotations annotations;     // see project.h
+typedef struct file_summary file_summary;   // see corpus.h
+typedef struct run_stats run_stats;         // see stats.h
+typedef struct signature_db signature_db;   // see signature.h
+typedef struct xref_index xref_index;       // see xref.h
+
+/* everything needed to disassemble one file. a context is never shared
+ * between threads, so each thread has to own at least one of them.
+ * always allocate it with new_context().
+ */
+typedef struct
+{
+    virtual_file    assembly;
+    unsigned char   datamap[(MAP_SIZE + 3) / 4];    // see get_datatype()
+    unsigned char   labelmap[(MAP_SIZE + 7) / 8];   // see is_label()
+    block_list      codeblocks;
+    block_list      datablocks;
+    address_list    entries;        // extra entry points, see add_entry()
+    address_list    worklist;       // scratch space of create_flowmap() / follow_jump_tables()
+    int             flow;           // 1: create_flowmap() instead of create_datamap()
+    long            trace_cycles;   // >0: create_flowmap() starts with trace_code()
+    long            unpack_cycles;  // >0: cycle budget for unpack_code()
+    unsigned char   *unpacked;      // memory image loaded by unpack_code()
+    struct cpu6510  *cpu;           // allocated by trace_code()
+    result_cache    *cache;         // not owned, NULL: every file is analysed
+    const annotations *notes;       // not owned, forced ranges / entries / label names
+    const signature_db *signatures; // not owned, NULL: no known routines, see match_signatures()
+    xref_index      *xref;          // not owned, NULL: no cross references, see build_xref()
+    file_summary    *summary;       // not owned, NULL: print the disassembly, else only fill it
+    run_stats       *stats;         // not owned, NULL: no timing, see start_stats()
+    int             indent;
+    int             mode;
+    int             pc_end;
+    int             pc_start;
+    int             basic_end;      // pc after the BASIC stub, see parse_basic()
+    int             sys_address;    // SYS target of the stub or -1
+    int             entry;          // where execution starts: pc_start or the SYS target
+    int             syntax;         // of the output, SYNTAX_ACME by default
+    const listing_output *outputs;  // not owned, more syntaxes rendered from the same listing
+    int             outputs_count;
+    listing         listing;        // scratch space of print_disassembly() / print_range()
+    int             timing;         // 1: cycle counts as comments, see analyse_timing()
+    span_list       timings;        // blocks and loops of the listing, sorted by pc_start
+    output_buffer   out;            // collects output until flush_output()
+    output_func     output;
+    void            *output_user;
+} disass_context;
+
+extern opcode opcodes[];
+
+/* =============================================================================
+ * int get_datatype(const disass_context *ctx, int pc)
+ * void set_datatype(disass_context *ctx, int pc, int type)
+ *
+ * access the datamap, 4 addresses share one byte
+ * =============================================================================
+ */
+static inline int get_datatype(const disass_context *ctx, int pc)
+{
+    return (ctx->datamap[pc >> 2] >> ((pc & 3) << 1)) & 3;
+}
+
+static inline void set_datatype(disass_context *ctx, int pc, int type)
+{
+    int shift = (pc & 3) << 1;
+
+    ctx->datamap[pc >> 2] = (ctx->datamap[pc >> 2] & ~(3 << shift)) | (type << shift);
+}
+
+/* =============================================================================
+ * int get_byte(const disass_context *ctx, int i)
+ *
+ * return ctx->assembly.data[i]; // or 0x00 if i is beyond the end of data
+ *
+ * assembly.data usually points straight into a mapped file, so operands of an
+ * instruction at the very end must never be read from there directly
+ * =============================================================================
+ */
+static inline int get_byte(const disass_context *ctx, int i)
+{
+    return (i < ctx->assembly.length) ? ctx->assembly.data[i] : 0x00;
+}
+
+/* =============================================================================
+ * int is_label(const disass_context *ctx, int pc)
+ * void set_label(disass_context *ctx, int pc)
+ *
+ * access the labelmap, one bit per address
+ * =============================================================================
+ */
+static inline int is_label(const disass_context *ctx, int pc)
+{
+    return (ctx->labelmap[pc >> 3] >> (pc & 7)) & 1;
+}
+
+static inline void set_label(disass_context *ctx, int pc)
+{
+    ctx->labelmap[pc >> 3] |= 1 << (pc & 7);
+}
+
+/* =============================================================================
+ * int is_flow_end(int opcode)
+ *
+ * return 1; // if execution doesn't continue with the next instruction
+ * =============================================================================
+ */
+static inline int is_flow_end(int opcode)
+{
+    switch (opcode)
+    {
+    case 0x40:  // rti
+    case 0x4C:  // jmp
+    case 0x60:  // rts
+    case 0x6C:  // jmp ()
+        return 1;
+    }
+
+    return memcmp(opcodes[opcode].name, "jam", 3) == 0;
+}
+
+void add_entry(disass_context *ctx, int pc);
+void apply_annotations(disass_context *ctx);
+void append_address(address_list *list, int pc);
+void append_block(block_list *list, datablock block);
+void create_datamap(disass_context *ctx);
+void create_flowmap(disass_context *ctx);
+void create_labelmap(disass_context *ctx);
+void disassemble(disass_context *ctx);
+int disassemble_buffer(disass_context *ctx, const unsigned char *data, int length, int pc);
+void fill_datablocks(disass_context *ctx);
+const char *find_label_name(const annotations *notes, int pc);
+void follow_jump_tables(disass_context *ctx);
+void follow_worklist(disass_context *ctx);
+void free_context(disass_context *ctx);
+void flush_output(disass_context *ctx);
+void flush_output_to(disass_context *ctx, int start, const listing_output *output);
+void free_output_buffer(output_buffer *buffer);
+int is_in_array(int needle, int haystack[], int haystack_len);
+int is_in_mode(disass_context *ctx, int opcode);
+int load_buffer(disass_context *ctx, const unsigned char *data, int length, int pc);
+disass_context *new_context();
+int parse_basic(disass_context *ctx);
+int parse_sys(disass_context *ctx, int pc, int pc_end);
+void output_printf(disass_context *ctx, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+void output_to_buffer(void *user, const char *data, int length);
+void output_to_fd(void *user, const char *data, int length);
+void output_to_file(void *user, const char *data, int length);
+void print_disassembly(disass_context *ctx);
+void print_indent(disass_context *ctx);
+int print_range(disass_context *ctx, int pc, int pc_end, int *row);
+void reset_context(disass_context *ctx);
+void set_output(disass_context *ctx, output_func output, void *user);
+int write_fd(int fd, const char *data, int length);
+
+#endif // DISASS_H_
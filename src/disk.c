@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "disk.h"
+
+typedef struct
+{
+    size_t  size;
+    int     type;
+    int     tracks;
+    int     sectors;
+} disk_format;
+
+// images with error info have one extra byte per sector
+disk_format disk_formats[] = {
+    { 174848, DISK_D64, 35,  683 },
+    { 175531, DISK_D64, 35,  683 },
+    { 196608, DISK_D64, 40,  768 },
+    { 197376, DISK_D64, 40,  768 },
+    { 349696, DISK_D71, 70, 1366 },
+    { 351062, DISK_D71, 70, 1366 },
+    { 819200, DISK_D81, 80, 3200 },
+    { 822400, DISK_D81, 80, 3200 }
+};
+
+/* =============================================================================
+ * disk images
+ *
+ * D64 (1541), D71 (1571) and D81 (1581) images are plain dumps of all
+ * 256 byte sectors, track 1 sector 0 first:
+ *
+ *      D64:    tracks 1-17 have 21 sectors, 18-24 19, 25-30 18, 31-40 17
+ *      D71:    two D64 sides, tracks 36-70 are the second one
+ *      D81:    80 tracks with 40 sectors each
+ *
+ * the directory starts at 18/1 (D81: 40/3). every sector starts with the
+ * track / sector of the next one, track 0 ends the chain and then the sector
+ * byte is the offset of the last used byte. a directory sector holds 8
+ * entries of 32 bytes:
+ *
+ *      +2      file type, 0x82 is a closed PRG
+ *      +3      track / sector of the first sector of the file
+ *      +5      name, 16 bytes padded with 0xA0
+ *      +30     size in blocks
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * int d64_sectors(int track)
+ *
+ * return sectors; // number of sectors of a 1541 track
+ * =============================================================================
+ */
+static int d64_sectors(int track)
+{
+    if (track <= 17)
+    {
+        return 21;
+    }
+    if (track <= 24)
+    {
+        return 19;
+    }
+    if (track <= 30)
+    {
+        return 18;
+    }
+    return 17;
+}
+
+/* =============================================================================
+ * long sector_offset(const disk_image *disk, int track, int sector)
+ *
+ * return offset;   // of track / sector in the image
+ * return -1;       // if there is no such sector
+ * =============================================================================
+ */
+static long sector_offset(const disk_image *disk, int track, int sector)
+{
+    long    offset  = 0;
+    int     i;
+
+    if (track < 1 || track > disk->tracks || sector < 0)
+    {
+        return -1;
+    }
+
+    if (disk->type == DISK_D81)
+    {
+        return (sector < 40) ? ((track - 1) * 40L + sector) * 256 : -1;
+    }
+
+    if (disk->type == DISK_D71 && track > 35)
+    {
+        offset = 683;
+        track -= 35;
+    }
+
+    if (sector >= d64_sectors(track))
+    {
+        return -1;
+    }
+
+    for (i = 1; i < track; i++)
+    {
+        offset += d64_sectors(i);
+    }
+
+    return (offset + sector) * 256;
+}
+
+/* =============================================================================
+ * void close_disk(disk_image *disk)
+ * =============================================================================
+ */
+void close_disk(disk_image *disk)
+{
+    unmap_file(&disk->file);
+    free(disk->entries);
+
+    memset(disk, 0, sizeof(disk_image));
+}
+
+/* =============================================================================
+ * int is_disk_image(const char *filename)
+ *
+ * return 1; // if filename ends with .d64, .d71 or .d81
+ * =============================================================================
+ */
+int is_disk_image(const char *filename)
+{
+    const char *ext = strrchr(filename, '.');
+
+    return ext != NULL && (strcasecmp(ext, ".d64") == 0
+        || strcasecmp(ext, ".d71") == 0
+        || strcasecmp(ext, ".d81") == 0);
+}
+
+/* =============================================================================
+ * int open_disk(disk_image *disk, const char *filename)
+ *
+ * return 0;  // on success
+ * return -1; // if the file couldn't be read or has none of the known sizes
+ *
+ * map the image and read the directory, only PRG files are kept
+ * =============================================================================
+ */
+int open_disk(disk_image *disk, const char *filename)
+{
+    const unsigned char *sector_data;
+    const unsigned char *dir_entry;
+    disk_entry          *new_entries;
+    long                offset;
+    int                 track;
+    int                 sector;
+    int                 visited;
+    int                 i;
+    int                 j;
+
+    memset(disk, 0, sizeof(disk_image));
+
+    if (map_file(&disk->file, filename) != 0)
+    {
+        return -1;
+    }
+
+    for (i = 0; i < sizeof(disk_formats) / sizeof(disk_formats[0]); i++)
+    {
+        if (disk->file.size == disk_formats[i].size)
+        {
+            break;
+        }
+    }
+    if (i == sizeof(disk_formats) / sizeof(disk_formats[0]))
+    {
+        close_disk(disk);
+        return -1;
+    }
+
+    disk->type = disk_formats[i].type;
+    disk->tracks = disk_formats[i].tracks;
+    disk->sectors = disk_formats[i].sectors;
+
+    track = (disk->type == DISK_D81) ? 40 : 18;
+    sector = (disk->type == DISK_D81) ? 3 : 1;
+
+    // a broken chain can't loop for longer than there are sectors
+    for (visited = 0; track != 0 && visited < disk->sectors; visited++)
+    {
+        offset = sector_offset(disk, track, sector);
+        if (offset < 0)
+        {
+            break;
+        }
+        sector_data = disk->file.data + offset;
+
+        for (j = 0; j < 8; j++)
+        {
+            dir_entry = sector_data + j * 32;
+            if (dir_entry[2] != 0x82)
+            {
+                continue;
+            }
+
+            if ((disk->entries_count & 0x3F) == 0)
+            {
+                new_entries = realloc(disk->entries,
+                    (disk->entries_count + 0x40) * sizeof(disk_entry));
+                if (new_entries == NULL)
+                {
+                    printf("\nError: out of memory.\n");
+                    exit(EXIT_FAILURE);
+                }
+                disk->entries = new_entries;
+            }
+
+            for (i = 0; i < 16 && dir_entry[5 + i] != 0xA0; i++)
+            {
+                disk->entries[disk->entries_count].name[i] = dir_entry[5 + i];
+            }
+            disk->entries[disk->entries_count].name[i] = '\0';
+            disk->entries[disk->entries_count].track = dir_entry[3];
+            disk->entries[disk->entries_count].sector = dir_entry[4];
+            disk->entries[disk->entries_count].blocks = dir_entry[30] + (dir_entry[31] << 8);
+            disk->entries_count++;
+        }
+
+        track = sector_data[0];
+        sector = sector_data[1];
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * long read_disk_file(const disk_image *disk, const disk_entry *entry,
+ *                     unsigned char *buffer, long size)
+ *
+ * return length;   // of the complete file
+ * return -1;       // if the sector chain is broken
+ *
+ * collect the sectors of entry into buffer. if the file is longer than size
+ * only the first size bytes are copied, the full length is returned anyway.
+ * nothing is copied for a size <= 0, e.g. the -1 of a broken chain.
+ * =============================================================================
+ */
+long read_disk_file(const disk_image *disk, const disk_entry *entry,
+    unsigned char *buffer, long size)
+{
+    const unsigned char *sector_data;
+    long                offset;
+    long                length      = 0;
+    int                 track       = entry->track;
+    int                 sector      = entry->sector;
+    int                 bytes;
+    int                 visited;
+
+    for (visited = 0; track != 0; visited++)
+    {
+        offset = sector_offset(disk, track, sector);
+        if (offset < 0 || visited == disk->sectors)
+        {
+            return -1;
+        }
+        sector_data = disk->file.data + offset;
+
+        track = sector_data[0];
+        sector = sector_data[1];
+
+        // last sector: sector byte is the offset of the last used byte
+        bytes = (track != 0) ? 254 : ((sector >= 2) ? sector - 1 : 0);
+
+        if (length < size)
+        {
+            memcpy(buffer + length, sector_data + 2,
+                (length + bytes <= size) ? bytes : size - length);
+        }
+        length += bytes;
+    }
+
+    return length;
+}
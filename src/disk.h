@@ -0,0 +1,42 @@
+#ifndef DISK_H_
+#define DISK_H_
+
+#include <stddef.h>
+#include "input.h"
+
+enum {
+    DISK_D64,
+    DISK_D71,
+    DISK_D81
+}; // disk image types
+
+/* one PRG file in the directory of a disk image
+ */
+typedef struct
+{
+    char            name[17];       // PETSCII, without the 0xA0 padding
+    int             track;          // first sector of the file
+    int             sector;
+    int             blocks;         // size as listed in the directory
+} disk_entry;
+
+/* a disk image mapped with map_file(), read-only after open_disk(), so any
+ * number of threads can read files from it at the same time
+ */
+typedef struct
+{
+    mapped_file     file;
+    int             type;
+    int             tracks;
+    int             sectors;        // total number of sectors
+    disk_entry      *entries;
+    int             entries_count;
+} disk_image;
+
+void close_disk(disk_image *disk);
+int is_disk_image(const char *filename);
+int open_disk(disk_image *disk, const char *filename);
+long read_disk_file(const disk_image *disk, const disk_entry *entry,
+    unsigned char *buffer, long size);
+
+#endif // DISK_H_
@@ -0,0 +1,827 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "disass.h"
+#include "emu.h"
+
+/* =============================================================================
+ * tracing
+ *
+ * the static analysis can't see code that is only reached through computed
+ * jumps, jump tables or code that is written at runtime. trace_code() runs the
+ * loaded file in a small 6510 core for a limited number of cycles and hands
+ * every address an opcode was fetched from to create_flowmap().
+ *
+ * the core uses opcodes[] for length, cycles and addressing mode of each
+ * instruction, so only the operation itself is decoded by opcode. all 256
+ * opcodes are executed like on a real 6510, independent of ctx->mode. a jsr
+ * into memory that was never loaded or written (KERNAL / BASIC calls) returns
+ * right away without changing any register.
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * int read_byte(cpu6510 *cpu, int address)
+ * void write_byte(cpu6510 *cpu, int address, int value)
+ *
+ * memory access with bookkeeping. the raster line runs with the cycles
+ * (63 cycles per line, 312 lines, PAL), so raster waits terminate. writing
+ * an address for the first time counts as progress for CPU_IDLE.
+ * =============================================================================
+ */
+static inline int read_byte(cpu6510 *cpu, int address)
+{
+    int raster;
+
+    set_bit(cpu->read, address);
+
+    if (address == 0xD011 || address == 0xD012)
+    {
+        raster = (cpu->cycles / 63) % 312;
+        if (address == 0xD012)
+        {
+            return raster & 0xFF;
+        }
+        return (cpu->memory[address] & 0x7F) | ((raster & 0x100) >> 1);
+    }
+
+    return cpu->memory[address];
+}
+
+static inline void write_byte(cpu6510 *cpu, int address, int value)
+{
+    if (!test_bit(cpu->written, address))
+    {
+        set_bit(cpu->written, address);
+        set_bit(cpu->valid, address);
+        cpu->progress = cpu->cycles;
+    }
+    cpu->layer[address] = (cpu->current_layer < 0xFF) ? cpu->current_layer + 1 : 0xFF;
+    cpu->memory[address] = value;
+}
+
+/* =============================================================================
+ * void push(cpu6510 *cpu, int value)
+ * int pull(cpu6510 *cpu)
+ * =============================================================================
+ */
+static inline void push(cpu6510 *cpu, int value)
+{
+    write_byte(cpu, 0x0100 + cpu->sp, value & 0xFF);
+    cpu->sp = (cpu->sp - 1) & 0xFF;
+}
+
+static inline int pull(cpu6510 *cpu)
+{
+    cpu->sp = (cpu->sp + 1) & 0xFF;
+    return read_byte(cpu, 0x0100 + cpu->sp);
+}
+
+/* =============================================================================
+ * int get_status(cpu6510 *cpu)
+ * void set_status(cpu6510 *cpu, int p)
+ *
+ * convert between the single flags and the status register NV-BDIZC
+ * =============================================================================
+ */
+static inline int get_status(cpu6510 *cpu)
+{
+    return ((cpu->nz & 0x180) ? 0x80 : 0x00)
+        | (cpu->v << 6)
+        | 0x30
+        | (cpu->d << 3)
+        | (cpu->i << 2)
+        | (((cpu->nz & 0xFF) == 0) << 1)
+        | cpu->c;
+}
+
+static inline void set_status(cpu6510 *cpu, int p)
+{
+    cpu->c = p & 1;
+    cpu->i = (p >> 2) & 1;
+    cpu->d = (p >> 3) & 1;
+    cpu->v = (p >> 6) & 1;
+    cpu->nz = ((p & 0x80) << 1) | ((p & 0x02) ? 0x00 : 0x01);
+}
+
+/* =============================================================================
+ * void adc(cpu6510 *cpu, int value)
+ * void sbc(cpu6510 *cpu, int value)
+ *
+ * in decimal mode n and z come from the decimal result, not from the binary
+ * one like on the NMOS cpu
+ * =============================================================================
+ */
+static inline void adc(cpu6510 *cpu, int value)
+{
+    int result;
+    int lo;
+    int hi;
+
+    if (!cpu->d)
+    {
+        result = cpu->a + value + cpu->c;
+        cpu->v = (~(cpu->a ^ value) & (cpu->a ^ result) & 0x80) != 0;
+        cpu->c = result > 0xFF;
+        cpu->a = cpu->nz = result & 0xFF;
+        return;
+    }
+
+    lo = (cpu->a & 0x0F) + (value & 0x0F) + cpu->c;
+    if (lo > 0x09)
+    {
+        lo += 0x06;
+    }
+    hi = (cpu->a >> 4) + (value >> 4) + (lo > 0x0F);
+
+    cpu->v = (~(cpu->a ^ value) & (cpu->a ^ (hi << 4)) & 0x80) != 0;
+    if (hi > 0x09)
+    {
+        hi += 0x06;
+    }
+    cpu->c = hi > 0x0F;
+    cpu->a = cpu->nz = ((hi << 4) | (lo & 0x0F)) & 0xFF;
+}
+
+static inline void sbc(cpu6510 *cpu, int value)
+{
+    int result;
+    int lo;
+    int hi;
+
+    result = cpu->a - value - (1 - cpu->c);
+    cpu->v = ((cpu->a ^ value) & (cpu->a ^ result) & 0x80) != 0;
+
+    if (!cpu->d)
+    {
+        cpu->c = result >= 0;
+        cpu->a = cpu->nz = result & 0xFF;
+        return;
+    }
+
+    lo = (cpu->a & 0x0F) - (value & 0x0F) - (1 - cpu->c);
+    hi = (cpu->a >> 4) - (value >> 4);
+    if (lo & 0x10)
+    {
+        lo -= 0x06;
+        hi--;
+    }
+    if (hi & 0x10)
+    {
+        hi -= 0x06;
+    }
+    cpu->c = result >= 0;
+    cpu->a = cpu->nz = ((hi << 4) | (lo & 0x0F)) & 0xFF;
+}
+
+/* =============================================================================
+ * void compare(cpu6510 *cpu, int reg, int value)
+ * =============================================================================
+ */
+static inline void compare(cpu6510 *cpu, int reg, int value)
+{
+    cpu->c = reg >= value;
+    cpu->nz = (reg - value) & 0xFF;
+}
+
+/* =============================================================================
+ * int asl(cpu6510 *cpu, int value)
+ * int lsr(cpu6510 *cpu, int value)
+ * int rol(cpu6510 *cpu, int value)
+ * int ror(cpu6510 *cpu, int value)
+ *
+ * return value; // shifted, c / n / z are set
+ * =============================================================================
+ */
+static inline int asl(cpu6510 *cpu, int value)
+{
+    cpu->c = value >> 7;
+    return cpu->nz = (value << 1) & 0xFF;
+}
+
+static inline int lsr(cpu6510 *cpu, int value)
+{
+    cpu->c = value & 1;
+    return cpu->nz = value >> 1;
+}
+
+static inline int rol(cpu6510 *cpu, int value)
+{
+    value = (value << 1) | cpu->c;
+    cpu->c = value >> 8;
+    return cpu->nz = value & 0xFF;
+}
+
+static inline int ror(cpu6510 *cpu, int value)
+{
+    value |= cpu->c << 8;
+    cpu->c = value & 1;
+    return cpu->nz = value >> 1;
+}
+
+/* =============================================================================
+ * void branch(cpu6510 *cpu, int condition, int address)
+ *
+ * one cycle more if taken, another one if the target is in another page
+ * =============================================================================
+ */
+static inline void branch(cpu6510 *cpu, int condition, int address)
+{
+    if (condition)
+    {
+        cpu->cycles += ((cpu->pc ^ address) & 0xFF00) ? 2 : 1;
+        cpu->pc = address;
+    }
+}
+
+/* =============================================================================
+ * int is_unpacked(cpu6510 *cpu, int address)
+ *
+ * return 1; // if address was written at runtime and isn't I/O or stack
+ * =============================================================================
+ */
+static inline int is_unpacked(cpu6510 *cpu, int address)
+{
+    return cpu->layer[address] > 0 && address >= 0x0200
+        && (address < 0xD000 || address >= 0xE000);
+}
+
+/* =============================================================================
+ * void take_snapshot(cpu6510 *cpu, int pc)
+ *
+ * copy memory when execution enters a new highest layer at pc. the
+ * snapshot range is the written area around pc.
+ * =============================================================================
+ */
+static void take_snapshot(cpu6510 *cpu, int pc)
+{
+    int start   = pc;
+    int end     = pc + 1;
+
+    memcpy(cpu->snapshot, cpu->memory, MEMORY_SIZE);
+
+    while (start > 0 && is_unpacked(cpu, start - 1))
+    {
+        start--;
+    }
+    while (end < MEMORY_SIZE && is_unpacked(cpu, end))
+    {
+        end++;
+    }
+
+    cpu->snapshot_layer = cpu->layer[pc];
+    cpu->snapshot_pc = pc;
+    cpu->snapshot_start = start;
+    cpu->snapshot_end = end;
+    cpu->snapshot_cycles = cpu->cycles;
+}
+
+/* =============================================================================
+ * cpu6510 *new_cpu()
+ * =============================================================================
+ */
+cpu6510 *new_cpu()
+{
+    cpu6510 *cpu;
+
+    cpu = calloc(1, sizeof(cpu6510));
+    if (cpu == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return cpu;
+}
+
+/* =============================================================================
+ * void reset_cpu(cpu6510 *cpu, disass_context *ctx)
+ *
+ * clear everything, copy the file loaded into ctx to memory and set pc to
+ * ctx->entry
+ * =============================================================================
+ */
+void reset_cpu(cpu6510 *cpu, disass_context *ctx)
+{
+    int pc;
+
+    memset(cpu, 0, sizeof(cpu6510));
+
+    memcpy(cpu->memory + ctx->pc_start, ctx->assembly.data, ctx->pc_end - ctx->pc_start);
+    for (pc = ctx->pc_start; pc < ctx->pc_end; pc++)
+    {
+        set_bit(cpu->valid, pc);
+    }
+
+    cpu->pc = ctx->entry;
+    cpu->sp = 0xFF;
+    cpu->nz = 0x01;
+}
+
+/* =============================================================================
+ * int run_cpu(cpu6510 *cpu, long max_cycles)
+ *
+ * return cpu->stop; // CPU_CYCLES if max_cycles were used up
+ *
+ * execute from cpu->pc until one of the reasons in emu.h stops the cpu.
+ * run_cpu() can be called again to continue after CPU_CYCLES.
+ *
+ * with idle_cycles set, a program that neither executes a new address nor
+ * writes a new one for that long is considered to be in its main loop and
+ * stopped with CPU_IDLE.
+ * =============================================================================
+ */
+int run_cpu(cpu6510 *cpu, long max_cycles)
+{
+    unsigned char   *memory     = cpu->memory;
+    long            cycles_end  = cpu->cycles + max_cycles;
+    int             address     = 0;
+    int             base;
+    int             opcode;
+    int             pc;
+    int             value;
+
+    cpu->stop = CPU_RUNNING;
+
+    while (cpu->stop == CPU_RUNNING)
+    {
+        if (cpu->cycles >= cycles_end)
+        {
+            cpu->stop = CPU_CYCLES;
+            break;
+        }
+
+        pc = cpu->pc;
+        if (!test_bit(cpu->valid, pc))
+        {
+            cpu->stop = CPU_UNMAPPED;
+            break;
+        }
+        if (!test_bit(cpu->executed, pc))
+        {
+            set_bit(cpu->executed, pc);
+            cpu->progress = cpu->cycles;
+        }
+        else if (cpu->idle_cycles && cpu->cycles - cpu->progress > cpu->idle_cycles)
+        {
+            cpu->stop = CPU_IDLE;
+            break;
+        }
+
+        if (cpu->layer[pc] != cpu->current_layer)
+        {
+            if (cpu->snapshots && cpu->layer[pc] > cpu->snapshot_layer)
+            {
+                take_snapshot(cpu, pc);
+                cpu->progress = cpu->cycles;
+            }
+            cpu->current_layer = cpu->layer[pc];
+        }
+
+        opcode = memory[pc];
+        cpu->pc = (pc + opcodes[opcode].bytes) & 0xFFFF;
+        cpu->cycles += opcodes[opcode].cycles;
+        cpu->instructions++;
+
+        // effective address, reads crossing a page take one cycle more
+        switch (opcodes[opcode].addressing_mode)
+        {
+        case IMM:
+            address = (pc + 1) & 0xFFFF;
+            break;
+        case ZP:
+            address = memory[(pc + 1) & 0xFFFF];
+            break;
+        case ZPX:
+            address = (memory[(pc + 1) & 0xFFFF] + cpu->x) & 0xFF;
+            break;
+        case ZPY:
+            address = (memory[(pc + 1) & 0xFFFF] + cpu->y) & 0xFF;
+            break;
+        case ABS:
+        case ABSI:
+            address = memory[(pc + 1) & 0xFFFF] + (memory[(pc + 2) & 0xFFFF] << 8);
+            break;
+        case ABSX:
+        case ABSY:
+            base = memory[(pc + 1) & 0xFFFF] + (memory[(pc + 2) & 0xFFFF] << 8);
+            address = (base + ((opcodes[opcode].addressing_mode == ABSX) ? cpu->x : cpu->y)) & 0xFFFF;
+            if (((base ^ address) & 0xFF00) && opcodes[opcode].cycles < 5)
+            {
+                cpu->cycles++;
+            }
+            break;
+        case INDX:
+            base = (memory[(pc + 1) & 0xFFFF] + cpu->x) & 0xFF;
+            address = read_byte(cpu, base) + (read_byte(cpu, (base + 1) & 0xFF) << 8);
+            break;
+        case INDY:
+            base = memory[(pc + 1) & 0xFFFF];
+            base = read_byte(cpu, base) + (read_byte(cpu, (base + 1) & 0xFF) << 8);
+            address = (base + cpu->y) & 0xFFFF;
+            if (((base ^ address) & 0xFF00) && opcodes[opcode].cycles < 6)
+            {
+                cpu->cycles++;
+            }
+            break;
+        case REL:
+            address = (cpu->pc + (signed char)memory[(pc + 1) & 0xFFFF]) & 0xFFFF;
+            break;
+        }
+
+        switch (opcode)
+        {
+        // loads and stores
+        case 0xA9: case 0xA5: case 0xB5: case 0xAD: case 0xBD: case 0xB9: case 0xA1: case 0xB1:
+            cpu->a = cpu->nz = read_byte(cpu, address);
+            break;
+        case 0xA2: case 0xA6: case 0xB6: case 0xAE: case 0xBE:
+            cpu->x = cpu->nz = read_byte(cpu, address);
+            break;
+        case 0xA0: case 0xA4: case 0xB4: case 0xAC: case 0xBC:
+            cpu->y = cpu->nz = read_byte(cpu, address);
+            break;
+        case 0x85: case 0x95: case 0x8D: case 0x9D: case 0x99: case 0x81: case 0x91:
+            write_byte(cpu, address, cpu->a);
+            break;
+        case 0x86: case 0x96: case 0x8E:
+            write_byte(cpu, address, cpu->x);
+            break;
+        case 0x84: case 0x94: case 0x8C:
+            write_byte(cpu, address, cpu->y);
+            break;
+
+        // arithmetic and logic
+        case 0x69: case 0x65: case 0x75: case 0x6D: case 0x7D: case 0x79: case 0x61: case 0x71:
+            adc(cpu, read_byte(cpu, address));
+            break;
+        case 0xE9: case 0xE5: case 0xF5: case 0xED: case 0xFD: case 0xF9: case 0xE1: case 0xF1:
+        case 0xEB:
+            sbc(cpu, read_byte(cpu, address));
+            break;
+        case 0x29: case 0x25: case 0x35: case 0x2D: case 0x3D: case 0x39: case 0x21: case 0x31:
+            cpu->a = cpu->nz = cpu->a & read_byte(cpu, address);
+            break;
+        case 0x09: case 0x05: case 0x15: case 0x0D: case 0x1D: case 0x19: case 0x01: case 0x11:
+            cpu->a = cpu->nz = cpu->a | read_byte(cpu, address);
+            break;
+        case 0x49: case 0x45: case 0x55: case 0x4D: case 0x5D: case 0x59: case 0x41: case 0x51:
+            cpu->a = cpu->nz = cpu->a ^ read_byte(cpu, address);
+            break;
+        case 0xC9: case 0xC5: case 0xD5: case 0xCD: case 0xDD: case 0xD9: case 0xC1: case 0xD1:
+            compare(cpu, cpu->a, read_byte(cpu, address));
+            break;
+        case 0xE0: case 0xE4: case 0xEC:
+            compare(cpu, cpu->x, read_byte(cpu, address));
+            break;
+        case 0xC0: case 0xC4: case 0xCC:
+            compare(cpu, cpu->y, read_byte(cpu, address));
+            break;
+        case 0x24: case 0x2C:
+            value = read_byte(cpu, address);
+            cpu->v = (value >> 6) & 1;
+            // n from memory, z from a & memory
+            cpu->nz = ((value & 0x80) << 1) | (cpu->a & value);
+            break;
+
+        // shifts and read-modify-write
+        case 0x0A:
+            cpu->a = asl(cpu, cpu->a);
+            break;
+        case 0x4A:
+            cpu->a = lsr(cpu, cpu->a);
+            break;
+        case 0x2A:
+            cpu->a = rol(cpu, cpu->a);
+            break;
+        case 0x6A:
+            cpu->a = ror(cpu, cpu->a);
+            break;
+        case 0x06: case 0x16: case 0x0E: case 0x1E:
+            write_byte(cpu, address, asl(cpu, read_byte(cpu, address)));
+            break;
+        case 0x46: case 0x56: case 0x4E: case 0x5E:
+            write_byte(cpu, address, lsr(cpu, read_byte(cpu, address)));
+            break;
+        case 0x26: case 0x36: case 0x2E: case 0x3E:
+            write_byte(cpu, address, rol(cpu, read_byte(cpu, address)));
+            break;
+        case 0x66: case 0x76: case 0x6E: case 0x7E:
+            write_byte(cpu, address, ror(cpu, read_byte(cpu, address)));
+            break;
+        case 0xE6: case 0xF6: case 0xEE: case 0xFE:
+            cpu->nz = (read_byte(cpu, address) + 1) & 0xFF;
+            write_byte(cpu, address, cpu->nz);
+            break;
+        case 0xC6: case 0xD6: case 0xCE: case 0xDE:
+            cpu->nz = (read_byte(cpu, address) - 1) & 0xFF;
+            write_byte(cpu, address, cpu->nz);
+            break;
+
+        // registers
+        case 0xE8:
+            cpu->x = cpu->nz = (cpu->x + 1) & 0xFF;
+            break;
+        case 0xC8:
+            cpu->y = cpu->nz = (cpu->y + 1) & 0xFF;
+            break;
+        case 0xCA:
+            cpu->x = cpu->nz = (cpu->x - 1) & 0xFF;
+            break;
+        case 0x88:
+            cpu->y = cpu->nz = (cpu->y - 1) & 0xFF;
+            break;
+        case 0xAA:
+            cpu->x = cpu->nz = cpu->a;
+            break;
+        case 0xA8:
+            cpu->y = cpu->nz = cpu->a;
+            break;
+        case 0x8A:
+            cpu->a = cpu->nz = cpu->x;
+            break;
+        case 0x98:
+            cpu->a = cpu->nz = cpu->y;
+            break;
+        case 0xBA:
+            cpu->x = cpu->nz = cpu->sp;
+            break;
+        case 0x9A:
+            cpu->sp = cpu->x;
+            break;
+
+        // stack
+        case 0x48:
+            push(cpu, cpu->a);
+            break;
+        case 0x68:
+            cpu->a = cpu->nz = pull(cpu);
+            break;
+        case 0x08:
+            push(cpu, get_status(cpu));
+            break;
+        case 0x28:
+            set_status(cpu, pull(cpu));
+            break;
+
+        // flags
+        case 0x18:
+            cpu->c = 0;
+            break;
+        case 0x38:
+            cpu->c = 1;
+            break;
+        case 0x58:
+            cpu->i = 0;
+            break;
+        case 0x78:
+            cpu->i = 1;
+            break;
+        case 0xB8:
+            cpu->v = 0;
+            break;
+        case 0xD8:
+            cpu->d = 0;
+            break;
+        case 0xF8:
+            cpu->d = 1;
+            break;
+
+        // branches
+        case 0x10:
+            branch(cpu, !(cpu->nz & 0x180), address);
+            break;
+        case 0x30:
+            branch(cpu, cpu->nz & 0x180, address);
+            break;
+        case 0x50:
+            branch(cpu, !cpu->v, address);
+            break;
+        case 0x70:
+            branch(cpu, cpu->v, address);
+            break;
+        case 0x90:
+            branch(cpu, !cpu->c, address);
+            break;
+        case 0xB0:
+            branch(cpu, cpu->c, address);
+            break;
+        case 0xD0:
+            branch(cpu, cpu->nz & 0xFF, address);
+            break;
+        case 0xF0:
+            branch(cpu, !(cpu->nz & 0xFF), address);
+            break;
+
+        // jumps
+        case 0x4C:
+            cpu->pc = address;
+            break;
+        case 0x6C:
+            // the high byte doesn't leave the page of the pointer
+            cpu->pc = read_byte(cpu, address)
+                + (read_byte(cpu, (address & 0xFF00) | ((address + 1) & 0xFF)) << 8);
+            break;
+        case 0x20:
+            if (!test_bit(cpu->valid, address))
+            {
+                break;  // ROM call
+            }
+            push(cpu, (cpu->pc - 1) >> 8);
+            push(cpu, cpu->pc - 1);
+            cpu->pc = address;
+            break;
+        case 0x60:
+            if (cpu->sp == 0xFF)
+            {
+                cpu->stop = CPU_RETURN;
+                break;
+            }
+            value = pull(cpu);
+            cpu->pc = (value + (pull(cpu) << 8) + 1) & 0xFFFF;
+            break;
+        case 0x40:
+            set_status(cpu, pull(cpu));
+            value = pull(cpu);
+            cpu->pc = value + (pull(cpu) << 8);
+            break;
+        case 0x00:
+            cpu->pc = pc;
+            cpu->stop = CPU_BRK;
+            break;
+
+        // illegal opcodes
+        case 0x07: case 0x17: case 0x0F: case 0x1F: case 0x1B: case 0x03: case 0x13:    // slo
+            value = asl(cpu, read_byte(cpu, address));
+            write_byte(cpu, address, value);
+            cpu->a = cpu->nz = cpu->a | value;
+            break;
+        case 0x27: case 0x37: case 0x2F: case 0x3F: case 0x3B: case 0x23: case 0x33:    // rla
+            value = rol(cpu, read_byte(cpu, address));
+            write_byte(cpu, address, value);
+            cpu->a = cpu->nz = cpu->a & value;
+            break;
+        case 0x47: case 0x57: case 0x4F: case 0x5F: case 0x5B: case 0x43: case 0x53:    // sre
+            value = lsr(cpu, read_byte(cpu, address));
+            write_byte(cpu, address, value);
+            cpu->a = cpu->nz = cpu->a ^ value;
+            break;
+        case 0x67: case 0x77: case 0x6F: case 0x7F: case 0x7B: case 0x63: case 0x73:    // rra
+            value = ror(cpu, read_byte(cpu, address));
+            write_byte(cpu, address, value);
+            adc(cpu, value);
+            break;
+        case 0xC7: case 0xD7: case 0xCF: case 0xDF: case 0xDB: case 0xC3: case 0xD3:    // dcp
+            value = (read_byte(cpu, address) - 1) & 0xFF;
+            write_byte(cpu, address, value);
+            compare(cpu, cpu->a, value);
+            break;
+        case 0xE7: case 0xF7: case 0xEF: case 0xFF: case 0xFB: case 0xE3: case 0xF3:    // isb
+            value = (read_byte(cpu, address) + 1) & 0xFF;
+            write_byte(cpu, address, value);
+            sbc(cpu, value);
+            break;
+        case 0x87: case 0x97: case 0x8F: case 0x83:                                     // sax
+            write_byte(cpu, address, cpu->a & cpu->x);
+            break;
+        case 0xA7: case 0xB7: case 0xAF: case 0xBF: case 0xA3: case 0xB3:               // lax
+            cpu->a = cpu->x = cpu->nz = read_byte(cpu, address);
+            break;
+        case 0x0B: case 0x2B:                                                           // anc
+            cpu->a = cpu->nz = cpu->a & read_byte(cpu, address);
+            cpu->c = cpu->a >> 7;
+            break;
+        case 0x4B:                                                                      // asr
+            cpu->a = lsr(cpu, cpu->a & read_byte(cpu, address));
+            break;
+        case 0x6B:                                                                      // arr
+            cpu->a = ror(cpu, cpu->a & read_byte(cpu, address));
+            cpu->c = (cpu->a >> 6) & 1;
+            cpu->v = ((cpu->a >> 6) ^ (cpu->a >> 5)) & 1;
+            break;
+        case 0x8B:                                                                      // ane
+            cpu->a = cpu->nz = (cpu->a | 0xEE) & cpu->x & read_byte(cpu, address);
+            break;
+        case 0xAB:                                                                      // lxa
+            cpu->a = cpu->x = cpu->nz = (cpu->a | 0xEE) & read_byte(cpu, address);
+            break;
+        case 0xCB:                                                                      // sbx
+            value = (cpu->a & cpu->x) - read_byte(cpu, address);
+            cpu->c = value >= 0;
+            cpu->x = cpu->nz = value & 0xFF;
+            break;
+        case 0x93: case 0x9F:                                                           // sha
+            write_byte(cpu, address, cpu->a & cpu->x & ((address >> 8) + 1));
+            break;
+        case 0x9E:                                                                      // shx
+            write_byte(cpu, address, cpu->x & ((address >> 8) + 1));
+            break;
+        case 0x9C:                                                                      // shy
+            write_byte(cpu, address, cpu->y & ((address >> 8) + 1));
+            break;
+        case 0x9B:                                                                      // shs
+            cpu->sp = cpu->a & cpu->x;
+            write_byte(cpu, address, cpu->sp & ((address >> 8) + 1));
+            break;
+        case 0xBB:                                                                      // lae
+            cpu->a = cpu->x = cpu->sp = cpu->nz = cpu->sp & read_byte(cpu, address);
+            break;
+        case 0x02: case 0x12: case 0x22: case 0x32: case 0x42: case 0x52:
+        case 0x62: case 0x72: case 0x92: case 0xB2: case 0xD2: case 0xF2:               // jam
+            cpu->pc = pc;
+            cpu->stop = CPU_JAM;
+            break;
+
+        // nop in all its lengths
+        default:
+            break;
+        }
+    }
+
+    return cpu->stop;
+}
+
+/* =============================================================================
+ * int trace_code(disass_context *ctx)
+ *
+ * return cpu->stop; // why the trace ended
+ *
+ * run the file loaded into ctx for ctx->trace_cycles and put every executed
+ * address inside the file on the worklist of create_flowmap()
+ * =============================================================================
+ */
+int trace_code(disass_context *ctx)
+{
+    int pc;
+
+    if (ctx->cpu == NULL)
+    {
+        ctx->cpu = new_cpu();
+    }
+
+    reset_cpu(ctx->cpu, ctx);
+    ctx->cpu->idle_cycles = IDLE_CYCLES;
+    run_cpu(ctx->cpu, ctx->trace_cycles);
+
+    for (pc = ctx->pc_end - 1; pc >= ctx->basic_end; pc--)
+    {
+        if (test_bit(ctx->cpu->executed, pc))
+        {
+            append_address(&ctx->worklist, pc);
+        }
+    }
+
+    return ctx->cpu->stop;
+}
+
+/* =============================================================================
+ * int unpack_code(disass_context *ctx)
+ *
+ * return 0;  // if ctx now holds the unpacked program
+ * return -1; // if nothing was unpacked, ctx is unchanged
+ *
+ * run the file loaded into ctx for up to ctx->unpack_cycles. the unpacked
+ * program is the memory at the moment execution entered the highest layer
+ * (see emu.h), usually the final jump of the decruncher. a decruncher that
+ * copies itself somewhere else first is no problem, the copy is a lower
+ * layer than what it unpacks. the written area around the jump target is
+ * loaded into ctx with the jump target as ctx->entry.
+ * =============================================================================
+ */
+int unpack_code(disass_context *ctx)
+{
+    cpu6510 *cpu;
+
+    if (ctx->cpu == NULL)
+    {
+        ctx->cpu = new_cpu();
+    }
+    cpu = ctx->cpu;
+
+    reset_cpu(cpu, ctx);
+    cpu->idle_cycles = IDLE_CYCLES;
+    cpu->snapshots = 1;
+    run_cpu(cpu, ctx->unpack_cycles);
+
+    if (cpu->snapshot_layer == 0)
+    {
+        return -1;
+    }
+
+    if (ctx->unpacked == NULL)
+    {
+        ctx->unpacked = malloc(MEMORY_SIZE);
+        if (ctx->unpacked == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    memcpy(ctx->unpacked, cpu->snapshot, MEMORY_SIZE);
+
+    load_buffer(ctx, ctx->unpacked + cpu->snapshot_start,
+        cpu->snapshot_end - cpu->snapshot_start, cpu->snapshot_start);
+    ctx->entry = cpu->snapshot_pc;
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#ifndef EMU_H_
+#define EMU_H_
+
+#include "disass.h"
+
+enum {
+    CPU_RUNNING,
+    CPU_CYCLES,     // cycle budget used up
+    CPU_JAM,        // jam opcode
+    CPU_BRK,        // brk, there is no irq handler without the ROMs
+    CPU_RETURN,     // rts with an empty stack, back to BASIC
+    CPU_UNMAPPED,   // jump to memory that was neither loaded nor written
+    CPU_IDLE        // nothing new executed or written for idle_cycles
+}; // reasons for run_cpu() to stop
+
+#define IDLE_CYCLES     2000000     // 2 seconds on a C64
+
+/* 6510 with 64 KB of plain RAM. only the loaded file is there, no ROMs, no
+ * interrupts and no I/O chips except the raster line in 0xD011 / 0xD012.
+ * every access is recorded with one bit per address.
+ *
+ * each byte also has a layer: loaded bytes are layer 0, a byte written by an
+ * instruction of layer n gets layer n + 1. jumping into a higher layer means
+ * code that was generated or unpacked at runtime starts, see unpack_code().
+ *
+ * always allocate it with new_cpu().
+ */
+typedef struct cpu6510
+{
+    unsigned char   memory[MEMORY_SIZE];
+    unsigned char   valid[MEMORY_SIZE / 8];     // loaded or written
+    unsigned char   executed[MEMORY_SIZE / 8];  // opcode fetched from here
+    unsigned char   read[MEMORY_SIZE / 8];
+    unsigned char   written[MEMORY_SIZE / 8];
+    unsigned char   layer[MEMORY_SIZE];
+    unsigned char   snapshot[MEMORY_SIZE];      // memory when the highest layer was entered
+    int             a;
+    int             x;
+    int             y;
+    int             sp;
+    int             pc;
+    int             c;              // flags, each 0 or 1
+    int             d;
+    int             i;
+    int             v;
+    int             nz;             // last result: n is bit 7 or 8, z is bits 0-7 == 0
+    int             current_layer;  // layer of the last executed opcode
+    long            cycles;
+    long            instructions;
+    long            idle_cycles;    // >0: stop with CPU_IDLE, see run_cpu()
+    long            progress;       // cycles when something new was executed or written
+    int             snapshots;      // 1: fill snapshot on each new highest layer
+    int             snapshot_layer; // 0: no snapshot yet
+    int             snapshot_pc;
+    int             snapshot_start; // written area around snapshot_pc
+    int             snapshot_end;
+    long            snapshot_cycles;
+    int             stop;           // CPU_RUNNING or why run_cpu() stopped
+} cpu6510;
+
+/* =============================================================================
+ * int test_bit(const unsigned char *map, int address)
+ * void set_bit(unsigned char *map, int address)
+ *
+ * access the bitmaps of cpu6510, one bit per address
+ * =============================================================================
+ */
+static inline int test_bit(const unsigned char *map, int address)
+{
+    return (map[address >> 3] >> (address & 7)) & 1;
+}
+
+static inline void set_bit(unsigned char *map, int address)
+{
+    map[address >> 3] |= 1 << (address & 7);
+}
+
+cpu6510 *new_cpu();
+void reset_cpu(cpu6510 *cpu, disass_context *ctx);
+int run_cpu(cpu6510 *cpu, long max_cycles);
+int trace_code(disass_context *ctx);
+int unpack_code(disass_context *ctx);
+
+#endif // EMU_H_
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <string.h>
+#include "export.h"
+#include "listing.h"
+#include "output.h"
+#include "timing.h"
+
+/* =============================================================================
+ * exports
+ *
+ * the listing as records for other tools, one per instruction, row of data
+ * bytes and piece of the BASIC stub, in the order of the disassembly. a
+ * label at pc is named in the record of pc. both formats are rendered like
+ * any other syntax, see -F jsonl / bin.
+ *
+ * JSON Lines: a "file" object first, then one object per record:
+ *
+ *      {"type": "code", "pc": 4096, "bytes": "a900", "mnemonic": "lda",
+ *       "mode": "imm", "operand": 0, "cycles": 2, "cycles_max": 2,
+ *       "label": "pc1000"}
+ *
+ * "cycles_max" with a page crossed or a branch taken, see timing.c. "label"
+ * only if there is one, "target" with the name of the operand if it
+ * is printed as a label. data and basic records have type, pc, bytes and
+ * label.
+ *
+ * binary, little endian, made to be mapped and walked without parsing:
+ *
+ *      +0  EXPORT_MAGIC
+ *      +8  u32 number of records
+ *      +12 u32 offset of the string table
+ *      +16 u32 size of the string table
+ *      +20 u32 pc_start
+ *      +24 u32 pc_end
+ *      +28 u16 entry
+ *      +30 u8  cpu mode, MODE6502 / MODE6510
+ *      +31 u8  EXPORT_RECORD
+ *
+ * followed by the records of EXPORT_RECORD bytes
+ *
+ *      +0  u16 pc
+ *      +2  u16 number of bytes
+ *      +4  u16 operand, branches as target, 0 for data
+ *      +6  u8  RECORD_CODE etc.
+ *      +7  u8  first byte, i.e. the opcode
+ *      +8  u8  addressing mode as in opcodes[], NONE for data
+ *      +9  u8  cycles from opcodes[], 0 for data
+ *      +10 u8  RECORD_LABEL / RECORD_TARGET
+ *      +11 u8  cycles with a page crossed or a branch taken, 0 for data
+ *      +12 u32 offset of the label name in the string table or
+ *              EXPORT_NO_LABEL
+ *
+ * and the string table, 0-terminated label names.
+ * =============================================================================
+ */
+
+static const char *mode_names[] = {
+    "none", "acc", "imp", "imm", "zp", "zpx", "zpy", "abs", "absx", "absy", "absi",
+    "indx", "indy", "rel"
+};
+
+static const char *record_names[] = { "code", "data", "basic" };
+
+/* =============================================================================
+ * const char *label_name(const disass_context *ctx, int pc, char *buffer)
+ *
+ * return name; // of the label at pc, from the annotations or pc{XXXX} in
+ *              // buffer, which needs room for 7 chars
+ * =============================================================================
+ */
+static const char *label_name(const disass_context *ctx, int pc, char *buffer)
+{
+    const char  *name;
+
+    if (ctx->notes != NULL && (name = find_label_name(ctx->notes, pc)) != NULL)
+    {
+        return name;
+    }
+
+    snprintf(buffer, 7, "pc%04X", pc & 0xFFFF);
+    return buffer;
+}
+
+/* =============================================================================
+ * int record_type(const disass_context *ctx, const listing_line *line)
+ *
+ * return type;  // RECORD_CODE etc.
+ * return -1;    // if line doesn't get a record
+ * =============================================================================
+ */
+static int record_type(const disass_context *ctx, const listing_line *line)
+{
+    switch (line->type)
+    {
+    case LINE_INSTRUCTION:
+        return RECORD_CODE;
+    case LINE_BYTES:
+        // the tokens and 0x00 of the BASIC stub
+        return (line->pc < ctx->basic_end) ? RECORD_BASIC : RECORD_DATA;
+    case LINE_WORD:
+    case LINE_TEXT:
+        return RECORD_BASIC;
+    default:
+        return -1;
+    }
+}
+
+/* =============================================================================
+ * int is_record_label(const disass_context *ctx, const listing *list, int i)
+ *
+ * return 1; // if line i is a label that goes into the record after it
+ * =============================================================================
+ */
+static int is_record_label(const disass_context *ctx, const listing *list, int i)
+{
+    return list->lines[i].type == LINE_LABEL && i + 1 < list->count
+        && record_type(ctx, &list->lines[i+1]) >= 0 && list->lines[i+1].pc == list->lines[i].pc;
+}
+
+static inline void output_u16(disass_context *ctx, unsigned int value)
+{
+    char *p = reserve_output(ctx, 2);
+
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    ctx->out.length += 2;
+}
+
+static inline void output_u32(disass_context *ctx, unsigned int value)
+{
+    output_u16(ctx, value & 0xFFFF);
+    output_u16(ctx, value >> 16);
+}
+
+/* =============================================================================
+ * void output_json_string(disass_context *ctx, const char *string)
+ *
+ * string in double quotes, with '"', '\' and control characters escaped
+ * =============================================================================
+ */
+static void output_json_string(disass_context *ctx, const char *string)
+{
+    const unsigned char *c;
+
+    output_char(ctx, '"');
+
+    for (c = (const unsigned char *)string; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            output_char(ctx, '\\');
+            output_char(ctx, *c);
+        }
+        else if (*c < 0x20)
+        {
+            output_string(ctx, "\\u00");
+            output_hex8(ctx, *c);
+        }
+        else
+        {
+            output_char(ctx, *c);
+        }
+    }
+
+    output_char(ctx, '"');
+}
+
+/* =============================================================================
+ * void export_binary(disass_context *ctx, const listing *list)
+ *
+ * list as the binary format above
+ * =============================================================================
+ */
+void export_binary(disass_context *ctx, const listing *list)
+{
+    const listing_line  *line;
+    const opcode        *op;
+    const char          *name;
+    char                buffer[8];
+    unsigned int        records         = 0;
+    unsigned int        strings         = 0;
+    int                 label           = -1;   // pc of a label waiting for its record
+    int                 type;
+    int                 flags;
+    int                 min             = 0;
+    int                 max             = 0;
+    int                 i;
+
+    // pass 1: sizes, pass 2: records, pass 3: the string table
+    for (i = 0; i < list->count; i++)
+    {
+        line = &list->lines[i];
+
+        if (is_record_label(ctx, list, i))
+        {
+            strings += strlen(label_name(ctx, line->pc, buffer)) + 1;
+        }
+        records += (record_type(ctx, line) >= 0);
+    }
+
+    output_chars(ctx, EXPORT_MAGIC, 8);
+    output_u32(ctx, records);
+    output_u32(ctx, EXPORT_HEADER + records * EXPORT_RECORD);
+    output_u32(ctx, strings);
+    output_u32(ctx, ctx->pc_start);
+    output_u32(ctx, ctx->pc_end);
+    output_u16(ctx, ctx->entry);
+    output_char(ctx, ctx->mode);
+    output_char(ctx, EXPORT_RECORD);
+
+    strings = 0;
+    for (i = 0; i < list->count; i++)
+    {
+        line = &list->lines[i];
+
+        if (line->type == LINE_LABEL)
+        {
+            label = is_record_label(ctx, list, i) ? line->pc : -1;
+            continue;
+        }
+
+        type = record_type(ctx, line);
+        if (type < 0)
+        {
+            continue;
+        }
+
+        op = &opcodes[get_byte(ctx, line->pc - ctx->pc_start)];
+        if (type == RECORD_CODE)
+        {
+            instruction_cycles(ctx, line, &min, &max);
+        }
+        flags = (label == line->pc) ? RECORD_LABEL : 0;
+        if (line->flags & LINE_TARGET)
+        {
+            flags |= RECORD_TARGET;
+        }
+
+        output_u16(ctx, line->pc);
+        output_u16(ctx, line->count);
+        output_u16(ctx, (type == RECORD_CODE) ? line->value : 0);
+        output_char(ctx, type);
+        output_char(ctx, get_byte(ctx, line->pc - ctx->pc_start));
+        output_char(ctx, (type == RECORD_CODE) ? op->addressing_mode : NONE);
+        output_char(ctx, (type == RECORD_CODE) ? op->cycles : 0);
+        output_char(ctx, flags);
+        output_char(ctx, (type == RECORD_CODE) ? max : 0);
+
+        if (flags & RECORD_LABEL)
+        {
+            output_u32(ctx, strings);
+            strings += strlen(label_name(ctx, label, buffer)) + 1;
+        }
+        else
+        {
+            output_u32(ctx, EXPORT_NO_LABEL);
+        }
+        label = -1;
+    }
+
+    for (i = 0; i < list->count; i++)
+    {
+        if (is_record_label(ctx, list, i))
+        {
+            name = label_name(ctx, list->lines[i].pc, buffer);
+            output_chars(ctx, name, strlen(name) + 1);
+        }
+    }
+}
+
+/* =============================================================================
+ * void export_jsonl(disass_context *ctx, const listing *list)
+ *
+ * list as JSON Lines, see above
+ * =============================================================================
+ */
+void export_jsonl(disass_context *ctx, const listing *list)
+{
+    const listing_line  *line;
+    const opcode        *op;
+    char                buffer[8];
+    int                 label           = -1;
+    int                 type;
+    int                 min;
+    int                 max;
+    int                 i;
+    int                 j;
+
+    output_string(ctx, "{\"type\": \"file\", \"name\": ");
+    output_json_string(ctx, ctx->assembly.name);
+    output_printf(ctx, ", \"pc_start\": %d, \"pc_end\": %d, \"entry\": %d, \"cpu\": \"%s\"}\n",
+        ctx->pc_start, ctx->pc_end, ctx->entry, (ctx->mode == MODE6510) ? "6510" : "6502");
+
+    for (i = 0; i < list->count; i++)
+    {
+        line = &list->lines[i];
+
+        if (line->type == LINE_LABEL)
+        {
+            label = is_record_label(ctx, list, i) ? line->pc : -1;
+            continue;
+        }
+
+        type = record_type(ctx, line);
+        if (type < 0)
+        {
+            continue;
+        }
+
+        output_printf(ctx, "{\"type\": \"%s\", \"pc\": %d, \"bytes\": \"", record_names[type], line->pc);
+        for (j = 0; j < line->count; j++)
+        {
+            output_hex8(ctx, get_byte(ctx, line->pc + j - ctx->pc_start));
+        }
+        output_char(ctx, '"');
+
+        if (type == RECORD_CODE)
+        {
+            op = &opcodes[get_byte(ctx, line->pc - ctx->pc_start)];
+            instruction_cycles(ctx, line, &min, &max);
+            output_string(ctx, ", \"mnemonic\": \"");
+            output_chars(ctx, op->name, 3);
+            output_printf(ctx, "\", \"mode\": \"%s\", \"operand\": %d, \"cycles\": %d, \"cycles_max\": %d",
+                mode_names[op->addressing_mode], line->value, min, max);
+
+            if (line->flags & LINE_TARGET)
+            {
+                output_string(ctx, ", \"target\": ");
+                output_json_string(ctx, label_name(ctx, line->value, buffer));
+            }
+        }
+
+        if (label == line->pc)
+        {
+            output_string(ctx, ", \"label\": ");
+            output_json_string(ctx, label_name(ctx, label, buffer));
+        }
+        label = -1;
+
+        output_string(ctx, "}\n");
+    }
+}
@@ -0,0 +1,23 @@
+#ifndef EXPORT_H_
+#define EXPORT_H_
+
+#include "disass.h"
+
+#define EXPORT_MAGIC        "ADLIST01"
+#define EXPORT_HEADER       32
+#define EXPORT_RECORD       16
+#define EXPORT_NO_LABEL     0xFFFFFFFF
+
+enum {
+    RECORD_CODE,
+    RECORD_DATA,
+    RECORD_BASIC
+}; // type of an exported record
+
+#define RECORD_LABEL        0x01    // a label points at pc
+#define RECORD_TARGET       0x02    // the operand is printed as a label
+
+void export_binary(disass_context *ctx, const listing *list);
+void export_jsonl(disass_context *ctx, const listing *list);
+
+#endif // EXPORT_H_
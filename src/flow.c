@@ -0,0 +1,641 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "disass.h"
+#include "emu.h"
+#include "project.h"
+
+#define DISPATCH_HISTORY    5       // instructions of the longest dispatch idiom
+#define DISPATCH_ENTRIES    256     // at most in one table
+#define DISPATCH_WALK       256     // instructions checked behind a table entry
+
+int entry_vectors[] = {
+    0x0314,     // IRQ
+    0x0316,     // BRK
+    0x0318,     // NMI
+    0xFFFA,     // hardware NMI
+    0xFFFC,     // hardware RESET
+    0xFFFE      // hardware IRQ / BRK
+};
+
+/* =============================================================================
+ * flow analysis
+ *
+ * instead of guessing code from 0x60 / 0x4C / 0x6C bytes, only what the cpu
+ * can actually reach is marked as code:
+ *
+ *      1.) entry points are ctx->entry (pc_start, the SYS target of a BASIC
+ *          stub or where unpack_code() ended), the vectors in
+ *          entry_vectors[] if they are part of the loaded file and point
+ *          into it, everything given by add_entry(), the entries and forced
+ *          code ranges of ctx->notes and everything trace_code() has
+ *          executed
+ *
+ *      2.) each entry is followed instruction by instruction until
+ *          rts / rti / jmp / jam, an illegal opcode, the end of the file or
+ *          a byte that already is code
+ *
+ *      3.) targets of jsr, jmp and branches inside the file go to the
+ *          worklist and are followed later the same way
+ *
+ *      4.) so do the targets of jump tables. an rts or jmp () that ends one
+ *          of the usual dispatch idioms has its tables decoded, see
+ *          follow_dispatch()
+ *
+ * a byte becomes code exactly once and is never looked at again after that,
+ * so the whole analysis is linear in the size of the file. everything not
+ * reached stays DATATYPE_DATA.
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * void add_entry(disass_context *ctx, int pc)
+ *
+ * follow code from pc in addition to the entries found by create_flowmap().
+ * entries stay in ctx until free_context(), reset_context() keeps them.
+ * =============================================================================
+ */
+void add_entry(disass_context *ctx, int pc)
+{
+    append_address(&ctx->entries, pc & 0xFFFF);
+}
+
+/* =============================================================================
+ * int get_target(disass_context *ctx, int pc)
+ *
+ * return address;   // jump / branch target of the instruction at pc
+ * return -1;        // if it has none or the target is outside of the file
+ * =============================================================================
+ */
+static int get_target(disass_context *ctx, int pc)
+{
+    int i       = pc - ctx->pc_start;
+    int address;
+
+    switch (ctx->assembly.data[i])
+    {
+    case 0x20:  // jsr
+    case 0x4C:  // jmp
+        address = get_byte(ctx, i+1) + (get_byte(ctx, i+2) << 8);
+        break;
+    default:
+        if (opcodes[ctx->assembly.data[i]].addressing_mode != REL)
+        {
+            return -1;
+        }
+        address = (pc + 2 + (signed char)get_byte(ctx, i+1)) & 0xFFFF;
+        break;
+    }
+
+    if (address < ctx->basic_end || address >= ctx->pc_end)
+    {
+        return -1;
+    }
+
+    return address;
+}
+
+/* =============================================================================
+ * int get_word(disass_context *ctx, int pc)
+ *
+ * return value; // of the 16 bit word at pc, lo first
+ * =============================================================================
+ */
+static int get_word(disass_context *ctx, int pc)
+{
+    return get_byte(ctx, pc - ctx->pc_start) + (get_byte(ctx, pc + 1 - ctx->pc_start) << 8);
+}
+
+/* =============================================================================
+ * int is_table_load(disass_context *ctx, int pc)
+ * int is_store(disass_context *ctx, int pc, int address)
+ *
+ * return 1; // if the instruction at pc is lda abs,x / abs,y
+ * return 1; // if the instruction at pc is sta address
+ * =============================================================================
+ */
+static int is_table_load(disass_context *ctx, int pc)
+{
+    int opcode = get_byte(ctx, pc - ctx->pc_start);
+
+    return opcode == 0xBD || opcode == 0xB9;
+}
+
+static int is_store(disass_context *ctx, int pc, int address)
+{
+    switch (get_byte(ctx, pc - ctx->pc_start))
+    {
+    case 0x85:
+        return get_byte(ctx, pc + 1 - ctx->pc_start) == address;
+    case 0x8D:
+        return get_word(ctx, pc + 1) == address;
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * int is_jump_target(disass_context *ctx, int pc)
+ *
+ * return 1; // if the instructions from pc, which is in the file and after the
+ *           // BASIC stub, run into rts / rti / jmp or code found before
+ *           // within DISPATCH_WALK instructions without an illegal opcode
+ *           // or jam on the way. anything read from a table isn't trusted
+ *           // more than what create_datamap() guesses.
+ * =============================================================================
+ */
+static int is_jump_target(disass_context *ctx, int pc)
+{
+    int opcode;
+    int i;
+
+    if (pc < ctx->basic_end || pc >= ctx->pc_end)
+    {
+        return 0;
+    }
+
+    for (i = 0; i < DISPATCH_WALK && pc < ctx->pc_end; i++)
+    {
+        if (get_datatype(ctx, pc) != DATATYPE_DATA)
+        {
+            return 1;
+        }
+
+        opcode = ctx->assembly.data[pc - ctx->pc_start];
+        if (!is_in_mode(ctx, opcode) || pc + opcodes[opcode].bytes > ctx->pc_end)
+        {
+            return 0;
+        }
+        if (is_flow_end(opcode))
+        {
+            return memcmp(opcodes[opcode].name, "jam", 3) != 0;
+        }
+
+        pc += opcodes[opcode].bytes;
+    }
+
+    return i == DISPATCH_WALK;
+}
+
+/* =============================================================================
+ * void claim_table(disass_context *ctx, int pc, int pc_end, block_list *claimed)
+ *
+ * make the table from pc up to pc_end data in a guessed datamap, together
+ * with the guessed code right behind it up to its rts / jmp. that code is
+ * most likely the table itself decoded as instructions and out of step with
+ * what follows. the range of that code goes to claimed, whatever the
+ * remaining code jumps to in there is followed again, see
+ * follow_claimed_targets().
+ * =============================================================================
+ */
+static void claim_table(disass_context *ctx, int pc, int pc_end, block_list *claimed)
+{
+    datablock   block;
+    int         end     = pc_end;
+    int         opcode;
+    int         i;
+
+    for (i = pc; i < pc_end; i++)
+    {
+        set_datatype(ctx, i, DATATYPE_DATA);
+    }
+
+    while (end < ctx->pc_end && get_datatype(ctx, end) == DATATYPE_CODE)
+    {
+        set_datatype(ctx, end++, DATATYPE_DATA);
+    }
+    if (end < ctx->pc_end && get_datatype(ctx, end) == DATATYPE_CODE_END)
+    {
+        opcode = ctx->assembly.data[end - ctx->pc_start];
+        for (i = (opcode == 0x4C || opcode == 0x6C) ? 3 : 1; i > 0 && end < ctx->pc_end; i--)
+        {
+            set_datatype(ctx, end++, DATATYPE_DATA);
+        }
+    }
+
+    if (end > pc_end)
+    {
+        block.pc_start = pc_end;
+        block.pc_end = end;
+        block.type = DATATYPE_DATA;
+        append_block(claimed, block);
+    }
+}
+
+/* =============================================================================
+ * int compare_blocks(const void *a, const void *b)
+ *
+ * qsort() helper, by pc_start
+ * =============================================================================
+ */
+static int compare_blocks(const void *a, const void *b)
+{
+    return ((const datablock *)a)->pc_start - ((const datablock *)b)->pc_start;
+}
+
+/* =============================================================================
+ * void follow_claimed_targets(disass_context *ctx, block_list *claimed)
+ *
+ * put everything the code jumps to in one of the claimed ranges of
+ * claim_table() on the worklist. they never overlap, each claim only takes
+ * what still is code, so one walk over the code with a binary search per
+ * target covers all tables of follow_jump_tables() at once.
+ * =============================================================================
+ */
+static void follow_claimed_targets(disass_context *ctx, block_list *claimed)
+{
+    int target;
+    int opcode;
+    int low;
+    int high;
+    int middle;
+    int i;
+
+    if (claimed->count == 0)
+    {
+        return;
+    }
+
+    qsort(claimed->blocks, claimed->count, sizeof(datablock), compare_blocks);
+
+    for (i = ctx->basic_end; i < ctx->pc_end; )
+    {
+        opcode = ctx->assembly.data[i - ctx->pc_start];
+        if (!is_in_mode(ctx, opcode) || get_datatype(ctx, i) == DATATYPE_DATA)
+        {
+            i++;
+            continue;
+        }
+
+        // the last range that starts at or before target
+        target = get_target(ctx, i);
+        low = 0;
+        high = claimed->count - 1;
+        while (low < high)
+        {
+            middle = (low + high + 1) / 2;
+            if (claimed->blocks[middle].pc_start <= target)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle - 1;
+            }
+        }
+
+        if (target >= claimed->blocks[low].pc_start && target < claimed->blocks[low].pc_end)
+        {
+            append_address(&ctx->worklist, target);
+        }
+        i += opcodes[opcode].bytes;
+    }
+}
+
+/* =============================================================================
+ * int table_entry(disass_context *ctx, int lo, int hi, int i, int offset)
+ *
+ * return address; // entry i of the jump table at lo / hi, plus offset
+ * =============================================================================
+ */
+static int table_entry(disass_context *ctx, int lo, int hi, int i, int offset)
+{
+    return (get_byte(ctx, lo + i - ctx->pc_start) + (get_byte(ctx, hi + i - ctx->pc_start) << 8)
+        + offset) & 0xFFFF;
+}
+
+/* =============================================================================
+ * void decode_table(disass_context *ctx, int lo, int hi, int offset,
+ *      block_list *claimed)
+ *
+ * put the addresses of the jump table with low bytes at lo and high bytes at
+ * hi, plus offset, on the worklist. with hi = lo + 1 it's a table of words.
+ * the table ends before the first entry that points outside the file, into
+ * the table or at an illegal opcode, when the low bytes reach the high bytes
+ * or after DISPATCH_ENTRIES.
+ *
+ * every byte of the table has to be data, unless claimed is given for a
+ * guessed datamap, see claim_table(). either way only the entries up to the
+ * first one that fails is_jump_target() are followed.
+ * =============================================================================
+ */
+static void decode_table(disass_context *ctx, int lo, int hi, int offset,
+    block_list *claimed)
+{
+    int stride  = (hi == lo + 1) ? 2 : 1;
+    int limit   = (stride == 2) ? DISPATCH_ENTRIES : abs(hi - lo);
+    int first   = (lo < hi) ? lo : hi;
+    int last    = (lo < hi) ? hi : lo;
+    int target;
+    int count;
+    int i;
+
+    if (limit > DISPATCH_ENTRIES)
+    {
+        limit = DISPATCH_ENTRIES;
+    }
+
+    for (count = 0; count < limit; count++)
+    {
+        if (first < ctx->basic_end || last + count * stride >= ctx->pc_end
+            || (claimed == NULL && (get_datatype(ctx, lo + count * stride) != DATATYPE_DATA
+                || get_datatype(ctx, hi + count * stride) != DATATYPE_DATA)))
+        {
+            break;
+        }
+
+        // nothing jumps into its own table
+        target = table_entry(ctx, lo, hi, count * stride, offset);
+        if (target < ctx->basic_end || target >= ctx->pc_end
+            || (target >= first && target <= last + count * stride)
+            || !is_in_mode(ctx, ctx->assembly.data[target - ctx->pc_start]))
+        {
+            break;
+        }
+    }
+
+    if (claimed != NULL && count > 0 && stride == 2)
+    {
+        claim_table(ctx, lo, lo + count * 2, claimed);
+    }
+    else if (claimed != NULL && count > 0)
+    {
+        claim_table(ctx, lo, lo + count, claimed);
+        claim_table(ctx, hi, hi + count, claimed);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        target = table_entry(ctx, lo, hi, i * stride, offset);
+        if (!is_jump_target(ctx, target))
+        {
+            return;
+        }
+
+        if (get_datatype(ctx, target) == DATATYPE_DATA)
+        {
+            append_address(&ctx->worklist, target);
+        }
+    }
+}
+
+/* =============================================================================
+ * void follow_dispatch(disass_context *ctx, const int *history, int count,
+ *      block_list *claimed)
+ *
+ * history holds the pcs of the last count instructions up to an rts or a
+ * jmp (). if they are one of
+ *
+ *      lda hi,x / pha / lda lo,x / pha / rts   the rts trick, rts adds 1
+ *      lda lo,x / sta vector / lda hi,x / sta vector+1 / jmp (vector)
+ *      jmp (vector)                            with the vector in the file
+ *
+ * the table entries or the vector go on the worklist. abs,y and the two
+ * stores the other way round work as well. claimed as in decode_table().
+ * =============================================================================
+ */
+static void follow_dispatch(disass_context *ctx, const int *history, int count,
+    block_list *claimed)
+{
+    int pc      = history[count - 1];
+    int vector;
+    int target;
+
+    if (get_byte(ctx, pc - ctx->pc_start) == 0x60)
+    {
+        if (count == DISPATCH_HISTORY && is_table_load(ctx, history[0])
+            && get_byte(ctx, history[1] - ctx->pc_start) == 0x48
+            && is_table_load(ctx, history[2])
+            && get_byte(ctx, history[3] - ctx->pc_start) == 0x48)
+        {
+            decode_table(ctx, get_word(ctx, history[2] + 1), get_word(ctx, history[0] + 1), 1, claimed);
+        }
+        return;
+    }
+
+    vector = get_word(ctx, pc + 1);
+
+    if (count == DISPATCH_HISTORY && is_table_load(ctx, history[0]) && is_table_load(ctx, history[2]))
+    {
+        if (is_store(ctx, history[1], vector) && is_store(ctx, history[3], vector + 1))
+        {
+            decode_table(ctx, get_word(ctx, history[0] + 1), get_word(ctx, history[2] + 1), 0, claimed);
+            return;
+        }
+        if (is_store(ctx, history[1], vector + 1) && is_store(ctx, history[3], vector))
+        {
+            decode_table(ctx, get_word(ctx, history[2] + 1), get_word(ctx, history[0] + 1), 0, claimed);
+            return;
+        }
+    }
+
+    if (vector >= ctx->basic_end && vector + 2 <= ctx->pc_end)
+    {
+        target = get_word(ctx, vector);
+        if (is_jump_target(ctx, target) && get_datatype(ctx, target) == DATATYPE_DATA)
+        {
+            append_address(&ctx->worklist, target);
+        }
+    }
+}
+
+/* =============================================================================
+ * void follow_code(disass_context *ctx, int pc)
+ *
+ * mark everything reachable from pc without a jump as code, see above
+ * =============================================================================
+ */
+static void follow_code(disass_context *ctx, int pc)
+{
+    int history[DISPATCH_HISTORY];
+    int count   = 0;
+    int bytes;
+    int opcode;
+    int target;
+    int j;
+
+    while (pc >= ctx->basic_end && pc < ctx->pc_end)
+    {
+        if (get_datatype(ctx, pc) != DATATYPE_DATA)
+        {
+            return;
+        }
+
+        opcode = ctx->assembly.data[pc - ctx->pc_start];
+        bytes = opcodes[opcode].bytes;
+
+        if (!is_in_mode(ctx, opcode) || pc + bytes > ctx->pc_end)
+        {
+            return;
+        }
+
+        // don't overlap instructions, the output can't show that
+        for (j = 1; j < bytes; j++)
+        {
+            if (get_datatype(ctx, pc+j) != DATATYPE_DATA)
+            {
+                return;
+            }
+        }
+
+        for (j = 1; j < bytes; j++)
+        {
+            set_datatype(ctx, pc+j, DATATYPE_CODE);
+        }
+
+        target = get_target(ctx, pc);
+        if (target >= 0 && get_datatype(ctx, target) == DATATYPE_DATA)
+        {
+            append_address(&ctx->worklist, target);
+        }
+
+        if (count == DISPATCH_HISTORY)
+        {
+            memmove(history, history + 1, (DISPATCH_HISTORY - 1) * sizeof(int));
+            count--;
+        }
+        history[count++] = pc;
+
+        if (is_flow_end(opcode))
+        {
+            if (opcode == 0x60 || opcode == 0x6C)
+            {
+                follow_dispatch(ctx, history, count, NULL);
+            }
+            set_datatype(ctx, pc, DATATYPE_CODE_END);
+            return;
+        }
+
+        set_datatype(ctx, pc, DATATYPE_CODE);
+        pc += bytes;
+    }
+}
+
+/* =============================================================================
+ * void create_flowmap(disass_context *ctx)
+ *
+ * replacement for create_datamap(), fills the datamap by following the
+ * control flow from all entry points
+ * =============================================================================
+ */
+void create_flowmap(disass_context *ctx)
+{
+    int i;
+    int address;
+    int vector;
+
+    ctx->worklist.count = 0;
+
+    if (ctx->trace_cycles > 0)
+    {
+        trace_code(ctx);
+    }
+
+    // annotations go first, so they are followed last
+    if (ctx->notes != NULL)
+    {
+        for (i = ctx->notes->ranges.count - 1; i >= 0; i--)
+        {
+            if (ctx->notes->ranges.blocks[i].type == DATATYPE_CODE)
+            {
+                append_address(&ctx->worklist, ctx->notes->ranges.blocks[i].pc_start);
+            }
+        }
+        for (i = ctx->notes->entries.count - 1; i >= 0; i--)
+        {
+            append_address(&ctx->worklist, ctx->notes->entries.addresses[i]);
+        }
+    }
+
+    for (i = ctx->entries.count - 1; i >= 0; i--)
+    {
+        append_address(&ctx->worklist, ctx->entries.addresses[i]);
+    }
+
+    for (i = sizeof(entry_vectors) / sizeof(entry_vectors[0]) - 1; i >= 0; i--)
+    {
+        vector = entry_vectors[i];
+        if (vector < ctx->pc_start || vector + 2 > ctx->pc_end)
+        {
+            continue;
+        }
+
+        address = get_byte(ctx, vector - ctx->pc_start)
+            + (get_byte(ctx, vector + 1 - ctx->pc_start) << 8);
+        if (address >= ctx->basic_end && address < ctx->pc_end)
+        {
+            append_address(&ctx->worklist, address);
+        }
+    }
+
+    // the main entry goes last, so it's followed first
+    append_address(&ctx->worklist, ctx->entry);
+
+    follow_worklist(ctx);
+}
+
+/* =============================================================================
+ * void follow_jump_tables(disass_context *ctx)
+ *
+ * look for the dispatch idioms of follow_dispatch() in the code of a finished
+ * datamap, e.g. one of create_datamap(), and follow the jump tables they use
+ * =============================================================================
+ */
+void follow_jump_tables(disass_context *ctx)
+{
+    block_list  claimed;
+    int         history[DISPATCH_HISTORY];
+    int         count       = 0;
+    int         pc          = ctx->basic_end;
+    int         opcode;
+
+    ctx->worklist.count = 0;
+    memset(&claimed, 0, sizeof(claimed));
+
+    while (pc < ctx->pc_end)
+    {
+        opcode = ctx->assembly.data[pc - ctx->pc_start];
+
+        if (!is_in_mode(ctx, opcode) || get_datatype(ctx, pc) == DATATYPE_DATA)
+        {
+            count = 0;
+            pc++;
+            continue;
+        }
+
+        if (count == DISPATCH_HISTORY)
+        {
+            memmove(history, history + 1, (DISPATCH_HISTORY - 1) * sizeof(int));
+            count--;
+        }
+        history[count++] = pc;
+
+        if (opcode == 0x60 || opcode == 0x6C)
+        {
+            follow_dispatch(ctx, history, count, &claimed);
+            count = 0;
+        }
+        pc += opcodes[opcode].bytes;
+    }
+
+    follow_claimed_targets(ctx, &claimed);
+    free(claimed.blocks);
+    follow_worklist(ctx);
+}
+
+/* =============================================================================
+ * void follow_worklist(disass_context *ctx)
+ *
+ * follow_code() from every address in ctx->worklist, last one first, until
+ * the worklist is empty. whatever is code already stays as it is, so this
+ * can also be used to add entries to a finished datamap.
+ * =============================================================================
+ */
+void follow_worklist(disass_context *ctx)
+{
+    while (ctx->worklist.count > 0)
+    {
+        ctx->worklist.count--;
+        follow_code(ctx, ctx->worklist.addresses[ctx->worklist.count]);
+    }
+}
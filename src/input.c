@@ -0,0 +1,148 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "input.h"
+
+/* =============================================================================
+ * int load_prg(disass_context *ctx, const unsigned char *data, size_t size,
+ *              int skipbytes)
+ *
+ * return 0;  // on success
+ * return -1; // if data is too short to contain a program counter
+ *
+ * the low-/highbyte combination at data[skipbytes - 2] is used as program
+ * counter, everything from data[skipbytes] on is loaded into ctx without
+ * copying it (see load_buffer())
+ * =============================================================================
+ */
+int load_prg(disass_context *ctx, const unsigned char *data, size_t size, int skipbytes)
+{
+    size_t  rest;
+    int     length;
+    int     pc;
+
+    if (skipbytes < 2 || size < (size_t)skipbytes)
+    {
+        reset_context(ctx);
+        return -1;
+    }
+
+    pc = data[skipbytes - 2] + (data[skipbytes - 1] << 8);
+
+    rest = size - skipbytes;
+    length = (rest > MEMORY_SIZE) ? MEMORY_SIZE : (int)rest;
+
+    if (load_buffer(ctx, data + skipbytes, length, pc) != 0)
+    {
+        return -1;
+    }
+    ctx->assembly.truncated += rest - length;
+
+    return 0;
+}
+
+/* =============================================================================
+ * int map_file(mapped_file *file, const char *filename)
+ *
+ * return 0;  // on success
+ * return -1; // if the file couldn't be read
+ *
+ * maps the whole file into memory. if that's not possible (empty files,
+ * pipes, ...) it is read into a buffer with as few read() calls as possible.
+ * =============================================================================
+ */
+int map_file(mapped_file *file, const char *filename)
+{
+    struct stat     st;
+    unsigned char   *new_buffer;
+    size_t          buffer_size;
+    ssize_t         bytes_read;
+    int             fd;
+
+    memset(file, 0, sizeof(mapped_file));
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    if (S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        file->mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (file->mapping != MAP_FAILED)
+        {
+            file->mapping_size = st.st_size;
+            file->data = file->mapping;
+            file->size = st.st_size;
+            close(fd);
+            return 0;
+        }
+        file->mapping = NULL;
+    }
+
+    // fallback: read everything in as few chunks as possible
+    buffer_size = (S_ISREG(st.st_mode) && st.st_size > 0) ? st.st_size : 0x10000;
+
+    for (;;)
+    {
+        if (file->size == buffer_size || file->buffer == NULL)
+        {
+            if (file->buffer != NULL)
+            {
+                buffer_size *= 2;
+            }
+            new_buffer = realloc(file->buffer, buffer_size);
+            if (new_buffer == NULL)
+            {
+                free(file->buffer);
+                close(fd);
+                return -1;
+            }
+            file->buffer = new_buffer;
+        }
+
+        bytes_read = read(fd, file->buffer + file->size, buffer_size - file->size);
+        if (bytes_read < 0)
+        {
+            free(file->buffer);
+            file->buffer = NULL;
+            close(fd);
+            return -1;
+        }
+        if (bytes_read == 0)
+        {
+            break;
+        }
+        file->size += bytes_read;
+    }
+
+    close(fd);
+    file->data = file->buffer;
+
+    return 0;
+}
+
+/* =============================================================================
+ * void unmap_file(mapped_file *file)
+ * =============================================================================
+ */
+void unmap_file(mapped_file *file)
+{
+    if (file->mapping != NULL)
+    {
+        munmap(file->mapping, file->mapping_size);
+    }
+    free(file->buffer);
+
+    memset(file, 0, sizeof(mapped_file));
+}
@@ -0,0 +1,22 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stddef.h>
+#include "disass.h"
+
+/* a complete file in memory, read with a single mmap() or read()
+ */
+typedef struct
+{
+    const unsigned char *data;
+    size_t          size;
+    void            *mapping;       // mmap()ed area or NULL
+    size_t          mapping_size;
+    unsigned char   *buffer;        // malloc()ed copy if mmap() wasn't possible
+} mapped_file;
+
+int load_prg(disass_context *ctx, const unsigned char *data, size_t size, int skipbytes);
+int map_file(mapped_file *file, const char *filename);
+void unmap_file(mapped_file *file);
+
+#endif // INPUT_H_
@@ -0,0 +1,691 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "export.h"
+#include "listing.h"
+#include "output.h"
+#include "stats.h"
+#include "timing.h"
+
+/* =============================================================================
+ * listings
+ *
+ * the analysis decides what is code and data, list_disassembly() turns that
+ * into a listing: one line per label, instruction, row of data bytes or piece
+ * of the BASIC stub, with the operands already decoded. render_listing()
+ * prints a listing in the syntax of one assembler, so any number of them can
+ * be printed from one analysis. the bytes themselves are taken from ctx when
+ * rendering, the listing has to be rendered before the next file is loaded.
+ *
+ * the assemblers don't agree on the illegal opcodes. one they have no name
+ * for is printed as bytes with its name in a comment, as is every opcode an
+ * assembler would encode differently, e.g. anc 0x2B or sbc 0xEB.
+ * =============================================================================
+ */
+
+#define CYCLES_COLUMN   16  // of the cycle comments, after the indent
+
+static pthread_once_t   tables_once     = PTHREAD_ONCE_INIT;
+static const char       *mnemonic_tables[SYNTAXES][0x100];  // see find_mnemonics()
+static char             zero_page[0x100];                   // see has_zero_page()
+
+static const mnemonic_alias kickass_illegal[] = {
+    { "anc", "anc" }, { "arr", "arr" }, { "asr", "alr" }, { "dcp", "dcp" },
+    { "isb", "isc" }, { "lae", "las" }, { "lax", "lax" }, { "rla", "rla" },
+    { "rra", "rra" }, { "sax", "sax" }, { "sbx", "axs" }, { "sha", "ahx" },
+    { "shs", "tas" }, { "shx", "shx" }, { "shy", "shy" }, { "slo", "slo" },
+    { "sre", "sre" }, { NULL, NULL }
+};
+
+static const mnemonic_alias ca65_illegal[] = {
+    { "anc", "anc" }, { "arr", "arr" }, { "asr", "alr" }, { "dcp", "dcp" },
+    { "isb", "isc" }, { "jam", "jam" }, { "lae", "las" }, { "lax", "lax" },
+    { "rla", "rla" }, { "rra", "rra" }, { "sax", "sax" }, { "sbx", "axs" },
+    { "shs", "tas" }, { "slo", "slo" }, { "sre", "sre" }, { NULL, NULL }
+};
+
+static const mnemonic_alias tass_illegal[] = {
+    { "anc", "anc" }, { "ane", "ane" }, { "arr", "arr" }, { "asr", "asr" },
+    { "dcp", "dcp" }, { "isb", "isb" }, { "jam", "jam" }, { "lae", "lds" },
+    { "lax", "lax" }, { "lxa", "lxa" }, { "rla", "rla" }, { "rra", "rra" },
+    { "sax", "sax" }, { "sbx", "sbx" }, { "sha", "sha" }, { "shs", "shs" },
+    { "shx", "shx" }, { "shy", "shy" }, { "slo", "slo" }, { "sre", "sre" },
+    { NULL, NULL }
+};
+
+const assembler_syntax syntaxes[SYNTAXES] = {
+    [SYNTAX_ACME] = {
+        "acme", NULL, NULL,
+        ";", "0x", { "!cpu 6502", "!cpu 6510" }, "*= 0x%04x \n",
+        "!byte", "!word", "!pet", 1, { "", "", "" }, "", NULL
+    },
+    [SYNTAX_KICKASS] = {
+        "kickass", NULL, NULL,
+        "//", "$", { ".cpu _6502NoIllegals", ".cpu _6502" }, "*= $%04x\n",
+        ".byte", ".word", NULL, 0, { ".abs", ".absx", ".absy" }, "", kickass_illegal
+    },
+    [SYNTAX_CA65] = {
+        "ca65", NULL, NULL,
+        ";", "$", { ".setcpu \"6502\"", ".setcpu \"6502X\"" }, ".org $%04x\n",
+        ".byte", ".word", ".byte", 0, { "", "", "" }, "a:", ca65_illegal
+    },
+    [SYNTAX_64TASS] = {
+        "64tass", NULL, NULL,
+        ";", "$", { ".cpu \"6502\"", ".cpu \"6502i\"" }, "* = $%04x\n",
+        ".byte", ".word", ".text", 0, { "", "", "" }, "@w ", tass_illegal
+    },
+    [SYNTAX_JSONL] = {
+        "jsonl", ".jsonl", export_jsonl
+    },
+    [SYNTAX_BINARY] = {
+        "bin", ".bin", export_binary
+    }
+};
+
+/* =============================================================================
+ * int is_canonical(int op)
+ *
+ * return 1; // if no lower opcode that is ever disassembled has the same
+ *           // mnemonic and addressing mode, i.e. an assembler picks op
+ * =============================================================================
+ */
+static int is_canonical(int op)
+{
+    int i;
+
+    for (i = 0; i < op; i++)
+    {
+        if (opcodes[i].cpus != 0 && memcmp(opcodes[i].name, opcodes[op].name, 3) == 0
+            && opcodes[i].addressing_mode == opcodes[op].addressing_mode)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* =============================================================================
+ * int has_zero_page(int op)
+ *
+ * return 1; // if the ABS / ABSX / ABSY op has a zero page variant, which an
+ *           // assembler would pick for an operand <= 0xFF
+ * =============================================================================
+ */
+static int has_zero_page(int op)
+{
+    int mode    = opcodes[op].addressing_mode;
+    int i;
+
+    mode = (mode == ABS) ? ZP : (mode == ABSX) ? ZPX : ZPY;
+
+    for (i = 0; i < 0x100; i++)
+    {
+        if (opcodes[i].addressing_mode == mode && memcmp(opcodes[i].name, opcodes[op].name, 3) == 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* =============================================================================
+ * void find_mnemonics(const assembler_syntax *syntax, const char **mnemonics)
+ *
+ * fill mnemonics[0x100] with the 3 chars syntax uses for each opcode, NULL
+ * for the ones it can't encode
+ * =============================================================================
+ */
+static void find_mnemonics(const assembler_syntax *syntax, const char **mnemonics)
+{
+    const mnemonic_alias    *alias;
+    int                     op;
+
+    for (op = 0; op < 0x100; op++)
+    {
+        mnemonics[op] = opcodes[op].name;
+
+        if (syntax->illegal == NULL)
+        {
+            continue;
+        }
+
+        if (!is_canonical(op))
+        {
+            mnemonics[op] = NULL;
+            continue;
+        }
+
+        if (opcodes[op].cpus & CPU_6502)
+        {
+            continue;
+        }
+
+        mnemonics[op] = NULL;
+        for (alias = syntax->illegal; alias->name != NULL; alias++)
+        {
+            if (memcmp(alias->name, opcodes[op].name, 3) == 0)
+            {
+                mnemonics[op] = alias->alias;
+                break;
+            }
+        }
+    }
+}
+
+/* =============================================================================
+ * void find_tables()
+ *
+ * fill mnemonic_tables and zero_page, they only depend on opcodes[] and the
+ * syntax. run once through pthread_once(), the batch renders in parallel.
+ * =============================================================================
+ */
+static void find_tables()
+{
+    int mode;
+    int i;
+
+    for (i = 0; i < SYNTAXES; i++)
+    {
+        if (syntaxes[i].export == NULL)
+        {
+            find_mnemonics(&syntaxes[i], mnemonic_tables[i]);
+        }
+    }
+
+    for (i = 0; i < 0x100; i++)
+    {
+        mode = opcodes[i].addressing_mode;
+        zero_page[i] = (mode == ABS || mode == ABSX || mode == ABSY) && has_zero_page(i);
+    }
+}
+
+/* =============================================================================
+ * void render_bytes(disass_context *ctx, const assembler_syntax *syntax,
+ *      int pc, int count, int flags)
+ *
+ * count bytes from pc, with LINE_OPEN / LINE_END as in a LINE_BYTES line
+ * =============================================================================
+ */
+static void render_bytes(disass_context *ctx, const assembler_syntax *syntax,
+    int pc, int count, int flags)
+{
+    int i;
+
+    if (flags & LINE_OPEN)
+    {
+        print_indent(ctx);
+        output_string(ctx, syntax->byte);
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        output_char(ctx, ' ');
+        output_string(ctx, syntax->hex);
+        output_hex8(ctx, get_byte(ctx, pc + i - ctx->pc_start));
+
+        if (i < count - 1 || !(flags & LINE_END))
+        {
+            output_char(ctx, ',');
+        }
+    }
+
+    if (flags & LINE_END)
+    {
+        output_char(ctx, '\n');
+    }
+}
+
+/* =============================================================================
+ * void end_instruction(disass_context *ctx, const assembler_syntax *syntax,
+ *      const listing_line *line, int start)
+ *
+ * end the line of the instruction that starts at ctx->out.data[start], with
+ * its cycles in a comment if ctx->timing is set
+ * =============================================================================
+ */
+static void end_instruction(disass_context *ctx, const assembler_syntax *syntax,
+    const listing_line *line, int start)
+{
+    int column  = ctx->out.length - start;
+    int min;
+    int max;
+
+    if (ctx->timing)
+    {
+        instruction_cycles(ctx, line, &min, &max);
+        output_spaces(ctx, (column < ctx->indent + CYCLES_COLUMN)
+            ? ctx->indent + CYCLES_COLUMN - column : 1);
+        output_string(ctx, syntax->comment);
+        output_printf(ctx, " %d", min);
+        if (max != min)
+        {
+            output_printf(ctx, "-%d", max);
+        }
+    }
+
+    output_char(ctx, '\n');
+}
+
+/* =============================================================================
+ * void render_instruction(disass_context *ctx, const assembler_syntax *syntax,
+ *      const char **mnemonics, const listing_line *line)
+ * =============================================================================
+ */
+static void render_instruction(disass_context *ctx, const assembler_syntax *syntax,
+    const char **mnemonics, const listing_line *line)
+{
+    int op      = ctx->assembly.data[line->pc - ctx->pc_start];
+    int mode    = opcodes[op].addressing_mode;
+    int value   = line->value;
+    int start   = ctx->out.length;
+
+    if (mnemonics[op] == NULL)
+    {
+        print_indent(ctx);
+        output_string(ctx, syntax->comment);
+        output_char(ctx, ' ');
+        output_chars(ctx, opcodes[op].name, 3);
+        output_char(ctx, '\n');
+        render_bytes(ctx, syntax, line->pc, line->count, LINE_OPEN | LINE_END);
+        return;
+    }
+
+    print_indent(ctx);
+    output_chars(ctx, mnemonics[op], 3);
+
+    if (line->flags & LINE_TARGET)
+    {
+        output_char(ctx, ' ');
+        output_label(ctx, value);
+        end_instruction(ctx, syntax, line, start);
+        return;
+    }
+
+    if ((mode == ABS || mode == ABSX || mode == ABSY) && value <= 0xFF && zero_page[op])
+    {
+        output_string(ctx, syntax->absolute[(mode == ABS) ? 0 : (mode == ABSX) ? 1 : 2]);
+        output_char(ctx, ' ');
+        output_string(ctx, syntax->force);
+    }
+    else if (mode != ACC && mode != IMP)
+    {
+        output_char(ctx, ' ');
+    }
+
+    switch (mode)
+    {
+    case ACC:
+    case IMP:
+    default:
+        break;
+    case IMM:
+        output_char(ctx, '#');
+        output_string(ctx, syntax->hex);
+        output_hex8(ctx, value);
+        break;
+    case ZP:
+    case ZPX:
+    case ZPY:
+        output_string(ctx, syntax->hex);
+        output_hex8(ctx, value);
+        output_string(ctx, (mode == ZPX) ? ",x" : (mode == ZPY) ? ",y" : "");
+        break;
+    case ABS:
+    case ABSX:
+    case ABSY:
+    case REL:
+        output_string(ctx, syntax->hex);
+        output_hex16(ctx, value);
+        output_string(ctx, (mode == ABSX) ? ",x" : (mode == ABSY) ? ",y" : "");
+        break;
+    case ABSI:
+        output_char(ctx, '(');
+        output_string(ctx, syntax->hex);
+        output_hex16(ctx, value);
+        output_char(ctx, ')');
+        break;
+    case INDX:
+        output_char(ctx, '(');
+        output_string(ctx, syntax->hex);
+        output_hex8(ctx, value);
+        output_string(ctx, ",x)");
+        break;
+    case INDY:
+        output_char(ctx, '(');
+        output_string(ctx, syntax->hex);
+        output_hex8(ctx, value);
+        output_string(ctx, "),y");
+        break;
+    }
+
+    end_instruction(ctx, syntax, line, start);
+}
+
+/* =============================================================================
+ * void render_span(disass_context *ctx, const assembler_syntax *syntax,
+ *      const cycle_span *span)
+ *
+ * the cycles of a block or loop as a comment line
+ * =============================================================================
+ */
+static void render_span(disass_context *ctx, const assembler_syntax *syntax,
+    const cycle_span *span)
+{
+    output_string(ctx, syntax->comment);
+    output_string(ctx, (span->type == TIMING_LOOP) ? " loop " : " block ");
+    output_string(ctx, syntax->hex);
+    output_hex16(ctx, span->pc_start);
+    output_char(ctx, '-');
+    output_string(ctx, syntax->hex);
+    output_hex16(ctx, span->pc_end - 1);
+    output_printf(ctx, ": %d", span->min);
+    if (span->max != span->min)
+    {
+        output_printf(ctx, "-%d", span->max);
+    }
+    output_string(ctx, (span->type == TIMING_LOOP) ? " cycles per iteration\n" : " cycles\n");
+}
+
+/* =============================================================================
+ * void append_line(listing *list, int type, int flags, int pc, int count, int value)
+ *
+ * add a line to the end of list, list grows as needed
+ * =============================================================================
+ */
+void append_line(listing *list, int type, int flags, int pc, int count, int value)
+{
+    listing_line    *new_lines;
+    listing_line    *line;
+    int             new_size;
+
+    if (list->count == list->size)
+    {
+        new_size = list->size ? list->size * 2 : 0x400;
+        new_lines = realloc(list->lines, new_size * sizeof(listing_line));
+        if (new_lines == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        list->lines = new_lines;
+        list->size = new_size;
+    }
+
+    line = &list->lines[list->count];
+    line->type = type;
+    line->flags = flags;
+    line->count = count;
+    line->pc = pc;
+    line->value = value;
+    list->count++;
+}
+
+/* =============================================================================
+ * int find_syntax(const char *name)
+ *
+ * return syntax;   // SYNTAX_ACME etc.
+ * return -1;       // if there is no assembler called name
+ * =============================================================================
+ */
+int find_syntax(const char *name)
+{
+    int i;
+
+    for (i = 0; i < SYNTAXES; i++)
+    {
+        if (strcmp(syntaxes[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* =============================================================================
+ * void free_listing(listing *list)
+ * =============================================================================
+ */
+void free_listing(listing *list)
+{
+    free(list->lines);
+    list->lines = NULL;
+    list->count = 0;
+    list->size = 0;
+}
+
+/* =============================================================================
+ * void list_disassembly(disass_context *ctx, listing *list)
+ *
+ * add the complete disassembly according to datamap and labelmap to list
+ * =============================================================================
+ */
+void list_disassembly(disass_context *ctx, listing *list)
+{
+    int row = -1;
+
+    list_header(ctx, list);
+    list_range(ctx, list, (ctx->basic_end > ctx->pc_start) ? ctx->basic_end : ctx->pc_start,
+        ctx->pc_end, &row);
+}
+
+/* =============================================================================
+ * void list_header(disass_context *ctx, listing *list)
+ *
+ * add the cpu, the origin and the BASIC stub, if any, to list
+ * =============================================================================
+ */
+void list_header(disass_context *ctx, listing *list)
+{
+    append_line(list, LINE_CPU, 0, ctx->pc_start, 0, ctx->mode);
+    append_line(list, LINE_ORIGIN, 0, ctx->pc_start, 0, ctx->pc_start);
+
+    if (ctx->basic_end > ctx->pc_start)
+    {
+        list_basic(ctx, list);
+    }
+}
+
+/* =============================================================================
+ * int list_range(disass_context *ctx, listing *list, int pc, int pc_end, int *row)
+ * return pc; // after the last instruction / byte added
+ *
+ * add everything from pc up to pc_end according to datamap and labelmap to
+ * list. an instruction that starts before pc_end is added completely, so the
+ * returned pc may be beyond pc_end. row is the number of bytes in the open
+ * row of data bytes or -1 if there is none, it's carried over from one call
+ * to the next.
+ * =============================================================================
+ */
+int list_range(disass_context *ctx, listing *list, int pc, int pc_end, int *row)
+{
+    const opcode    *op;
+    int             bytes_line      = -1;   // the LINE_BYTES being filled
+    int             bytes_per_row   = 8;
+    int             operand;
+    int             flags;
+    int             i;
+
+    while (pc < pc_end)
+    {
+        i = pc - ctx->pc_start;
+        op = &opcodes[ctx->assembly.data[i]];
+
+        if (is_label(ctx, pc))
+        {
+            append_line(list, LINE_LABEL, 0, pc, 0, 0);
+        }
+
+        if (is_in_mode(ctx, ctx->assembly.data[i]) && get_datatype(ctx, pc) != DATATYPE_DATA)
+        {
+            operand = 0x0000;
+            flags = 0;
+
+            switch (op->addressing_mode)
+            {
+            case ACC:
+            case IMP:
+            default:
+                break;
+            case IMM:
+            case ZP:
+            case ZPX:
+            case ZPY:
+            case INDX:
+            case INDY:
+                operand = get_byte(ctx, i+1);
+                break;
+            case ABS:
+            case ABSI:
+            case ABSX:
+            case ABSY:
+                operand = get_byte(ctx, i+1) + (get_byte(ctx, i+2) << 8);
+                break;
+            case REL:
+                operand = (pc + 2 + (signed char)get_byte(ctx, i+1)) & 0xFFFF;
+                break;
+            }
+
+            if (ctx->assembly.data[i] == 0x4C && is_label(ctx, operand))
+            {
+                flags = LINE_TARGET;
+            }
+
+            append_line(list, LINE_INSTRUCTION, flags, pc, op->bytes, operand);
+            if (ctx->stats != NULL)
+            {
+                ctx->stats->instructions++;
+            }
+
+            *row = -1;
+            bytes_line = -1;
+            pc += op->bytes;
+        }
+        else
+        {
+            // a label always starts a new row
+            if (*row < 0)
+            {
+                append_line(list, LINE_BYTES, LINE_OPEN, pc, 0, 0);
+                bytes_line = list->count - 1;
+                *row = 0;
+            }
+            else if (bytes_line < 0)
+            {
+                append_line(list, LINE_BYTES, 0, pc, 0, 0);
+                bytes_line = list->count - 1;
+            }
+
+            list->lines[bytes_line].count++;
+            (*row)++;
+
+            if (get_datatype(ctx, pc+1) != DATATYPE_DATA || *row == bytes_per_row
+                || is_label(ctx, pc+1) || pc + 1 == ctx->pc_end)
+            {
+                list->lines[bytes_line].flags |= LINE_END;
+                *row = -1;
+                bytes_line = -1;
+            }
+            pc++;
+        }
+    }
+
+    return pc;
+}
+
+/* =============================================================================
+ * void render_listing(disass_context *ctx, const listing *list, int syntax)
+ *
+ * print list in the syntax of an assembler, SYNTAX_ACME etc., or export it.
+ * with ctx->timing, each of ctx->timings comes as a comment line in front of
+ * the label or instruction it starts with.
+ * =============================================================================
+ */
+void render_listing(disass_context *ctx, const listing *list, int syntax)
+{
+    const assembler_syntax  *asm_syntax     = &syntaxes[syntax];
+    const listing_line      *line;
+    const char              **mnemonics     = mnemonic_tables[syntax];
+    int                     span            = 0;
+    int                     c;
+    int                     i;
+    int                     j;
+
+    if (asm_syntax->export != NULL)
+    {
+        asm_syntax->export(ctx, list);
+        return;
+    }
+
+    pthread_once(&tables_once, find_tables);
+
+    for (i = 0; i < list->count; i++)
+    {
+        line = &list->lines[i];
+
+        while (ctx->timing && span < ctx->timings.count && ctx->timings.spans[span].pc_start <= line->pc
+            && (line->type == LINE_LABEL || line->type == LINE_INSTRUCTION))
+        {
+            render_span(ctx, asm_syntax, &ctx->timings.spans[span++]);
+        }
+
+        switch (line->type)
+        {
+        case LINE_CPU:
+            print_indent(ctx);
+            output_string(ctx, asm_syntax->cpu[line->value == MODE6510]);
+            output_string(ctx, "\n\n");
+            break;
+        case LINE_ORIGIN:
+            print_indent(ctx);
+            output_printf(ctx, asm_syntax->origin, line->value);
+            break;
+        case LINE_LABEL:
+            output_label(ctx, line->pc);
+            output_string(ctx, ":\n");
+            break;
+        case LINE_INSTRUCTION:
+            render_instruction(ctx, asm_syntax, mnemonics, line);
+            break;
+        case LINE_BYTES:
+            render_bytes(ctx, asm_syntax, line->pc, line->count, line->flags);
+            break;
+        case LINE_WORD:
+            print_indent(ctx);
+            output_string(ctx, asm_syntax->word);
+            if (line->flags & LINE_DECIMAL)
+            {
+                output_printf(ctx, " %d\n", line->value);
+            }
+            else
+            {
+                output_char(ctx, ' ');
+                output_string(ctx, asm_syntax->hex);
+                output_hex16(ctx, line->value);
+                output_char(ctx, '\n');
+            }
+            break;
+        case LINE_TEXT:
+            if (asm_syntax->text == NULL)
+            {
+                render_bytes(ctx, asm_syntax, line->pc, line->count, LINE_OPEN | LINE_END);
+                break;
+            }
+
+            print_indent(ctx);
+            output_string(ctx, asm_syntax->text);
+            output_string(ctx, " \"");
+            for (j = 0; j < line->count; j++)
+            {
+                c = get_byte(ctx, line->pc + j - ctx->pc_start);
+                // !pet maps lowercase ascii to 0x41-0x5A
+                output_char(ctx, (asm_syntax->lower && c >= 'A' && c <= 'Z') ? c + 0x20 : c);
+            }
+            output_string(ctx, "\"\n");
+            break;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#ifndef LISTING_H_
+#define LISTING_H_
+
+#include "disass.h"
+
+enum {
+    LINE_CPU,           // value: ctx->mode
+    LINE_ORIGIN,        // pc
+    LINE_LABEL,         // pc
+    LINE_INSTRUCTION,   // count bytes at pc, value: operand, branches as target
+    LINE_BYTES,         // count data bytes at pc
+    LINE_WORD,          // value, a BASIC link or line number
+    LINE_TEXT           // count bytes of BASIC text at pc
+}; // listing_line.type
+
+#define LINE_OPEN       0x01    // LINE_BYTES: starts a row
+#define LINE_END        0x02    // LINE_BYTES: ends a row
+#define LINE_DECIMAL    0x04    // LINE_WORD: printed as a decimal number
+#define LINE_TARGET     0x08    // LINE_INSTRUCTION: operand printed as a label
+
+enum {
+    SYNTAX_ACME,
+    SYNTAX_KICKASS,
+    SYNTAX_CA65,
+    SYNTAX_64TASS,
+    SYNTAX_JSONL,       // no assembler, see export.h
+    SYNTAX_BINARY,
+    SYNTAXES
+}; // ctx->syntax
+
+/* illegal opcode named differently by an assembler
+ */
+typedef struct
+{
+    const char  *name;      // as in opcodes[]
+    const char  *alias;     // the assembler's, 3 chars as well
+} mnemonic_alias;
+
+/* everything render_listing() needs to know about an assembler, an export
+ * only has name, extension and export
+ */
+typedef struct
+{
+    const char  *name;          // for -F
+    const char  *extension;     // of the output file, NULL: .asm
+    void        (*export)(disass_context *ctx, const listing *list);  // NULL: assembler
+    const char  *comment;       // starts a comment
+    const char  *hex;           // in front of hex numbers
+    const char  *cpu[2];        // MODE6502, MODE6510
+    const char  *origin;        // printf() format of the *= line
+    const char  *byte;
+    const char  *word;
+    const char  *text;          // BASIC text in quotes, NULL: as bytes
+    int         lower;          // text has a-z for 0x41-0x5A, like !pet
+    const char  *absolute[3];   // suffix of ABS / ABSX / ABSY mnemonics with zero page operands
+    const char  *force;         // in front of such operands instead
+    const mnemonic_alias *illegal;  // NULL: every opcode as in opcodes[], else
+                                    // the illegal ones it knows, the rest as bytes
+} assembler_syntax;
+
+extern const assembler_syntax syntaxes[SYNTAXES];
+
+void append_line(listing *list, int type, int flags, int pc, int count, int value);
+int find_syntax(const char *name);
+void free_listing(listing *list);
+void list_basic(disass_context *ctx, listing *list);
+void list_disassembly(disass_context *ctx, listing *list);
+void list_header(disass_context *ctx, listing *list);
+int list_range(disass_context *ctx, listing *list, int pc, int pc_end, int *row);
+void render_listing(disass_context *ctx, const listing *list, int syntax);
+
+#endif // LISTING_H_
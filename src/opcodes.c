@@ -0,0 +1,357 @@
+#include "disass.h"
+
+/* the last column tells in which cpu modes an opcode will be disassembled,
+ * so is_in_mode() is a single table lookup.
+ *
+ * the flags reproduce the opcode lists of the original is_in_mode(), quirks
+ * included:
+ *
+ *      brk (0x00) is never disassembled. it was the first entry of both
+ *      lists and the lookup loops started at index 1, so it was skipped by
+ *      accident rather than by design. it's kept that way, enabling it
+ *      changes the output for every file with zero bytes.
+ *
+ *      sbc 0xEB, an illegal opcode, is in the 6502 list as well.
+ *
+ * bvc (0x50) was missing from both lists, it's disassembled in both modes
+ * now like every other branch.
+ *
+ * TODO:
+ * update CPU_6510 flags
+ * were taken from aay64, but acme won't be able to compile all of them when
+ * set to !cpu 6510
+ */
+opcode opcodes[] = {
+    [0x69]{ "adc", 2, 2, IMM, CPU_ALL },
+    [0x65]{ "adc", 2, 3, ZP, CPU_ALL },
+    [0x75]{ "adc", 2, 4, ZPX, CPU_ALL },
+    [0x6D]{ "adc", 3, 4, ABS, CPU_ALL },
+    [0x7D]{ "adc", 3, 4, ABSX, CPU_ALL },
+    [0x79]{ "adc", 3, 4, ABSY, CPU_ALL },
+    [0x61]{ "adc", 2, 6, INDX, CPU_ALL },
+    [0x71]{ "adc", 2, 5, INDY, CPU_ALL },
+
+    [0x0B]{ "anc", 2, 2, IMM, CPU_6510 },
+    [0x2B]{ "anc", 2, 2, IMM, CPU_6510 },
+
+    [0x29]{ "and", 2, 2, IMM, CPU_ALL },
+    [0x25]{ "and", 2, 3, ZP, CPU_ALL },
+    [0x35]{ "and", 2, 4, ZPX, CPU_ALL },
+    [0x2D]{ "and", 3, 4, ABS, CPU_ALL },
+    [0x3D]{ "and", 3, 4, ABSX, CPU_ALL },
+    [0x39]{ "and", 3, 4, ABSY, CPU_ALL },
+    [0x21]{ "and", 2, 6, INDX, CPU_ALL },
+    [0x31]{ "and", 2, 5, INDY, CPU_ALL },
+
+    [0x8B]{ "ane", 2, 2, IMM, CPU_6510 },
+
+    [0x6B]{ "arr", 2, 2, IMM, CPU_6510 },
+
+    [0x4B]{ "asr", 2, 2, IMM, CPU_6510 },
+
+    [0x0A]{ "asl", 1, 2, ACC, CPU_ALL },
+    [0x06]{ "asl", 2, 5, ZP, CPU_ALL },
+    [0x16]{ "asl", 2, 6, ZPX, CPU_ALL },
+    [0x0E]{ "asl", 3, 6, ABS, CPU_ALL },
+    [0x1E]{ "asl", 3, 7, ABSX, CPU_ALL },
+
+    [0x90]{ "bcc", 2, 2, REL, CPU_ALL },
+
+    [0xB0]{ "bcs", 2, 2, REL, CPU_ALL },
+
+    [0xF0]{ "beq", 2, 2, REL, CPU_ALL },
+
+    [0x24]{ "bit", 2, 3, ZP, CPU_ALL },
+    [0x2C]{ "bit", 3, 4, ABS, CPU_ALL },
+
+    [0x30]{ "bmi", 2, 2, REL, CPU_ALL },
+
+    [0xD0]{ "bne", 2, 2, REL, CPU_ALL },
+
+    [0x10]{ "bpl", 2, 2, REL, CPU_ALL },
+
+    [0x00]{ "brk", 1, 7, IMP, 0 },
+
+    [0x50]{ "bvc", 2, 2, REL, CPU_ALL },
+
+    [0x70]{ "bvs", 2, 2, REL, CPU_ALL },
+
+    [0x18]{ "clc", 1, 2, IMP, CPU_ALL },
+
+    [0xD8]{ "cld", 1, 2, IMP, CPU_ALL },
+
+    [0x58]{ "cli", 1, 2, IMP, CPU_ALL },
+
+    [0xB8]{ "clv", 1, 2, IMP, CPU_ALL },
+
+    [0xC9]{ "cmp", 2, 2, IMM, CPU_ALL },
+    [0xC5]{ "cmp", 2, 3, ZP, CPU_ALL },
+    [0xD5]{ "cmp", 2, 4, ZPX, CPU_ALL },
+    [0xCD]{ "cmp", 3, 4, ABS, CPU_ALL },
+    [0xDD]{ "cmp", 3, 4, ABSX, CPU_ALL },
+    [0xD9]{ "cmp", 3, 4, ABSY, CPU_ALL },
+    [0xC1]{ "cmp", 2, 6, INDX, CPU_ALL },
+    [0xD1]{ "cmp", 2, 5, INDY, CPU_ALL },
+
+    [0xE0]{ "cpx", 2, 2, IMM, CPU_ALL },
+    [0xE4]{ "cpx", 2, 3, ZP, CPU_ALL },
+    [0xEC]{ "cpx", 3, 4, ABS, CPU_ALL },
+
+    [0xC0]{ "cpy", 2, 2, IMM, CPU_ALL },
+    [0xC4]{ "cpy", 2, 3, ZP, CPU_ALL },
+    [0xCC]{ "cpy", 3, 4, ABS, CPU_ALL },
+
+    [0xC7]{ "dcp", 2, 5, ZP, CPU_6510 },
+    [0xD7]{ "dcp", 2, 6, ZPX, CPU_6510 },
+    [0xCF]{ "dcp", 3, 6, ABS, CPU_6510 },
+    [0xDF]{ "dcp", 3, 7, ABSX, CPU_6510 },
+    [0xDB]{ "dcp", 3, 7, ABSY, CPU_6510 },
+    [0xC3]{ "dcp", 2, 8, INDX, CPU_6510 },
+    [0xD3]{ "dcp", 2, 8, INDY, CPU_6510 },
+
+    [0xC6]{ "dec", 2, 5, ZP, CPU_ALL },
+    [0xD6]{ "dec", 2, 6, ZPX, CPU_ALL },
+    [0xCE]{ "dec", 3, 6, ABS, CPU_ALL },
+    [0xDE]{ "dec", 3, 7, ABSX, CPU_ALL },
+
+    [0xCA]{ "dex", 1, 2, IMP, CPU_ALL },
+
+    [0x88]{ "dey", 1, 2, IMP, CPU_ALL },
+
+    [0x49]{ "eor", 2, 2, IMM, CPU_ALL },
+    [0x45]{ "eor", 2, 3, ZP, CPU_ALL },
+    [0x55]{ "eor", 2, 4, ZPX, CPU_ALL },
+    [0x4D]{ "eor", 3, 4, ABS, CPU_ALL },
+    [0x5D]{ "eor", 3, 4, ABSX, CPU_ALL },
+    [0x59]{ "eor", 3, 4, ABSY, CPU_ALL },
+    [0x41]{ "eor", 2, 6, INDX, CPU_ALL },
+    [0x51]{ "eor", 2, 5, INDY, CPU_ALL },
+
+    [0xE6]{ "inc", 2, 5, ZP, CPU_ALL },
+    [0xF6]{ "inc", 2, 6, ZPX, CPU_ALL },
+    [0xEE]{ "inc", 3, 6, ABS, CPU_ALL },
+    [0xFE]{ "inc", 3, 7, ABSX, CPU_ALL },
+
+    [0xE8]{ "inx", 1, 2, IMP, CPU_ALL },
+
+    [0xC8]{ "iny", 1, 2, IMP, CPU_ALL },
+
+    [0xE7]{ "isb", 2, 5, ZP, 0 },
+    [0xF7]{ "isb", 2, 6, ZPX, 0 },
+    [0xEF]{ "isb", 3, 6, ABS, 0 },
+    [0xFF]{ "isb", 3, 7, ABSX, 0 },
+    [0xFB]{ "isb", 3, 7, ABSY, 0 },
+    [0xE3]{ "isb", 2, 8, INDX, 0 },
+    [0xF3]{ "isb", 2, 8, INDY, 0 },
+
+    [0x02]{ "jam", 1, 0, IMP, CPU_6510 },
+    [0x12]{ "jam", 1, 0, IMP, 0 },
+    [0x22]{ "jam", 1, 0, IMP, 0 },
+    [0x32]{ "jam", 1, 0, IMP, 0 },
+    [0x42]{ "jam", 1, 0, IMP, 0 },
+    [0x52]{ "jam", 1, 0, IMP, 0 },
+    [0x62]{ "jam", 1, 0, IMP, 0 },
+    [0x72]{ "jam", 1, 0, IMP, 0 },
+    [0x92]{ "jam", 1, 0, IMP, 0 },
+    [0xB2]{ "jam", 1, 0, IMP, 0 },
+    [0xD2]{ "jam", 1, 0, IMP, 0 },
+    [0xF2]{ "jam", 1, 0, IMP, 0 },
+
+    [0x4C]{ "jmp", 3, 3, ABS, CPU_ALL },
+    [0x6C]{ "jmp", 3, 5, ABSI, CPU_ALL },
+
+    [0x20]{ "jsr", 3, 6, ABS, CPU_ALL },
+
+    [0xBB]{ "lae", 3, 4, ABSY, 0 },
+
+    [0xA7]{ "lax", 2, 3, ZP, CPU_6510 },
+    [0xB7]{ "lax", 2, 4, ZPY, CPU_6510 },
+    [0xAF]{ "lax", 3, 4, ABS, CPU_6510 },
+    [0xBF]{ "lax", 3, 4, ABSY, CPU_6510 },
+    [0xA3]{ "lax", 2, 6, INDX, CPU_6510 },
+    [0xB3]{ "lax", 2, 5, INDY, CPU_6510 },
+
+    [0xA9]{ "lda", 2, 2, IMM, CPU_ALL },
+    [0xA5]{ "lda", 2, 3, ZP, CPU_ALL },
+    [0xB5]{ "lda", 2, 4, ZPX, CPU_ALL },
+    [0xAD]{ "lda", 3, 4, ABS, CPU_ALL },
+    [0xBD]{ "lda", 3, 4, ABSX, CPU_ALL },
+    [0xB9]{ "lda", 3, 4, ABSY, CPU_ALL },
+    [0xA1]{ "lda", 2, 6, INDX, CPU_ALL },
+    [0xB1]{ "lda", 2, 5, INDY, CPU_ALL },
+
+    [0xA2]{ "ldx", 2, 2, IMM, CPU_ALL },
+    [0xA6]{ "ldx", 2, 3, ZP, CPU_ALL },
+    [0xB6]{ "ldx", 2, 4, ZPY, CPU_ALL },
+    [0xAE]{ "ldx", 3, 4, ABS, CPU_ALL },
+    [0xBE]{ "ldx", 3, 4, ABSY, CPU_ALL },
+
+    [0xA0]{ "ldy", 2, 2, IMM, CPU_ALL },
+    [0xA4]{ "ldy", 2, 3, ZP, CPU_ALL },
+    [0xB4]{ "ldy", 2, 4, ZPX, CPU_ALL },
+    [0xAC]{ "ldy", 3, 4, ABS, CPU_ALL },
+    [0xBC]{ "ldy", 3, 4, ABSX, CPU_ALL },
+
+    [0x4A]{ "lsr", 1, 2, ACC, CPU_ALL },
+    [0x46]{ "lsr", 2, 5, ZP, CPU_ALL },
+    [0x56]{ "lsr", 2, 6, ZPX, CPU_ALL },
+    [0x4E]{ "lsr", 3, 6, ABS, CPU_ALL },
+    [0x5E]{ "lsr", 3, 7, ABSX, CPU_ALL },
+
+    [0xAB]{ "lxa", 2, 2, IMM, CPU_6510 },
+
+    [0xEA]{ "nop", 1, 2, IMP, CPU_ALL },
+    [0x1A]{ "nop", 1, 2, IMP, 0 },
+    [0x3A]{ "nop", 1, 2, IMP, 0 },
+    [0x5A]{ "nop", 1, 2, IMP, 0 },
+    [0x7A]{ "nop", 1, 2, IMP, 0 },
+    [0xDA]{ "nop", 1, 2, IMP, 0 },
+    [0xFA]{ "nop", 1, 2, IMP, 0 },
+    [0x80]{ "nop", 2, 2, IMM, 0 },
+    [0x82]{ "nop", 2, 2, IMM, 0 },
+    [0x89]{ "nop", 2, 2, IMM, 0 },
+    [0xC2]{ "nop", 2, 2, IMM, 0 },
+    [0xE2]{ "nop", 2, 2, IMM, 0 },
+    [0x04]{ "nop", 2, 3, ZP, 0 },
+    [0x44]{ "nop", 2, 3, ZP, 0 },
+    [0x64]{ "nop", 2, 3, ZP, 0 },
+    [0x14]{ "nop", 2, 4, ZPX, 0 },
+    [0x34]{ "nop", 2, 4, ZPX, 0 },
+    [0x54]{ "nop", 2, 4, ZPX, 0 },
+    [0x74]{ "nop", 2, 4, ZPX, 0 },
+    [0xD4]{ "nop", 2, 4, ZPX, 0 },
+    [0xF4]{ "nop", 2, 4, ZPX, 0 },
+    [0x0C]{ "nop", 3, 4, ABS, 0 },
+    [0x1C]{ "nop", 3, 4, ABSX, 0 },
+    [0x3C]{ "nop", 3, 4, ABSX, 0 },
+    [0x5C]{ "nop", 3, 4, ABSX, 0 },
+    [0x7C]{ "nop", 3, 4, ABSX, 0 },
+    [0xDC]{ "nop", 3, 4, ABSX, 0 },
+    [0xFC]{ "nop", 3, 4, ABSX, 0 },
+
+    [0x09]{ "ora", 2, 2, IMM, CPU_ALL },
+    [0x05]{ "ora", 2, 3, ZP, CPU_ALL },
+    [0x15]{ "ora", 2, 4, ZPX, CPU_ALL },
+    [0x0D]{ "ora", 3, 4, ABS, CPU_ALL },
+    [0x1D]{ "ora", 3, 4, ABSX, CPU_ALL },
+    [0x19]{ "ora", 3, 4, ABSY, CPU_ALL },
+    [0x01]{ "ora", 2, 6, INDX, CPU_ALL },
+    [0x11]{ "ora", 2, 5, INDY, CPU_ALL },
+
+    [0x48]{ "pha", 1, 3, IMP, CPU_ALL },
+
+    [0x08]{ "php", 1, 3, IMP, CPU_ALL },
+
+    [0x68]{ "pla", 1, 4, IMP, CPU_ALL },
+
+    [0x28]{ "plp", 1, 4, IMP, CPU_ALL },
+
+    [0x27]{ "rla", 2, 5, ZP, CPU_6510 },
+    [0x37]{ "rla", 2, 6, ZPX, CPU_6510 },
+    [0x2F]{ "rla", 3, 6, ABS, CPU_6510 },
+    [0x3F]{ "rla", 3, 7, ABSX, CPU_6510 },
+    [0x3B]{ "rla", 3, 7, ABSY, CPU_6510 },
+    [0x23]{ "rla", 2, 8, INDX, CPU_6510 },
+    [0x33]{ "rla", 2, 8, INDY, CPU_6510 },
+
+    [0x2A]{ "rol", 1, 2, ACC, CPU_ALL },
+    [0x26]{ "rol", 2, 5, ZP, CPU_ALL },
+    [0x36]{ "rol", 2, 6, ZPX, CPU_ALL },
+    [0x2E]{ "rol", 3, 6, ABS, CPU_ALL },
+    [0x3E]{ "rol", 3, 7, ABSX, CPU_ALL },
+
+    [0x6A]{ "ror", 1, 2, ACC, CPU_ALL },
+    [0x66]{ "ror", 2, 5, ZP, CPU_ALL },
+    [0x76]{ "ror", 2, 6, ZPX, CPU_ALL },
+    [0x6E]{ "ror", 3, 6, ABS, CPU_ALL },
+    [0x7E]{ "ror", 3, 7, ABSX, CPU_ALL },
+
+    [0x67]{ "rra", 2, 5, ZP, CPU_6510 },
+    [0x77]{ "rra", 2, 6, ZPX, CPU_6510 },
+    [0x6F]{ "rra", 3, 6, ABS, CPU_6510 },
+    [0x7F]{ "rra", 3, 7, ABSX, CPU_6510 },
+    [0x7B]{ "rra", 3, 7, ABSY, CPU_6510 },
+    [0x63]{ "rra", 2, 8, INDX, CPU_6510 },
+    [0x73]{ "rra", 2, 8, INDY, CPU_6510 },
+
+    [0x40]{ "rti", 1, 6, IMP, CPU_ALL },
+
+    [0x60]{ "rts", 1, 6, IMP, CPU_ALL },
+
+    [0x87]{ "sax", 2, 3, ZP, CPU_6510 },
+    [0x97]{ "sax", 2, 4, ZPY, CPU_6510 },
+    [0x8F]{ "sax", 3, 4, ABS, CPU_6510 },
+    [0x83]{ "sax", 2, 6, INDX, CPU_6510 },
+
+    [0xE9]{ "sbc", 2, 2, IMM, CPU_ALL },
+    [0xE5]{ "sbc", 2, 3, ZP, CPU_ALL },
+    [0xF5]{ "sbc", 2, 4, ZPX, CPU_ALL },
+    [0xED]{ "sbc", 3, 4, ABS, CPU_ALL },
+    [0xFD]{ "sbc", 3, 4, ABSX, CPU_ALL },
+    [0xF9]{ "sbc", 3, 4, ABSY, CPU_ALL },
+    [0xE1]{ "sbc", 2, 6, INDX, CPU_ALL },
+    [0xF1]{ "sbc", 2, 5, INDY, CPU_ALL },
+
+    [0xEB]{ "sbc", 2, 2, IMM, CPU_ALL },
+
+    [0xCB]{ "sbx", 2, 2, IMM, CPU_6510 },
+
+    [0x38]{ "sec", 1, 2, IMP, CPU_ALL },
+
+    [0xF8]{ "sed", 1, 2, IMP, CPU_ALL },
+
+    [0x78]{ "sei", 1, 2, IMP, CPU_ALL },
+
+    [0x93]{ "sha", 2, 6, INDY, 0 },
+    [0x9F]{ "sha", 3, 5, ABSY, CPU_6510 },
+
+    [0x9B]{ "shs", 3, 5, ABSY, 0 },
+
+    [0x9E]{ "shx", 3, 5, ABSY, CPU_6510 },
+
+    [0x9C]{ "shy", 3, 5, ABSX, CPU_6510 },
+
+    [0x07]{ "slo", 2, 5, ZP, CPU_6510 },
+    [0x17]{ "slo", 2, 6, ZPX, CPU_6510 },
+    [0x0F]{ "slo", 3, 6, ABS, CPU_6510 },
+    [0x1F]{ "slo", 3, 7, ABSX, CPU_6510 },
+    [0x1B]{ "slo", 3, 7, ABSY, CPU_6510 },
+    [0x03]{ "slo", 2, 8, INDX, CPU_6510 },
+    [0x13]{ "slo", 2, 8, INDY, CPU_6510 },
+
+    [0x47]{ "sre", 2, 5, ZP, CPU_6510 },
+    [0x57]{ "sre", 2, 6, ZPX, CPU_6510 },
+    [0x4F]{ "sre", 3, 6, ABS, CPU_6510 },
+    [0x5F]{ "sre", 3, 7, ABSX, CPU_6510 },
+    [0x5B]{ "sre", 3, 7, ABSY, CPU_6510 },
+    [0x43]{ "sre", 2, 8, INDX, CPU_6510 },
+    [0x53]{ "sre", 2, 8, INDY, CPU_6510 },
+
+    [0x85]{ "sta", 2, 3, ZP, CPU_ALL },
+    [0x95]{ "sta", 2, 4, ZPX, CPU_ALL },
+    [0x8D]{ "sta", 3, 4, ABS, CPU_ALL },
+    [0x9D]{ "sta", 3, 5, ABSX, CPU_ALL },
+    [0x99]{ "sta", 3, 5, ABSY, CPU_ALL },
+    [0x81]{ "sta", 2, 6, INDX, CPU_ALL },
+    [0x91]{ "sta", 2, 6, INDY, CPU_ALL },
+
+    [0x86]{ "stx", 2, 3, ZP, CPU_ALL },
+    [0x96]{ "stx", 2, 4, ZPY, CPU_ALL },
+    [0x8E]{ "stx", 3, 4, ABS, CPU_ALL },
+
+    [0x84]{ "sty", 2, 3, ZP, CPU_ALL },
+    [0x94]{ "sty", 2, 4, ZPX, CPU_ALL },
+    [0x8C]{ "sty", 3, 4, ABS, CPU_ALL },
+
+    [0xAA]{ "tax", 1, 2, IMP, CPU_ALL },
+
+    [0xA8]{ "tay", 1, 2, IMP, CPU_ALL },
+
+    [0xBA]{ "tsx", 1, 2, IMP, CPU_ALL },
+
+    [0x8A]{ "txa", 1, 2, IMP, CPU_ALL },
+
+    [0x9A]{ "txs", 1, 2, IMP, CPU_ALL },
+
+    [0x98]{ "tya", 1, 2, IMP, CPU_ALL },
+};
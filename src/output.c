@@ -0,0 +1,235 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "output.h"
+#include "stats.h"
+
+const char hex_digits[]         = "0123456789abcdef";
+const char hex_digits_upper[]   = "0123456789ABCDEF";
+
+/* =============================================================================
+ * void flush_output(disass_context *ctx)
+ *
+ * hand everything collected in ctx->out to the output callback in one call
+ * =============================================================================
+ */
+void flush_output(disass_context *ctx)
+{
+    if (ctx->out.length > 0)
+    {
+        if (ctx->stats != NULL)
+        {
+            ctx->stats->output_bytes += ctx->out.length;
+        }
+        ctx->output(ctx->output_user, ctx->out.data, ctx->out.length);
+        ctx->out.length = 0;
+    }
+}
+
+/* =============================================================================
+ * void flush_output_to(disass_context *ctx, int start, const listing_output *output)
+ *
+ * hand everything collected in ctx->out from start on to output instead and
+ * drop it, what's in front of start is left for flush_output()
+ * =============================================================================
+ */
+void flush_output_to(disass_context *ctx, int start, const listing_output *output)
+{
+    if (ctx->out.length > start)
+    {
+        if (ctx->stats != NULL)
+        {
+            ctx->stats->output_bytes += ctx->out.length - start;
+        }
+        output->output(output->user, ctx->out.data + start, ctx->out.length - start);
+        ctx->out.length = start;
+    }
+}
+
+/* =============================================================================
+ * void free_output_buffer(output_buffer *buffer)
+ * =============================================================================
+ */
+void free_output_buffer(output_buffer *buffer)
+{
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->size = 0;
+}
+
+/* =============================================================================
+ * int grow_buffer(output_buffer *buffer, int length)
+ *
+ * return 0;  // on success
+ * return -1; // if out of memory
+ *
+ * make room for length more chars plus a terminating '\0'
+ * =============================================================================
+ */
+int grow_buffer(output_buffer *buffer, int length)
+{
+    char    *new_data;
+    int     new_size;
+
+    if (buffer->length + length + 1 <= buffer->size)
+    {
+        return 0;
+    }
+
+    new_size = buffer->size ? buffer->size : 0x10000;
+    while (buffer->length + length + 1 > new_size)
+    {
+        new_size *= 2;
+    }
+
+    new_data = realloc(buffer->data, new_size);
+    if (new_data == NULL)
+    {
+        return -1;
+    }
+    buffer->data = new_data;
+    buffer->size = new_size;
+
+    return 0;
+}
+
+/* =============================================================================
+ * void grow_output(disass_context *ctx, int length)
+ *
+ * grow_buffer() for ctx->out, there's no way to go on without memory
+ * =============================================================================
+ */
+void grow_output(disass_context *ctx, int length)
+{
+    if (grow_buffer(&ctx->out, length) != 0)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* =============================================================================
+ * void output_printf(disass_context *ctx, const char *format, ...)
+ *
+ * printf() into the output of ctx, for everything that isn't time critical
+ * =============================================================================
+ */
+void output_printf(disass_context *ctx, const char *format, ...)
+{
+    int     length;
+    int     space;
+    va_list args;
+
+    space = 256;
+    reserve_output(ctx, space);
+
+    va_start(args, format);
+    length = vsnprintf(ctx->out.data + ctx->out.length, space, format, args);
+    va_end(args);
+
+    if (length >= space)
+    {
+        // only very long filenames end up here
+        space = length + 1;
+        reserve_output(ctx, space);
+
+        va_start(args, format);
+        vsnprintf(ctx->out.data + ctx->out.length, space, format, args);
+        va_end(args);
+    }
+
+    if (length > 0)
+    {
+        ctx->out.length += length;
+    }
+}
+
+/* =============================================================================
+ * void output_to_buffer(void *user, const char *data, int length)
+ *
+ * output_func that appends everything to the output_buffer in user
+ * =============================================================================
+ */
+void output_to_buffer(void *user, const char *data, int length)
+{
+    output_buffer   *buffer     = user;
+
+    if (grow_buffer(buffer, length) != 0)
+    {
+        return;
+    }
+
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+
+    // keep it usable as a string
+    buffer->data[buffer->length] = '\0';
+}
+
+/* =============================================================================
+ * void output_to_fd(void *user, const char *data, int length)
+ *
+ * output_func that write()s everything to the file descriptor user points to.
+ * errors are lost, use write_fd() where they matter.
+ * =============================================================================
+ */
+void output_to_fd(void *user, const char *data, int length)
+{
+    write_fd(*(int *)user, data, length);
+}
+
+/* =============================================================================
+ * void output_to_file(void *user, const char *data, int length)
+ *
+ * output_func that writes everything to the FILE * in user
+ * =============================================================================
+ */
+void output_to_file(void *user, const char *data, int length)
+{
+    fwrite(data, 1, length, (FILE *)user);
+}
+
+/* =============================================================================
+ * void set_output(disass_context *ctx, output_func output, void *user)
+ *
+ * from now on all output of ctx is sent to output(user, data, length)
+ * =============================================================================
+ */
+void set_output(disass_context *ctx, output_func output, void *user)
+{
+    ctx->output = output;
+    ctx->output_user = user;
+}
+
+/* =============================================================================
+ * int write_fd(int fd, const char *data, int length)
+ *
+ * return 0;  // once all of data is written
+ * return -1; // if a write() failed, e.g. with ENOSPC
+ * =============================================================================
+ */
+int write_fd(int fd, const char *data, int length)
+{
+    ssize_t written;
+
+    while (length > 0)
+    {
+        written = write(fd, data, length);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+        data += written;
+        length -= written;
+    }
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <string.h>
+#include "disass.h"
+
+/* all output of a context is collected in ctx->out and handed to the output
+ * callback in one piece by flush_output(). the helpers below format straight
+ * into that buffer, which is a lot cheaper than a printf() per token.
+ */
+
+extern const char hex_digits[];
+extern const char hex_digits_upper[];
+
+void flush_output(disass_context *ctx);
+void flush_output_to(disass_context *ctx, int start, const listing_output *output);
+int grow_buffer(output_buffer *buffer, int length);
+void grow_output(disass_context *ctx, int length);
+
+/* =============================================================================
+ * char *reserve_output(disass_context *ctx, int length)
+ * return pointer;
+ *
+ * make sure there's room for length more chars in ctx->out and return
+ * where they go. the caller has to add length to ctx->out.length itself.
+ * =============================================================================
+ */
+static inline char *reserve_output(disass_context *ctx, int length)
+{
+    if (ctx->out.length + length > ctx->out.size)
+    {
+        grow_output(ctx, length);
+    }
+
+    return ctx->out.data + ctx->out.length;
+}
+
+static inline void output_chars(disass_context *ctx, const char *chars, int length)
+{
+    memcpy(reserve_output(ctx, length), chars, length);
+    ctx->out.length += length;
+}
+
+static inline void output_string(disass_context *ctx, const char *string)
+{
+    output_chars(ctx, string, strlen(string));
+}
+
+static inline void output_char(disass_context *ctx, char c)
+{
+    *reserve_output(ctx, 1) = c;
+    ctx->out.length++;
+}
+
+static inline void output_spaces(disass_context *ctx, int count)
+{
+    memset(reserve_output(ctx, count), ' ', count);
+    ctx->out.length += count;
+}
+
+/* =============================================================================
+ * void output_hex8(disass_context *ctx, int value)     // printf("%02x")
+ * void output_hex16(disass_context *ctx, int value)    // printf("%04x")
+ * void output_label(disass_context *ctx, int pc)       // printf("pc%04X")
+ *
+ * output_label() prints the name from the annotations instead, if any
+ * =============================================================================
+ */
+static inline void output_hex8(disass_context *ctx, int value)
+{
+    char *p = reserve_output(ctx, 2);
+
+    p[0] = hex_digits[(value >> 4) & 0x0F];
+    p[1] = hex_digits[value & 0x0F];
+    ctx->out.length += 2;
+}
+
+static inline void output_hex16(disass_context *ctx, int value)
+{
+    char *p = reserve_output(ctx, 4);
+
+    p[0] = hex_digits[(value >> 12) & 0x0F];
+    p[1] = hex_digits[(value >> 8) & 0x0F];
+    p[2] = hex_digits[(value >> 4) & 0x0F];
+    p[3] = hex_digits[value & 0x0F];
+    ctx->out.length += 4;
+}
+
+static inline void output_label(disass_context *ctx, int pc)
+{
+    const char  *name;
+    char        *p;
+
+    if (ctx->notes != NULL && (name = find_label_name(ctx->notes, pc)) != NULL)
+    {
+        output_string(ctx, name);
+        return;
+    }
+
+    p = reserve_output(ctx, 6);
+
+    p[0] = 'p';
+    p[1] = 'c';
+    p[2] = hex_digits_upper[(pc >> 12) & 0x0F];
+    p[3] = hex_digits_upper[(pc >> 8) & 0x0F];
+    p[4] = hex_digits_upper[(pc >> 4) & 0x0F];
+    p[5] = hex_digits_upper[pc & 0x0F];
+    ctx->out.length += 6;
+}
+
+#endif // OUTPUT_H_
@@ -0,0 +1,894 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "listing.h"
+#include "output.h"
+#include "project.h"
+
+/* =============================================================================
+ * annotation files
+ *
+ * plain text, one annotation per line, everything after ';' or '#' is a
+ * comment. addresses are decimal, 0x... hex or 0... octal like with -e:
+ *
+ *      code 0x1000-0x10ff      force code, decoded from 0x1000 on. also an
+ *                              entry point for -f
+ *      data 0x2000-0x20ff      force data
+ *      data 0x2000             a single byte
+ *      entry 0x1234            follow the code from 0x1234
+ *      label 0x1000 main       name instead of pc1000
+ *
+ * ranges include their end address. they are applied after the analysis in
+ * the order of the file, so a later range wins where two overlap. for a
+ * label given more than once the last name wins.
+ *
+ * incremental updates
+ *
+ * a project keeps the datamap of the analysis without the forced ranges and
+ * the output split into segments, one per run of data or code. after the
+ * annotation file has changed, update_project()
+ *
+ *      1.) reuses the old analysis. with -f only new entry points are
+ *          followed, nothing is redone unless an entry point was removed
+ *
+ *      2.) applies the annotations and rebuilds blocks and labelmap, all of
+ *          that is a single pass over the datamap
+ *
+ *      3.) marks every address where the type, label or label name changed
+ *          and every jmp to an address whose label or label name changed
+ *
+ *      4.) prints only the segments with a marked address in them, all
+ *          others are copied from the last output
+ *
+ * with -f a new entry point is followed after the old ones, so where two
+ * paths overlap the old one wins. a complete run may decide the other way.
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * void append_segment(project *prj, const output_segment *segment)
+ * =============================================================================
+ */
+static void append_segment(project *prj, const output_segment *segment)
+{
+    output_segment  *new_segments;
+
+    if (prj->segments_count == prj->segments_size)
+    {
+        prj->segments_size = prj->segments_size ? prj->segments_size * 2 : 0x100;
+        new_segments = realloc(prj->segments, prj->segments_size * sizeof(output_segment));
+        if (new_segments == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        prj->segments = new_segments;
+    }
+
+    prj->segments[prj->segments_count] = *segment;
+    prj->segments_count++;
+}
+
+/* =============================================================================
+ * int compare_labels(const void *a, const void *b)
+ *
+ * qsort() helper, by address and then by line
+ * =============================================================================
+ */
+static int compare_labels(const void *a, const void *b)
+{
+    const label_name    *label_a    = a;
+    const label_name    *label_b    = b;
+
+    if (label_a->pc != label_b->pc)
+    {
+        return label_a->pc - label_b->pc;
+    }
+
+    return label_a->line - label_b->line;
+}
+
+/* =============================================================================
+ * void end_code_before(disass_context *ctx, int pc)
+ *
+ * an instruction printed in front of a forced code range must not swallow
+ * its first bytes, its bytes become data then. the instructions are found
+ * the way print_range() does it, from the start of the run of code.
+ * =============================================================================
+ */
+static void end_code_before(disass_context *ctx, int pc)
+{
+    int first       = (ctx->basic_end > ctx->pc_start) ? ctx->basic_end : ctx->pc_start;
+    int opcode;
+    int start;
+
+    for (start = pc; start > first && get_datatype(ctx, start - 1) != DATATYPE_DATA; start--)
+    {
+    }
+
+    while (start < pc)
+    {
+        opcode = ctx->assembly.data[start - ctx->pc_start];
+
+        if (!is_in_mode(ctx, opcode) || get_datatype(ctx, start) == DATATYPE_DATA)
+        {
+            start++;
+            continue;
+        }
+
+        if (start + opcodes[opcode].bytes > pc)
+        {
+            for (; start < pc; start++)
+            {
+                set_datatype(ctx, start, DATATYPE_DATA);
+            }
+            return;
+        }
+
+        start += opcodes[opcode].bytes;
+    }
+}
+
+/* =============================================================================
+ * int is_marked(const unsigned char *map, int pc_start, int pc_end)
+ * void mark(unsigned char *map, int pc)
+ *
+ * bitmaps like the labelmap, is_marked() checks pc_start up to pc_end
+ * =============================================================================
+ */
+static int is_marked(const unsigned char *map, int pc_start, int pc_end)
+{
+    int pc;
+
+    for (pc = pc_start; pc < pc_end && pc < MAP_SIZE; pc++)
+    {
+        if ((pc & 7) == 0 && map[pc >> 3] == 0 && pc + 8 <= pc_end)
+        {
+            pc += 7;
+            continue;
+        }
+        if ((map[pc >> 3] >> (pc & 7)) & 1)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void mark(unsigned char *map, int pc)
+{
+    map[pc >> 3] |= 1 << (pc & 7);
+}
+
+/* =============================================================================
+ * void mark_entries(const annotations *notes, unsigned char *map)
+ *
+ * mark every entry point and start of a forced code range in notes
+ * =============================================================================
+ */
+static void mark_entries(const annotations *notes, unsigned char *map)
+{
+    int i;
+
+    for (i = 0; i < notes->entries.count; i++)
+    {
+        mark(map, notes->entries.addresses[i]);
+    }
+
+    for (i = 0; i < notes->ranges.count; i++)
+    {
+        if (notes->ranges.blocks[i].type == DATATYPE_CODE)
+        {
+            mark(map, notes->ranges.blocks[i].pc_start);
+        }
+    }
+}
+
+/* =============================================================================
+ * void print_project(disass_context *ctx, project *prj,
+ *                    const unsigned char *dirty)
+ *
+ * print_disassembly() segment by segment. a segment of the last output is
+ * copied instead of printed if it starts and ends at the same addresses, the
+ * !byte rows are in the same state and no address of it is marked in dirty.
+ * without dirty everything is printed.
+ * =============================================================================
+ */
+static void print_project(disass_context *ctx, project *prj, const unsigned char *dirty)
+{
+    output_segment  *old_segments   = prj->segments;
+    output_segment  *old;
+    output_segment  segment;
+    int             old_count       = prj->segments_count;
+    int             row             = -1;
+    int             body;
+    int             start;
+    int             type;
+    int             pc              = ctx->pc_start;
+    int             j               = 0;
+
+    ctx->listing.count = 0;
+    list_header(ctx, &ctx->listing);
+    render_listing(ctx, &ctx->listing, ctx->syntax);
+
+    if (ctx->basic_end > ctx->pc_start)
+    {
+        pc = ctx->basic_end;
+    }
+
+    body = ctx->out.length;
+
+    prj->segments = NULL;
+    prj->segments_count = 0;
+    prj->segments_size = 0;
+    prj->reused = 0;
+    prj->printed = 0;
+
+    while (pc < ctx->pc_end)
+    {
+        type = (get_datatype(ctx, pc) == DATATYPE_DATA);
+
+        segment.pc_start = pc;
+        segment.bytes_in = row;
+        for (segment.pc_end = pc + 1; segment.pc_end < ctx->pc_end; segment.pc_end++)
+        {
+            if ((get_datatype(ctx, segment.pc_end) == DATATYPE_DATA) != type)
+            {
+                break;
+            }
+        }
+
+        while (j < old_count && old_segments[j].pc_start < pc)
+        {
+            j++;
+        }
+        old = (j < old_count) ? &old_segments[j] : NULL;
+
+        start = ctx->out.length;
+        if (dirty != NULL && old != NULL
+            && old->pc_start == pc && old->pc_end == segment.pc_end
+            && old->bytes_in == row
+            && !is_marked(dirty, pc, old->pc_next))
+        {
+            output_chars(ctx, prj->text.data + old->offset, old->length);
+            segment.pc_next = old->pc_next;
+            row = old->bytes_out;
+            prj->reused++;
+        }
+        else
+        {
+            segment.pc_next = print_range(ctx, pc, segment.pc_end, &row);
+            prj->printed++;
+        }
+        segment.bytes_out = row;
+        segment.offset = start - body;
+        segment.length = ctx->out.length - start;
+
+        append_segment(prj, &segment);
+        pc = segment.pc_next;
+    }
+
+    free(old_segments);
+
+    // the old text isn't needed anymore, keep the new one for the next update
+    prj->text.length = 0;
+    if (grow_buffer(&prj->text, ctx->out.length - body) != 0)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(prj->text.data, ctx->out.data + body, ctx->out.length - body);
+    prj->text.length = ctx->out.length - body;
+}
+
+/* =============================================================================
+ * void finish_update(disass_context *ctx, project *prj, annotations *notes,
+ *                    const unsigned char *changed)
+ *
+ * steps 2 - 4 of update_project() and reload_project(), ctx->datamap has to
+ * hold the new analysis. notes replace prj->notes, changed marks addresses
+ * whose bytes have changed or is NULL.
+ * =============================================================================
+ */
+static void finish_update(disass_context *ctx, project *prj, annotations *notes,
+    const unsigned char *changed)
+{
+    const char      *old_name;
+    const char      *new_name;
+    unsigned char   labels[(MAP_SIZE + 7) / 8];
+    unsigned char   dirty[(MAP_SIZE + 7) / 8];
+    int             target;
+    int             pc;
+    int             i;
+    int             j;
+
+    // step 2
+    ctx->notes = notes;
+    apply_annotations(ctx);
+
+    ctx->codeblocks.count = 0;
+    ctx->datablocks.count = 0;
+    fill_datablocks(ctx);
+
+    memset(ctx->labelmap, 0, sizeof(ctx->labelmap));
+    create_labelmap(ctx);
+
+    // step 3
+    if (changed != NULL)
+    {
+        memcpy(dirty, changed, sizeof(dirty));
+    }
+    else
+    {
+        memset(dirty, 0, sizeof(dirty));
+    }
+
+    for (pc = ctx->pc_start; pc < ctx->pc_end; pc++)
+    {
+        if ((get_datatype(ctx, pc) == DATATYPE_DATA)
+            != (((prj->datamap[pc >> 2] >> ((pc & 3) << 1)) & 3) == DATATYPE_DATA))
+        {
+            mark(dirty, pc);
+        }
+    }
+
+    for (i = 0; i < sizeof(dirty); i++)
+    {
+        labels[i] = ctx->labelmap[i] ^ prj->labelmap[i];
+    }
+
+    // a renamed label leaves the labelmap as it is, but not the output
+    for (i = 0, j = 0; i < prj->notes.labels_count || j < notes->labels_count; )
+    {
+        if (j == notes->labels_count
+            || (i < prj->notes.labels_count && prj->notes.labels[i].pc < notes->labels[j].pc))
+        {
+            mark(labels, prj->notes.labels[i++].pc);
+        }
+        else if (i == prj->notes.labels_count || notes->labels[j].pc < prj->notes.labels[i].pc)
+        {
+            mark(labels, notes->labels[j++].pc);
+        }
+        else
+        {
+            old_name = prj->notes.labels[i++].name;
+            new_name = notes->labels[j].name;
+            if (strcmp(old_name, new_name) != 0)
+            {
+                mark(labels, notes->labels[j].pc);
+            }
+            j++;
+        }
+    }
+
+    for (i = 0; i < sizeof(dirty); i++)
+    {
+        dirty[i] |= labels[i];
+    }
+
+    for (pc = ctx->basic_end; pc < ctx->pc_end; pc++)
+    {
+        if (ctx->assembly.data[pc - ctx->pc_start] == 0x4C)
+        {
+            target = get_byte(ctx, pc + 1 - ctx->pc_start)
+                + (get_byte(ctx, pc + 2 - ctx->pc_start) << 8);
+            if (is_marked(labels, target, target + 1))
+            {
+                mark(dirty, pc);
+            }
+        }
+    }
+
+    // step 4
+    if (notes != &prj->notes)
+    {
+        free_annotations(&prj->notes);
+        prj->notes = *notes;
+        ctx->notes = &prj->notes;
+    }
+
+    print_project(ctx, prj, dirty);
+
+    memcpy(prj->datamap, ctx->datamap, sizeof(prj->datamap));
+    memcpy(prj->labelmap, ctx->labelmap, sizeof(prj->labelmap));
+
+    memcpy(prj->memory, ctx->assembly.data, ctx->assembly.length);
+
+    flush_output(ctx);
+
+}
+
+/* =============================================================================
+ * void add_label_name(annotations *notes, int pc, int line, const char *name)
+ *
+ * append a copy of name, call sort_label_names() once all are added
+ * =============================================================================
+ */
+void add_label_name(annotations *notes, int pc, int line, const char *name)
+{
+    label_name      *new_labels;
+
+    if (notes->labels_count == notes->labels_size)
+    {
+        notes->labels_size = notes->labels_size ? notes->labels_size * 2 : 0x40;
+        new_labels = realloc(notes->labels, notes->labels_size * sizeof(label_name));
+        if (new_labels == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        notes->labels = new_labels;
+    }
+
+    notes->labels[notes->labels_count].pc = pc;
+    notes->labels[notes->labels_count].line = line;
+    notes->labels[notes->labels_count].name = strdup(name);
+    if (notes->labels[notes->labels_count].name == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    notes->labels_count++;
+}
+
+/* =============================================================================
+ * void apply_annotations(disass_context *ctx)
+ *
+ * force the code and data ranges of ctx->notes on the datamap. without flow
+ * analysis the entry points are followed here as well, create_flowmap()
+ * takes care of them otherwise.
+ * =============================================================================
+ */
+void apply_annotations(disass_context *ctx)
+{
+    const annotations   *notes      = ctx->notes;
+    const datablock     *range;
+    int                 opcode;
+    int                 pc;
+    int                 pc_end;
+    int                 i;
+    int                 j;
+
+    if (!ctx->flow)
+    {
+        ctx->worklist.count = 0;
+        for (i = notes->entries.count - 1; i >= 0; i--)
+        {
+            append_address(&ctx->worklist, notes->entries.addresses[i]);
+        }
+        follow_worklist(ctx);
+    }
+
+    for (i = 0; i < notes->ranges.count; i++)
+    {
+        range = &notes->ranges.blocks[i];
+        pc = (range->pc_start > ctx->basic_end) ? range->pc_start : ctx->basic_end;
+        pc_end = (range->pc_end + 1 < ctx->pc_end) ? range->pc_end + 1 : ctx->pc_end;
+
+        if (range->type == DATATYPE_CODE && pc < pc_end)
+        {
+            end_code_before(ctx, pc);
+        }
+
+        while (pc < pc_end)
+        {
+            opcode = ctx->assembly.data[pc - ctx->pc_start];
+
+            if (range->type == DATATYPE_DATA || !is_in_mode(ctx, opcode))
+            {
+                set_datatype(ctx, pc, DATATYPE_DATA);
+                pc++;
+                continue;
+            }
+
+            // the last instruction may reach beyond the range
+            for (j = 0; j < opcodes[opcode].bytes && pc < ctx->pc_end; j++)
+            {
+                set_datatype(ctx, pc, DATATYPE_CODE);
+                pc++;
+            }
+        }
+    }
+}
+
+/* =============================================================================
+ * void close_project(project *prj)
+ * =============================================================================
+ */
+void close_project(project *prj)
+{
+    free_annotations(&prj->notes);
+    free(prj->segments);
+    free_output_buffer(&prj->text);
+
+    memset(prj, 0, sizeof(project));
+}
+
+/* =============================================================================
+ * void disassemble_project(disass_context *ctx, project *prj)
+ *
+ * disassemble() the data loaded into ctx with the annotations of prj and
+ * keep everything update_project() needs. ctx->notes points to prj->notes
+ * afterwards, ctx and prj belong together from now on.
+ * =============================================================================
+ */
+void disassemble_project(disass_context *ctx, project *prj)
+{
+    ctx->notes = &prj->notes;
+
+    if (ctx->flow)
+    {
+        create_flowmap(ctx);
+    }
+    else
+    {
+        create_datamap(ctx);
+    }
+    memcpy(prj->base, ctx->datamap, sizeof(prj->base));
+
+    apply_annotations(ctx);
+
+    fill_datablocks(ctx);
+
+    create_labelmap(ctx);
+
+    print_project(ctx, prj, NULL);
+
+    memcpy(prj->datamap, ctx->datamap, sizeof(prj->datamap));
+    memcpy(prj->labelmap, ctx->labelmap, sizeof(prj->labelmap));
+    memcpy(prj->memory, ctx->assembly.data, ctx->assembly.length);
+    prj->pc_start = ctx->pc_start;
+    prj->pc_end = ctx->pc_end;
+    prj->basic_end = ctx->basic_end;
+
+    flush_output(ctx);
+}
+
+/* =============================================================================
+ * const char *find_label_name(const annotations *notes, int pc)
+ *
+ * return name;  // of the label at pc
+ * return NULL;  // if there is none
+ * =============================================================================
+ */
+const char *find_label_name(const annotations *notes, int pc)
+{
+    int low     = 0;
+    int high    = notes->labels_count - 1;
+    int middle;
+
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+
+        if (notes->labels[middle].pc == pc)
+        {
+            return notes->labels[middle].name;
+        }
+        if (notes->labels[middle].pc < pc)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return NULL;
+}
+
+/* =============================================================================
+ * void free_annotations(annotations *notes)
+ * =============================================================================
+ */
+void free_annotations(annotations *notes)
+{
+    int i;
+
+    for (i = 0; i < notes->labels_count; i++)
+    {
+        free(notes->labels[i].name);
+    }
+    free(notes->labels);
+    free(notes->ranges.blocks);
+    free(notes->entries.addresses);
+
+    memset(notes, 0, sizeof(annotations));
+}
+
+/* =============================================================================
+ * int is_label_name(const char *name)
+ *
+ * return 1; // if name can be used as a label by the assembler
+ * =============================================================================
+ */
+int is_label_name(const char *name)
+{
+    if (!isalpha((unsigned char)*name) && *name != '_')
+    {
+        return 0;
+    }
+
+    for (name++; *name != '\0'; name++)
+    {
+        if (!isalnum((unsigned char)*name) && *name != '_')
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* =============================================================================
+ * int load_annotations(annotations *notes, const char *filename)
+ *
+ * return 0;    // on success
+ * return -1;   // if filename couldn't be read
+ * return line; // number of the first line that couldn't be parsed
+ *
+ * read the annotation file, see above. notes is left empty on errors.
+ * =============================================================================
+ */
+int load_annotations(annotations *notes, const char *filename)
+{
+    FILE            *file;
+    datablock       range;
+    char            line[1024];
+    char            keyword[16];
+    char            name[256];
+    char            *comment;
+    int             start;
+    int             end;
+    int             count;
+    int             line_number     = 0;
+    int             result          = 0;
+
+    memset(notes, 0, sizeof(annotations));
+
+    file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    while (result == 0 && fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+
+        comment = strpbrk(line, ";#");
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        if (sscanf(line, "%15s", keyword) != 1)
+        {
+            continue;
+        }
+
+        if (strcmp(keyword, "code") == 0 || strcmp(keyword, "data") == 0)
+        {
+            count = sscanf(line, "%*s %i - %i", &start, &end);
+            if (count == 1)
+            {
+                end = start;
+            }
+            if (count < 1 || start < 0 || end > 0xFFFF || start > end)
+            {
+                result = line_number;
+                continue;
+            }
+
+            range.pc_start = start;
+            range.pc_end = end;
+            range.type = (keyword[0] == 'c') ? DATATYPE_CODE : DATATYPE_DATA;
+            append_block(&notes->ranges, range);
+        }
+        else if (strcmp(keyword, "entry") == 0)
+        {
+            if (sscanf(line, "%*s %i", &start) != 1 || start < 0 || start > 0xFFFF)
+            {
+                result = line_number;
+                continue;
+            }
+
+            append_address(&notes->entries, start);
+        }
+        else if (strcmp(keyword, "label") == 0)
+        {
+            if (sscanf(line, "%*s %i %255s", &start, name) != 2
+                || start < 0 || start > 0xFFFF || !is_label_name(name))
+            {
+                result = line_number;
+                continue;
+            }
+
+            add_label_name(notes, start, line_number, name);
+        }
+        else
+        {
+            result = line_number;
+        }
+    }
+
+    fclose(file);
+
+    if (result != 0)
+    {
+        free_annotations(notes);
+        return result;
+    }
+
+    sort_label_names(notes);
+
+    return 0;
+}
+
+/* =============================================================================
+ * int open_project(project *prj, const char *filename)
+ *
+ * return 0;    // on success
+ * return ...;  // error of load_annotations()
+ *
+ * a project for the annotation file filename, NULL for none. call
+ * disassemble_project() next, after the file has been loaded into a context.
+ * =============================================================================
+ */
+int open_project(project *prj, const char *filename)
+{
+    memset(prj, 0, sizeof(project));
+
+    return (filename != NULL) ? load_annotations(&prj->notes, filename) : 0;
+}
+
+/* =============================================================================
+ * void reload_project(disass_context *ctx, project *prj)
+ *
+ * the file of prj has changed and was loaded into ctx again. analyse it
+ * completely and send the new disassembly to the output of ctx, only the
+ * segments with changed bytes, types or labels are printed. if the file has
+ * moved or changed its size it's a new disassemble_project().
+ * =============================================================================
+ */
+void reload_project(disass_context *ctx, project *prj)
+{
+    unsigned char   changed[(MAP_SIZE + 7) / 8];
+    int             pc;
+
+    if (ctx->pc_start != prj->pc_start || ctx->pc_end != prj->pc_end
+        || ctx->basic_end != prj->basic_end)
+    {
+        disassemble_project(ctx, prj);
+        return;
+    }
+
+    memset(changed, 0, sizeof(changed));
+    for (pc = ctx->pc_start; pc < ctx->pc_end; pc++)
+    {
+        if (ctx->assembly.data[pc - ctx->pc_start] != prj->memory[pc - ctx->pc_start])
+        {
+            mark(changed, pc);
+        }
+    }
+
+    ctx->notes = &prj->notes;
+
+    if (ctx->flow)
+    {
+        create_flowmap(ctx);
+    }
+    else
+    {
+        create_datamap(ctx);
+    }
+    memcpy(prj->base, ctx->datamap, sizeof(prj->base));
+
+    finish_update(ctx, prj, &prj->notes, changed);
+}
+
+/* =============================================================================
+ * void sort_label_names(annotations *notes)
+ *
+ * sort the labels for find_label_name(), only the name with the highest line
+ * number of an address is kept
+ * =============================================================================
+ */
+void sort_label_names(annotations *notes)
+{
+    int i;
+    int j;
+
+    qsort(notes->labels, notes->labels_count, sizeof(label_name), compare_labels);
+
+    for (i = 0, j = 0; i < notes->labels_count; i++)
+    {
+        if (i + 1 < notes->labels_count && notes->labels[i + 1].pc == notes->labels[i].pc)
+        {
+            free(notes->labels[i].name);
+            continue;
+        }
+        notes->labels[j++] = notes->labels[i];
+    }
+    notes->labels_count = j;
+}
+
+/* =============================================================================
+ * int update_project(disass_context *ctx, project *prj, const char *filename)
+ *
+ * return 0;    // on success
+ * return ...;  // error of load_annotations(), nothing has changed then
+ *
+ * read the annotation file again and send the new disassembly to the output
+ * of ctx, only redoing what the changes affect, see above. ctx must be the
+ * context of the last disassemble_project() / update_project() of prj.
+ * =============================================================================
+ */
+int update_project(disass_context *ctx, project *prj, const char *filename)
+{
+    annotations     notes;
+    unsigned char   old_entries[(MAP_SIZE + 7) / 8];
+    unsigned char   new_entries[(MAP_SIZE + 7) / 8];
+    int             result;
+    int             removed     = 0;
+    int             pc;
+    int             i;
+
+    result = load_annotations(&notes, filename);
+    if (result != 0)
+    {
+        return result;
+    }
+
+    // step 1
+    memcpy(ctx->datamap, prj->base, sizeof(prj->base));
+
+    if (ctx->flow)
+    {
+        memset(old_entries, 0, sizeof(old_entries));
+        memset(new_entries, 0, sizeof(new_entries));
+        mark_entries(&prj->notes, old_entries);
+        mark_entries(&notes, new_entries);
+
+        for (i = 0; i < sizeof(old_entries); i++)
+        {
+            removed |= old_entries[i] & ~new_entries[i];
+        }
+
+        ctx->notes = &notes;
+        if (removed)
+        {
+            memset(ctx->datamap, 0, sizeof(ctx->datamap));
+            create_flowmap(ctx);
+        }
+        else
+        {
+            ctx->worklist.count = 0;
+            for (i = 0; i < notes.entries.count; i++)
+            {
+                pc = notes.entries.addresses[i];
+                if (!is_marked(old_entries, pc, pc + 1))
+                {
+                    append_address(&ctx->worklist, pc);
+                }
+            }
+            for (i = 0; i < notes.ranges.count; i++)
+            {
+                pc = notes.ranges.blocks[i].pc_start;
+                if (notes.ranges.blocks[i].type == DATATYPE_CODE && !is_marked(old_entries, pc, pc + 1))
+                {
+                    append_address(&ctx->worklist, pc);
+                }
+            }
+            follow_worklist(ctx);
+        }
+        memcpy(prj->base, ctx->datamap, sizeof(prj->base));
+    }
+
+    finish_update(ctx, prj, &notes, NULL);
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#ifndef PROJECT_H_
+#define PROJECT_H_
+
+#include "disass.h"
+
+/* a name given to an address in the annotation file
+ */
+typedef struct
+{
+    int             pc;
+    int             line;           // in the annotation file, the last one wins
+    char            *name;
+} label_name;
+
+/* everything read from an annotation file, see load_annotations(). read-only
+ * once loaded, so any number of contexts can share it via ctx->notes.
+ */
+struct annotations
+{
+    block_list      ranges;         // forced DATATYPE_CODE / DATATYPE_DATA, pc_end inclusive
+    address_list    entries;
+    label_name      *labels;        // sorted by pc, see find_label_name()
+    int             labels_count;
+    int             labels_size;
+};
+
+/* one run of data or code in the output of a project, printed in one go by
+ * print_range() and reused as long as nothing in it changes
+ */
+typedef struct
+{
+    int             pc_start;
+    int             pc_end;         // where the run of data / code ends
+    int             pc_next;        // where printing stopped, an instruction may reach beyond
+    int             bytes_in;       // state of the !byte rows at pc_start
+    int             bytes_out;      // ... and at pc_next
+    int             offset;         // of the text in project->text
+    int             length;
+} output_segment;
+
+/* state kept between disassemble_project() and update_project() /
+ * reload_project() so that a changed annotation file or binary only costs
+ * what actually changed
+ */
+typedef struct
+{
+    annotations     notes;
+    unsigned char   base[(MAP_SIZE + 3) / 4];       // datamap before apply_annotations()
+    unsigned char   datamap[(MAP_SIZE + 3) / 4];    // as printed the last time
+    unsigned char   labelmap[(MAP_SIZE + 7) / 8];
+    unsigned char   memory[MEMORY_SIZE];            // the bytes of the last run
+    int             pc_start;
+    int             pc_end;
+    int             basic_end;
+    output_segment  *segments;
+    int             segments_count;
+    int             segments_size;
+    output_buffer   text;           // everything after the header of the last output
+    int             reused;         // segments copied by the last update_project()
+    int             printed;        // segments printed by the last update_project()
+} project;
+
+void add_label_name(annotations *notes, int pc, int line, const char *name);
+void close_project(project *prj);
+void disassemble_project(disass_context *ctx, project *prj);
+void free_annotations(annotations *notes);
+int is_label_name(const char *name);
+int load_annotations(annotations *notes, const char *filename);
+int open_project(project *prj, const char *filename);
+void reload_project(disass_context *ctx, project *prj);
+void sort_label_names(annotations *notes);
+int update_project(disass_context *ctx, project *prj, const char *filename);
+
+#endif // PROJECT_H_
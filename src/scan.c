@@ -0,0 +1,249 @@
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+#include "scan.h"
+
+/* =============================================================================
+ * pre-scan for create_datamap()
+ *
+ * one pass over the loaded bytes that marks
+ *
+ *      ends:   rts, and jmp / jmp() whose operand lies in [pc_start, pc_end)
+ *      jumps:  every jmp / jmp() opcode
+ *
+ * with one bit per offset into ctx->assembly.data. the vector versions test
+ * 16 or 32 offsets at once: the opcode compares are plain byte compares, the
+ * operand is formed by interleaving the bytes at offset + 1 and + 2 into
+ * words. they stop 2 bytes plus one vector before the end of the data, the
+ * rest is done by the scalar loop which reads past the end as 0 like
+ * get_byte().
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * void scan_scalar(const disass_context *ctx, unsigned long long *ends,
+ *      unsigned long long *jumps, int i)
+ *
+ * from offset i to the end of the data
+ * =============================================================================
+ */
+static void scan_scalar(const disass_context *ctx, unsigned long long *ends,
+    unsigned long long *jumps, int i)
+{
+    const unsigned char *data   = ctx->assembly.data;
+    int                 length  = ctx->assembly.length;
+    int                 address;
+
+    for (; i < length; i++)
+    {
+        if (data[i] == 0x60)
+        {
+            ends[i >> 6] |= 1ULL << (i & 63);
+        }
+        else if (data[i] == 0x4C || data[i] == 0x6C)
+        {
+            jumps[i >> 6] |= 1ULL << (i & 63);
+
+            address = ((i + 1 < length) ? data[i+1] : 0) + (((i + 2 < length) ? data[i+2] : 0) << 8);
+            if (address >= ctx->pc_start && address < ctx->pc_end)
+            {
+                ends[i >> 6] |= 1ULL << (i & 63);
+            }
+        }
+    }
+}
+
+#ifdef SCAN_X86
+
+/* =============================================================================
+ * int scan_sse2(const disass_context *ctx, unsigned long long *ends,
+ *      unsigned long long *jumps)
+ *
+ * return i; // first offset left for scan_scalar()
+ *
+ * the range test is unsigned: address - pc_start < pc_end - pc_start, done
+ * as a signed compare with both sides shifted by 0x8000. a file covering all
+ * of memory has every address in range.
+ * =============================================================================
+ */
+__attribute__((target("sse2")))
+static int scan_sse2(const disass_context *ctx, unsigned long long *ends,
+    unsigned long long *jumps)
+{
+    const unsigned char *data   = ctx->assembly.data;
+    int                 span    = ctx->pc_end - ctx->pc_start;
+    __m128i             rts     = _mm_set1_epi8(0x60);
+    __m128i             jmp     = _mm_set1_epi8(0x4C);
+    __m128i             fold    = _mm_set1_epi8((char)0xDF);  // 0x6C -> 0x4C
+    __m128i             start   = _mm_set1_epi16((short)(ctx->pc_start + 0x8000));
+    __m128i             limit   = _mm_set1_epi16((short)(span - 0x8000));
+    __m128i             bytes;
+    __m128i             low;
+    __m128i             high;
+    __m128i             in_range;
+    unsigned int        is_rts;
+    unsigned int        is_jmp;
+    unsigned int        is_end;
+    int                 i;
+
+    for (i = 0; i + 2 + 16 <= ctx->assembly.length; i += 16)
+    {
+        bytes = _mm_loadu_si128((const __m128i *)(data + i));
+        low = _mm_loadu_si128((const __m128i *)(data + i + 1));
+        high = _mm_loadu_si128((const __m128i *)(data + i + 2));
+
+        is_rts = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, rts));
+        is_jmp = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bytes, fold), jmp));
+        if ((is_rts | is_jmp) == 0)
+        {
+            continue;
+        }
+
+        is_end = is_rts;
+        if (is_jmp != 0)
+        {
+            if (span >= MEMORY_SIZE)
+            {
+                is_end |= is_jmp;
+            }
+            else
+            {
+                in_range = _mm_packs_epi16(
+                    _mm_cmplt_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(low, high), start), limit),
+                    _mm_cmplt_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(low, high), start), limit));
+                is_end |= is_jmp & _mm_movemask_epi8(in_range);
+            }
+        }
+
+        // i is a multiple of 16, so the 16 bits never straddle a word
+        jumps[i >> 6] |= (unsigned long long)is_jmp << (i & 63);
+        ends[i >> 6] |= (unsigned long long)is_end << (i & 63);
+    }
+
+    return i;
+}
+
+/* =============================================================================
+ * int scan_avx2(const disass_context *ctx, unsigned long long *ends,
+ *      unsigned long long *jumps)
+ *
+ * return i; // first offset left for scan_scalar()
+ *
+ * like scan_sse2(). unpack and pack both work per 128 bit lane, so the words
+ * come out of the pack in the order of the bytes again.
+ * =============================================================================
+ */
+__attribute__((target("avx2")))
+static int scan_avx2(const disass_context *ctx, unsigned long long *ends,
+    unsigned long long *jumps)
+{
+    const unsigned char *data   = ctx->assembly.data;
+    int                 span    = ctx->pc_end - ctx->pc_start;
+    __m256i             rts     = _mm256_set1_epi8(0x60);
+    __m256i             jmp     = _mm256_set1_epi8(0x4C);
+    __m256i             fold    = _mm256_set1_epi8((char)0xDF);
+    __m256i             start   = _mm256_set1_epi16((short)(ctx->pc_start + 0x8000));
+    __m256i             limit   = _mm256_set1_epi16((short)(span - 0x8000));
+    __m256i             bytes;
+    __m256i             low;
+    __m256i             high;
+    __m256i             in_range;
+    unsigned int        is_rts;
+    unsigned int        is_jmp;
+    unsigned int        is_end;
+    int                 i;
+
+    for (i = 0; i + 2 + 32 <= ctx->assembly.length; i += 32)
+    {
+        bytes = _mm256_loadu_si256((const __m256i *)(data + i));
+        low = _mm256_loadu_si256((const __m256i *)(data + i + 1));
+        high = _mm256_loadu_si256((const __m256i *)(data + i + 2));
+
+        is_rts = _mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, rts));
+        is_jmp = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(bytes, fold), jmp));
+        if ((is_rts | is_jmp) == 0)
+        {
+            continue;
+        }
+
+        is_end = is_rts;
+        if (is_jmp != 0)
+        {
+            if (span >= MEMORY_SIZE)
+            {
+                is_end |= is_jmp;
+            }
+            else
+            {
+                // limit > address - pc_start, cmpgt is the only signed compare
+                in_range = _mm256_packs_epi16(
+                    _mm256_cmpgt_epi16(limit, _mm256_sub_epi16(_mm256_unpacklo_epi8(low, high), start)),
+                    _mm256_cmpgt_epi16(limit, _mm256_sub_epi16(_mm256_unpackhi_epi8(low, high), start)));
+                is_end |= is_jmp & _mm256_movemask_epi8(in_range);
+            }
+        }
+
+        jumps[i >> 6] |= (unsigned long long)is_jmp << (i & 63);
+        ends[i >> 6] |= (unsigned long long)is_end << (i & 63);
+    }
+
+    return i;
+}
+
+#endif // SCAN_X86
+
+/* =============================================================================
+ * int best_scan_level()
+ *
+ * return level; // the fastest implementation this CPU can run
+ * =============================================================================
+ */
+int best_scan_level()
+{
+#ifdef SCAN_X86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SCAN_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return SCAN_SSE2;
+    }
+#endif
+    return SCAN_SCALAR;
+}
+
+/* =============================================================================
+ * void scan_terminators(const disass_context *ctx, unsigned long long *ends,
+ *      unsigned long long *jumps, int level)
+ *
+ * fill the SCAN_WORDS masks ends and jumps, see above. bit n of a mask is
+ * bit (n & 63) of word n / 64 and stands for address pc_start + n. level
+ * should come from best_scan_level().
+ * =============================================================================
+ */
+void scan_terminators(const disass_context *ctx, unsigned long long *ends,
+    unsigned long long *jumps, int level)
+{
+    int i = 0;
+
+    memset(ends, 0, SCAN_WORDS * sizeof(unsigned long long));
+    memset(jumps, 0, SCAN_WORDS * sizeof(unsigned long long));
+
+#ifdef SCAN_X86
+    if (level == SCAN_AVX2)
+    {
+        i = scan_avx2(ctx, ends, jumps);
+    }
+    else if (level == SCAN_SSE2)
+    {
+        i = scan_sse2(ctx, ends, jumps);
+    }
+#else
+    (void)level;
+#endif
+
+    scan_scalar(ctx, ends, jumps, i);
+}
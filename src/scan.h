@@ -0,0 +1,18 @@
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include "disass.h"
+
+#define SCAN_WORDS      ((MEMORY_SIZE + 63) / 64)   // of a mask, one bit per byte
+
+enum {
+    SCAN_SCALAR,
+    SCAN_SSE2,
+    SCAN_AVX2
+}; // implementations of scan_terminators(), see best_scan_level()
+
+int best_scan_level();
+void scan_terminators(const disass_context *ctx, unsigned long long *ends,
+    unsigned long long *jumps, int level);
+
+#endif // SCAN_H_
@@ -0,0 +1,478 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "signature.h"
+
+/* =============================================================================
+ * signature database
+ *
+ * a text file with one known routine or table per line, comments start with
+ * ';' or '#':
+ *
+ *      name    code|data   pattern
+ *
+ *      sid_init    code    a2 18 a9 00 9d 00 d4 ca 10 fa
+ *      loader_irq  code    78 a9 ?? 8d 14 03 a9 ?? 8d 15 03
+ *
+ * the pattern is given as hex bytes, '??' matches any byte, e.g. the operands
+ * of relocated code. every match adds a label with the name (name_2, name_3
+ * ... for further matches) and makes the bytes code or data like the
+ * annotation file would.
+ *
+ * the longest run of each pattern without wildcards (at most ANCHOR_MAX
+ * bytes) goes into one Aho-Corasick automaton with a complete transition
+ * table, so the data is read once no matter how many signatures there are.
+ * only where an anchor is found the rest of its pattern is compared.
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * int add_state(signature_db *db)
+ *
+ * return state; // a new state without transitions or signatures
+ * =============================================================================
+ */
+static int add_state(signature_db *db)
+{
+    int         new_size;
+
+    if (db->states_count == db->states_size)
+    {
+        new_size = db->states_size ? db->states_size * 2 : 0x100;
+        db->states = realloc(db->states, new_size * 256 * sizeof(int));
+        db->first = realloc(db->first, new_size * sizeof(int));
+        db->output = realloc(db->output, new_size * sizeof(int));
+        if (db->states == NULL || db->first == NULL || db->output == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        db->states_size = new_size;
+    }
+
+    memset(db->states + db->states_count * 256, 0, 256 * sizeof(int));
+    db->first[db->states_count] = -1;
+    db->output[db->states_count] = 0;
+
+    return db->states_count++;
+}
+
+/* =============================================================================
+ * void build_automaton(signature_db *db)
+ *
+ * the trie of all anchors, then the failure links in breadth first order.
+ * every missing transition is replaced by the one of the failure state, so
+ * matching never has to follow a failure link.
+ * =============================================================================
+ */
+static void build_automaton(signature_db *db)
+{
+    signature   *sig;
+    int         *fail;
+    int         *queue;
+    int         head            = 0;
+    int         tail            = 0;
+    int         state;
+    int         child;
+    int         c;
+    int         i;
+    int         j;
+
+    add_state(db);
+
+    for (i = 0; i < db->count; i++)
+    {
+        sig = &db->signatures[i];
+        state = 0;
+
+        for (j = sig->anchor; j < sig->anchor + sig->anchor_length; j++)
+        {
+            // state 0 is never a child, so it marks a missing transition
+            if (db->states[state * 256 + sig->bytes[j]] == 0)
+            {
+                child = add_state(db);
+                db->states[state * 256 + sig->bytes[j]] = child;
+            }
+            state = db->states[state * 256 + sig->bytes[j]];
+        }
+
+        sig->next = db->first[state];
+        db->first[state] = i;
+    }
+
+    fail = calloc(db->states_count, sizeof(int));
+    queue = malloc(db->states_count * sizeof(int));
+    if (fail == NULL || queue == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (c = 0; c < 256; c++)
+    {
+        if (db->states[c] != 0)
+        {
+            queue[tail++] = db->states[c];
+        }
+    }
+
+    while (head < tail)
+    {
+        state = queue[head++];
+
+        for (c = 0; c < 256; c++)
+        {
+            child = db->states[state * 256 + c];
+            if (child == 0)
+            {
+                db->states[state * 256 + c] = db->states[fail[state] * 256 + c];
+                continue;
+            }
+
+            fail[child] = db->states[fail[state] * 256 + c];
+            db->output[child] = (db->first[fail[child]] >= 0) ? fail[child] : db->output[fail[child]];
+            queue[tail++] = child;
+        }
+    }
+
+    free(queue);
+    free(fail);
+}
+
+/* =============================================================================
+ * int compare_matches(const void *a, const void *b)
+ *
+ * qsort() helper, by address and the longest match first
+ * =============================================================================
+ */
+static int compare_matches(const void *a, const void *b)
+{
+    const datablock *match_a    = a;
+    const datablock *match_b    = b;
+
+    if (match_a->pc_start != match_b->pc_start)
+    {
+        return match_a->pc_start - match_b->pc_start;
+    }
+
+    return match_b->pc_end - match_a->pc_end;
+}
+
+/* =============================================================================
+ * int parse_pattern(signature *sig, char *text)
+ *
+ * return 0;  // on success
+ * return -1; // if text isn't a valid pattern
+ * =============================================================================
+ */
+static int parse_pattern(signature *sig, char *text)
+{
+    char            *token;
+    char            *end;
+    int             run         = 0;
+    int             i;
+
+    sig->length = 0;
+    sig->anchor_length = 0;
+
+    for (token = strtok(text, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n"))
+    {
+        if (sig->length == SIGNATURE_MAX || strlen(token) != 2)
+        {
+            return -1;
+        }
+
+        if (strcmp(token, "??") == 0)
+        {
+            sig->bytes[sig->length] = 0x00;
+            sig->mask[sig->length] = 0x00;
+        }
+        else
+        {
+            sig->bytes[sig->length] = strtoul(token, &end, 16);
+            sig->mask[sig->length] = 0xFF;
+            if (*end != '\0')
+            {
+                return -1;
+            }
+        }
+        sig->length++;
+    }
+
+    // the longest run of fixed bytes
+    for (i = 0; i <= sig->length; i++)
+    {
+        if (i < sig->length && sig->mask[i] != 0x00)
+        {
+            run++;
+            continue;
+        }
+
+        if (run > sig->anchor_length)
+        {
+            sig->anchor = i - run;
+            sig->anchor_length = run;
+        }
+        run = 0;
+    }
+
+    if (sig->anchor_length > ANCHOR_MAX)
+    {
+        sig->anchor_length = ANCHOR_MAX;
+    }
+
+    return (sig->anchor_length > 0) ? 0 : -1;
+}
+
+/* =============================================================================
+ * void free_signatures(signature_db *db)
+ * =============================================================================
+ */
+void free_signatures(signature_db *db)
+{
+    int i;
+
+    for (i = 0; i < db->count; i++)
+    {
+        free(db->signatures[i].name);
+    }
+    free(db->signatures);
+    free(db->states);
+    free(db->first);
+    free(db->output);
+
+    memset(db, 0, sizeof(signature_db));
+}
+
+/* =============================================================================
+ * int load_signatures(signature_db *db, const char *filename)
+ *
+ * return 0;    // on success
+ * return -1;   // if filename couldn't be read
+ * return line; // number of the first line that couldn't be parsed
+ *
+ * read the signature file, see above. db is left empty on errors.
+ * =============================================================================
+ */
+int load_signatures(signature_db *db, const char *filename)
+{
+    FILE            *file;
+    signature       *sig;
+    char            line[1024];
+    char            name[256];
+    char            type[16];
+    char            *comment;
+    int             offset;
+    int             line_number     = 0;
+    int             result          = 0;
+
+    memset(db, 0, sizeof(signature_db));
+
+    file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    while (result == 0 && fgets(line, sizeof(line), file) != NULL)
+    {
+        line_number++;
+
+        comment = strpbrk(line, ";#");
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+
+        if (sscanf(line, "%255s", name) != 1)
+        {
+            continue;
+        }
+
+        if (db->count == db->size)
+        {
+            db->size = db->size ? db->size * 2 : 0x40;
+            db->signatures = realloc(db->signatures, db->size * sizeof(signature));
+            if (db->signatures == NULL)
+            {
+                printf("\nError: out of memory.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        sig = &db->signatures[db->count];
+
+        if (sscanf(line, "%255s %15s %n", name, type, &offset) != 2
+            || !is_label_name(name)
+            || (strcmp(type, "code") != 0 && strcmp(type, "data") != 0)
+            || parse_pattern(sig, line + offset) != 0)
+        {
+            result = line_number;
+            continue;
+        }
+
+        sig->type = (type[0] == 'c') ? DATATYPE_CODE : DATATYPE_DATA;
+        sig->name = strdup(name);
+        if (sig->name == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        db->count++;
+    }
+
+    fclose(file);
+
+    if (result != 0)
+    {
+        free_signatures(db);
+        return result;
+    }
+
+    build_automaton(db);
+
+    return 0;
+}
+
+/* =============================================================================
+ * int match_signatures(disass_context *ctx, annotations *notes)
+ *
+ * return count; // of signatures found in the data loaded into ctx
+ *
+ * notes gets a label and a range for every match, overlapping matches are
+ * dropped in favour of the one that starts first / is longer. the contents
+ * of ctx->notes follow, so the annotation file has the last word. notes is
+ * left empty if nothing was found.
+ * =============================================================================
+ */
+int match_signatures(disass_context *ctx, annotations *notes)
+{
+    const signature_db  *db         = ctx->signatures;
+    const signature     *sig;
+    const unsigned char *data       = ctx->assembly.data;
+    block_list          matches;
+    datablock           match;
+    char                name[300];
+    int                 *found;
+    int                 start       = 0;
+    int                 end         = 0;
+    int                 state       = 0;
+    int                 count       = 0;
+    int                 s;
+    int                 i;
+    int                 j;
+    int                 k;
+
+    memset(notes, 0, sizeof(annotations));
+    memset(&matches, 0, sizeof(matches));
+
+    // never in the BASIC stub
+    if (ctx->basic_end > ctx->pc_start)
+    {
+        start = ctx->basic_end - ctx->pc_start;
+    }
+
+    for (i = start; i < ctx->assembly.length; i++)
+    {
+        state = db->states[state * 256 + data[i]];
+
+        s = (db->first[state] >= 0) ? state : db->output[state];
+        for (; s != 0; s = db->output[s])
+        {
+            for (k = db->first[s]; k >= 0; k = db->signatures[k].next)
+            {
+                sig = &db->signatures[k];
+                j = i + 1 - sig->anchor_length - sig->anchor;
+                if (j < start || j + sig->length > ctx->assembly.length)
+                {
+                    continue;
+                }
+
+                for (end = 0; end < sig->length; end++)
+                {
+                    if ((data[j + end] & sig->mask[end]) != sig->bytes[end])
+                    {
+                        break;
+                    }
+                }
+
+                // the type is the number of the signature here
+                if (end == sig->length)
+                {
+                    match.pc_start = j;
+                    match.pc_end = j + sig->length;
+                    match.type = k;
+                    append_block(&matches, match);
+                }
+            }
+        }
+    }
+
+    if (matches.count == 0)
+    {
+        return 0;
+    }
+
+    qsort(matches.blocks, matches.count, sizeof(datablock), compare_matches);
+
+    found = calloc(db->count, sizeof(int));
+    if (found == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0, end = 0; i < matches.count; i++)
+    {
+        if (matches.blocks[i].pc_start < end)
+        {
+            continue;
+        }
+        end = matches.blocks[i].pc_end;
+
+        sig = &db->signatures[matches.blocks[i].type];
+        if (found[matches.blocks[i].type]++ == 0)
+        {
+            snprintf(name, sizeof(name), "%s", sig->name);
+        }
+        else
+        {
+            snprintf(name, sizeof(name), "%s_%d", sig->name, found[matches.blocks[i].type]);
+        }
+
+        match.pc_start = ctx->pc_start + matches.blocks[i].pc_start;
+        match.pc_end = ctx->pc_start + matches.blocks[i].pc_end - 1;
+        match.type = sig->type;
+        append_block(&notes->ranges, match);
+        if (sig->type == DATATYPE_CODE)
+        {
+            append_address(&notes->entries, match.pc_start);
+        }
+
+        // line 0, every name from the annotation file wins
+        add_label_name(notes, match.pc_start, 0, name);
+        count++;
+    }
+
+    if (ctx->notes != NULL)
+    {
+        for (i = 0; i < ctx->notes->ranges.count; i++)
+        {
+            append_block(&notes->ranges, ctx->notes->ranges.blocks[i]);
+        }
+        for (i = 0; i < ctx->notes->entries.count; i++)
+        {
+            append_address(&notes->entries, ctx->notes->entries.addresses[i]);
+        }
+        for (i = 0; i < ctx->notes->labels_count; i++)
+        {
+            add_label_name(notes, ctx->notes->labels[i].pc, ctx->notes->labels[i].line,
+                ctx->notes->labels[i].name);
+        }
+    }
+    sort_label_names(notes);
+
+    free(found);
+    free(matches.blocks);
+
+    return count;
+}
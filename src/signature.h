@@ -0,0 +1,45 @@
+#ifndef SIGNATURE_H_
+#define SIGNATURE_H_
+
+#include "disass.h"
+#include "project.h"
+
+#define SIGNATURE_MAX   256         // bytes per pattern
+#define ANCHOR_MAX      16          // bytes of a pattern in the automaton
+
+/* one known routine or table. the anchor is the longest run of the pattern
+ * without wildcards, only that goes into the automaton.
+ */
+typedef struct
+{
+    char            *name;
+    int             type;           // DATATYPE_CODE or DATATYPE_DATA
+    unsigned char   bytes[SIGNATURE_MAX];
+    unsigned char   mask[SIGNATURE_MAX];    // 0x00: wildcard, 0xFF: has to match
+    int             length;
+    int             anchor;         // offset of the anchor in bytes
+    int             anchor_length;
+    int             next;           // next signature with the same anchor, -1
+} signature;
+
+/* a signature file compiled into an Aho-Corasick automaton, see
+ * load_signatures(). read-only once loaded, so any number of contexts can
+ * share it via ctx->signatures.
+ */
+struct signature_db
+{
+    signature       *signatures;
+    int             count;
+    int             size;
+    int             *states;        // 256 transitions per state, state 0 is the root
+    int             *first;         // per state: first signature whose anchor ends there, -1
+    int             *output;        // per state: longest suffix state with signatures, 0 if none
+    int             states_count;
+    int             states_size;
+};
+
+void free_signatures(signature_db *db);
+int load_signatures(signature_db *db, const char *filename);
+int match_signatures(disass_context *ctx, annotations *notes);
+
+#endif // SIGNATURE_H_
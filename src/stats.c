@@ -0,0 +1,169 @@
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "stats.h"
+
+static const char *phase_names[STATS_PHASES] = {
+    "read",
+    "cache",
+    "analysis",
+    "datablocks",
+    "labelmap",
+    "index",
+    "print"
+};
+
+/* =============================================================================
+ * void add_stats(run_stats *total, const run_stats *stats)
+ *
+ * add everything in stats to total, apart from the mark
+ * =============================================================================
+ */
+void add_stats(run_stats *total, const run_stats *stats)
+{
+    int i;
+
+    for (i = 0; i < STATS_PHASES; i++)
+    {
+        total->phases[i].wall += stats->phases[i].wall;
+        total->phases[i].cpu += stats->phases[i].cpu;
+    }
+
+    total->files += stats->files;
+    total->failed += stats->failed;
+    total->cache_hits += stats->cache_hits;
+    total->bytes += stats->bytes;
+    total->instructions += stats->instructions;
+    total->code_blocks += stats->code_blocks;
+    total->data_blocks += stats->data_blocks;
+    total->output_bytes += stats->output_bytes;
+}
+
+/* =============================================================================
+ * void end_phase(run_stats *stats, int phase)
+ *
+ * add the time since the end of the last phase to phase, nothing if stats is
+ * NULL
+ * =============================================================================
+ */
+void end_phase(run_stats *stats, int phase)
+{
+    stats_clock now;
+
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    read_clock(&now, 0);
+    stats->phases[phase].wall += now.wall - stats->mark.wall;
+    stats->phases[phase].cpu += now.cpu - stats->mark.cpu;
+    stats->mark = now;
+}
+
+/* =============================================================================
+ * long peak_memory()
+ *
+ * return kb; // the largest resident set of the process so far
+ * =============================================================================
+ */
+long peak_memory()
+{
+    struct rusage   usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+
+    return usage.ru_maxrss;
+}
+
+/* =============================================================================
+ * void print_json_string(FILE *file, const char *string)
+ *
+ * string in double quotes, with '"', '\' and control characters escaped
+ * =============================================================================
+ */
+void print_json_string(FILE *file, const char *string)
+{
+    const unsigned char *c;
+
+    fputc('"', file);
+
+    for (c = (const unsigned char *)string; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fprintf(file, "\\%c", *c);
+        }
+        else if (*c < 0x20)
+        {
+            fprintf(file, "\\u%04x", *c);
+        }
+        else
+        {
+            fputc(*c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+/* =============================================================================
+ * void print_stats(FILE *file, const run_stats *stats)
+ *
+ * stats as one JSON object on a single line, times in seconds
+ * =============================================================================
+ */
+void print_stats(FILE *file, const run_stats *stats)
+{
+    int i;
+
+    fprintf(file, "{\"files\": %ld, \"failed\": %ld, \"cache_hits\": %ld, "
+        "\"bytes\": %lld, \"instructions\": %lld, \"code_blocks\": %lld, "
+        "\"data_blocks\": %lld, \"output_bytes\": %lld, \"phases\": {",
+        stats->files, stats->failed, stats->cache_hits, stats->bytes,
+        stats->instructions, stats->code_blocks, stats->data_blocks,
+        stats->output_bytes);
+
+    for (i = 0; i < STATS_PHASES; i++)
+    {
+        fprintf(file, "%s\"%s\": {\"wall\": %.6f, \"cpu\": %.6f}", i ? ", " : "",
+            phase_names[i], stats->phases[i].wall, stats->phases[i].cpu);
+    }
+
+    fprintf(file, "}}");
+}
+
+/* =============================================================================
+ * void read_clock(stats_clock *clock, int process)
+ *
+ * the time now, CPU time of the calling thread or with process != 0 of the
+ * whole process
+ * =============================================================================
+ */
+void read_clock(stats_clock *clock, int process)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    clock->wall = ts.tv_sec + ts.tv_nsec / 1e9;
+
+    clock_gettime(process ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_THREAD_CPUTIME_ID, &ts);
+    clock->cpu = ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* =============================================================================
+ * void start_stats(run_stats *stats)
+ *
+ * a new file starts to be read, nothing if stats is NULL
+ * =============================================================================
+ */
+void start_stats(run_stats *stats)
+{
+    if (stats != NULL)
+    {
+        read_clock(&stats->mark, 0);
+    }
+}
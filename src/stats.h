@@ -0,0 +1,53 @@
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdio.h>
+#include "disass.h"
+
+enum {
+    STATS_READ,         // everything up to disassemble(): reading, loading, unpacking
+    STATS_CACHE,        // hash_context() and cache_lookup()
+    STATS_ANALYSIS,     // signatures, datamap or flowmap and annotations
+    STATS_DATABLOCKS,   // fill_datablocks()
+    STATS_LABELMAP,     // create_labelmap()
+    STATS_INDEX,        // build_xref() and summarize_file()
+    STATS_PRINT,        // print_disassembly(), cache_store() and flush_output()
+    STATS_PHASES
+};
+
+/* wall clock and CPU time in seconds, the CPU time is that of the calling
+ * thread or of the whole process, see read_clock()
+ */
+typedef struct
+{
+    double          wall;
+    double          cpu;
+} stats_clock;
+
+/* what went into one or more files, see ctx->stats. start_stats() when a file
+ * starts to be read, disassemble() adds the rest. only ever used by one
+ * thread, add_stats() to sum up the ones of several.
+ */
+struct run_stats
+{
+    stats_clock     phases[STATS_PHASES];
+    stats_clock     mark;           // end of the last phase, see end_phase()
+    long            files;          // disassembled, cache hits included
+    long            failed;         // not even read, counted by the caller
+    long            cache_hits;
+    long long       bytes;          // loaded, i.e. decoded
+    long long       instructions;   // printed
+    long long       code_blocks;
+    long long       data_blocks;
+    long long       output_bytes;
+};
+
+void add_stats(run_stats *total, const run_stats *stats);
+void end_phase(run_stats *stats, int phase);
+long peak_memory();
+void print_json_string(FILE *file, const char *string);
+void print_stats(FILE *file, const run_stats *stats);
+void read_clock(stats_clock *clock, int process);
+void start_stats(run_stats *stats);
+
+#endif // STATS_H_
@@ -0,0 +1,389 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "listing.h"
+#include "timing.h"
+
+/* =============================================================================
+ * cycle timing
+ *
+ * what each instruction, straight-line block and loop of a listing costs, for
+ * --cycles. nothing is run, so whatever depends on the registers is a range:
+ *
+ *      abs,x / abs,y / (zp),y reads    +1 if the index crosses a page, which
+ *                                      it can't for abs,x of $xx00
+ *      branches                        2 not taken, 3 taken, 4 taken into
+ *                                      another page
+ *
+ * writes and read-modify-write instructions always take the extra cycle, it's
+ * in opcodes[] already, the same rule as in the emulator. jsr counts its own
+ * 6 cycles, not those of the subroutine.
+ *
+ * a block starts at a label, the target of a branch or jmp or after a branch,
+ * jmp, rts, rti or jam and ends with the next one or with data. a loop is a
+ * branch or jmp back to an instruction of the same run of code. one iteration
+ * is a path from there to the branch back that stays in the loop: branches
+ * inside are taken forward or not at all, so an inner loop counts with a
+ * single pass. all those edges point forward, one walk over the body finds
+ * the shortest and longest path.
+ * =============================================================================
+ */
+
+/* =============================================================================
+ * void append_span(span_list *list, int type, int pc_start, int pc_end, int min, int max)
+ *
+ * add a span to the end of list, list grows as needed
+ * =============================================================================
+ */
+static void append_span(span_list *list, int type, int pc_start, int pc_end, int min, int max)
+{
+    cycle_span  *new_spans;
+    cycle_span  *span;
+    int         new_size;
+
+    if (list->count == list->size)
+    {
+        new_size = list->size ? list->size * 2 : 0x100;
+        new_spans = realloc(list->spans, new_size * sizeof(cycle_span));
+        if (new_spans == NULL)
+        {
+            printf("\nError: out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        list->spans = new_spans;
+        list->size = new_size;
+    }
+
+    span = &list->spans[list->count];
+    span->pc_start = pc_start;
+    span->pc_end = pc_end;
+    span->type = type;
+    span->min = min;
+    span->max = max;
+    list->count++;
+}
+
+/* =============================================================================
+ * int compare_spans(const void *a, const void *b)
+ *
+ * qsort() helper, by pc_start, loops first and the outer one first
+ * =============================================================================
+ */
+static int compare_spans(const void *a, const void *b)
+{
+    const cycle_span *x = a;
+    const cycle_span *y = b;
+
+    if (x->pc_start != y->pc_start)
+    {
+        return x->pc_start - y->pc_start;
+    }
+    if (x->type != y->type)
+    {
+        return y->type - x->type;
+    }
+
+    return y->pc_end - x->pc_end;
+}
+
+/* =============================================================================
+ * int find_instruction(const listing *list, const int *run, int count, int pc)
+ *
+ * return i;    // list->lines[run[i]] is the instruction at pc
+ * return -1;   // if no instruction of run starts at pc
+ * =============================================================================
+ */
+static int find_instruction(const listing *list, const int *run, int count, int pc)
+{
+    int low     = 0;
+    int high    = count - 1;
+    int middle;
+
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+
+        if (list->lines[run[middle]].pc == pc)
+        {
+            return middle;
+        }
+        if (list->lines[run[middle]].pc < pc)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle - 1;
+        }
+    }
+
+    return -1;
+}
+
+/* =============================================================================
+ * void relax(int *min, int *max, int i, int j, int cost_min, int cost_max)
+ *
+ * shortest and longest path to j, if going there from i is shorter / longer
+ * =============================================================================
+ */
+static inline void relax(int *min, int *max, int i, int j, int cost_min, int cost_max)
+{
+    if (min[i] + cost_min < min[j])
+    {
+        min[j] = min[i] + cost_min;
+    }
+    if (max[i] + cost_max > max[j])
+    {
+        max[j] = max[i] + cost_max;
+    }
+}
+
+/* =============================================================================
+ * int taken_cycles(const disass_context *ctx, const listing_line *line)
+ *
+ * return cycles; // of the branch or jmp in line if it jumps
+ * =============================================================================
+ */
+static int taken_cycles(const disass_context *ctx, const listing_line *line)
+{
+    if (opcodes[get_byte(ctx, line->pc - ctx->pc_start)].addressing_mode != REL)
+    {
+        return 3;
+    }
+
+    return (((line->pc + 2) ^ line->value) & 0xFF00) ? 4 : 3;
+}
+
+/* =============================================================================
+ * void list_blocks(disass_context *ctx, const listing *list, const int *run, int count,
+ *      int *starts)
+ *
+ * add the blocks of the instructions list->lines[run[0 .. count-1]] to
+ * ctx->timings, apart from those of a single instruction. starts needs room
+ * for count flags.
+ * =============================================================================
+ */
+static void list_blocks(disass_context *ctx, const listing *list, const int *run, int count,
+    int *starts)
+{
+    const listing_line  *line;
+    int                 start       = 0;
+    int                 min         = 0;
+    int                 max         = 0;
+    int                 cycles_min;
+    int                 cycles_max;
+    int                 op;
+    int                 i;
+    int                 j;
+
+    // a label or the target of a branch / jmp of the run starts a block
+    for (i = 0; i < count; i++)
+    {
+        starts[i] = is_label(ctx, list->lines[run[i]].pc);
+    }
+    for (i = 0; i < count; i++)
+    {
+        line = &list->lines[run[i]];
+        op = get_byte(ctx, line->pc - ctx->pc_start);
+
+        if ((opcodes[op].addressing_mode == REL || op == 0x4C)
+            && (j = find_instruction(list, run, count, line->value)) >= 0)
+        {
+            starts[j] = 1;
+        }
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        line = &list->lines[run[i]];
+        op = get_byte(ctx, line->pc - ctx->pc_start);
+
+        if (i > start && starts[i])
+        {
+            if (i - start > 1)
+            {
+                append_span(&ctx->timings, TIMING_BLOCK, list->lines[run[start]].pc, line->pc,
+                    min, max);
+            }
+            start = i;
+            min = 0;
+            max = 0;
+        }
+
+        instruction_cycles(ctx, line, &cycles_min, &cycles_max);
+        min += cycles_min;
+        max += cycles_max;
+
+        if (opcodes[op].addressing_mode == REL || is_flow_end(op) || i == count - 1)
+        {
+            if (i - start > 0)
+            {
+                append_span(&ctx->timings, TIMING_BLOCK, list->lines[run[start]].pc,
+                    line->pc + line->count, min, max);
+            }
+            start = i + 1;
+            min = 0;
+            max = 0;
+        }
+    }
+}
+
+/* =============================================================================
+ * void list_loops(disass_context *ctx, const listing *list, const int *run, int count,
+ *      int *min, int *max)
+ *
+ * add the loops of the instructions list->lines[run[0 .. count-1]] to
+ * ctx->timings. min and max need room for count paths.
+ * =============================================================================
+ */
+static void list_loops(disass_context *ctx, const listing *list, const int *run, int count,
+    int *min, int *max)
+{
+    const listing_line  *back;
+    const listing_line  *line;
+    int                 cycles_min;
+    int                 cycles_max;
+    int                 op;
+    int                 i;
+    int                 j;
+    int                 k;
+    int                 s;
+
+    for (k = 0; k < count; k++)
+    {
+        back = &list->lines[run[k]];
+        op = get_byte(ctx, back->pc - ctx->pc_start);
+
+        if ((opcodes[op].addressing_mode != REL && op != 0x4C) || back->value > back->pc
+            || (s = find_instruction(list, run, count, back->value)) < 0)
+        {
+            continue;
+        }
+
+        for (i = s; i <= k; i++)
+        {
+            min[i] = INT_MAX;
+            max[i] = -1;
+        }
+        min[s] = 0;
+        max[s] = 0;
+
+        for (i = s; i < k; i++)
+        {
+            if (max[i] < 0)
+            {
+                continue;   // only reachable from outside the loop
+            }
+
+            line = &list->lines[run[i]];
+            op = get_byte(ctx, line->pc - ctx->pc_start);
+
+            // a jump back or out of the loop is never taken on this path
+            if ((opcodes[op].addressing_mode == REL || op == 0x4C)
+                && line->value > line->pc && line->value <= back->pc
+                && (j = find_instruction(list, run, count, line->value)) >= 0)
+            {
+                relax(min, max, i, j, taken_cycles(ctx, line), taken_cycles(ctx, line));
+            }
+
+            if (opcodes[op].addressing_mode == REL)
+            {
+                relax(min, max, i, i + 1, 2, 2);
+            }
+            else if (!is_flow_end(op))
+            {
+                instruction_cycles(ctx, line, &cycles_min, &cycles_max);
+                relax(min, max, i, i + 1, cycles_min, cycles_max);
+            }
+        }
+
+        if (max[k] >= 0)
+        {
+            append_span(&ctx->timings, TIMING_LOOP, back->value, back->pc + back->count,
+                min[k] + taken_cycles(ctx, back), max[k] + taken_cycles(ctx, back));
+        }
+    }
+}
+
+/* =============================================================================
+ * void analyse_timing(disass_context *ctx, const listing *list)
+ *
+ * fill ctx->timings with the blocks and loops of list, see above
+ * =============================================================================
+ */
+void analyse_timing(disass_context *ctx, const listing *list)
+{
+    int *run;
+    int count   = 0;
+    int i;
+
+    ctx->timings.count = 0;
+    if (list->count == 0)
+    {
+        return;
+    }
+
+    // the instructions of one run of code, then two paths per instruction
+    run = malloc(list->count * 3 * sizeof(int));
+    if (run == NULL)
+    {
+        printf("\nError: out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (i = 0; i <= list->count; i++)
+    {
+        if (i < list->count && list->lines[i].type == LINE_INSTRUCTION)
+        {
+            run[count++] = i;
+        }
+        else if ((i == list->count || list->lines[i].type != LINE_LABEL) && count > 0)
+        {
+            // labels don't end a run, data does
+            list_blocks(ctx, list, run, count, run + list->count);
+            list_loops(ctx, list, run, count, run + list->count, run + 2 * list->count);
+            count = 0;
+        }
+    }
+
+    free(run);
+    if (ctx->timings.count > 0)
+    {
+        qsort(ctx->timings.spans, ctx->timings.count, sizeof(cycle_span), compare_spans);
+    }
+}
+
+/* =============================================================================
+ * void instruction_cycles(const disass_context *ctx, const listing_line *line,
+ *      int *min, int *max)
+ *
+ * the fewest and most cycles the instruction in line can take, see above
+ * =============================================================================
+ */
+void instruction_cycles(const disass_context *ctx, const listing_line *line, int *min, int *max)
+{
+    const opcode *op = &opcodes[get_byte(ctx, line->pc - ctx->pc_start)];
+
+    *min = op->cycles;
+    *max = op->cycles;
+
+    switch (op->addressing_mode)
+    {
+    case ABSX:
+    case ABSY:
+        if (op->cycles < 5 && (line->value & 0xFF) != 0)
+        {
+            (*max)++;
+        }
+        break;
+    case INDY:
+        if (op->cycles < 6)
+        {
+            (*max)++;
+        }
+        break;
+    case REL:
+        *max = taken_cycles(ctx, line);
+        break;
+    }
+}
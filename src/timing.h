@@ -0,0 +1,14 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include "disass.h"
+
+enum {
+    TIMING_BLOCK,
+    TIMING_LOOP
+}; // cycle_span.type
+
+void analyse_timing(disass_context *ctx, const listing *list);
+void instruction_cycles(const disass_context *ctx, const listing_line *line, int *min, int *max);
+
+#endif // TIMING_H_
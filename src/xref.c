@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xref.h"
+
+/* =============================================================================
+ * cross reference index
+ *
+ * build_xref() walks the code exactly like print_disassembly() does and notes
+ * the operand address of every instruction that touches memory. the records
+ * are then put in order of target with a counting sort, which keeps them in
+ * order of pc for each target. an index file is
+ *
+ *      +0  XREF_MAGIC
+ *      +8  number of records, 4 bytes (lo first)
+ *      +12 the records, XREF_RECORD bytes each
+ *
+ * so a loaded file is searched in place without parsing anything.
+ * =============================================================================
+ */
+
+#define XREF_MAGIC      "ADXREF1\0"
+#define XREF_HEADER     12
+
+/* =============================================================================
+ * int access_kind(const opcode *op)
+ *
+ * return XREF_READ | XREF_WRITE | ...; // what op does with its operand address
+ * return 0;                            // if it has none
+ *
+ * jmp (ind) reads the vector, (zp),y and (zp,x) read the pointer
+ * =============================================================================
+ */
+static int access_kind(const opcode *op)
+{
+    static const char   *writes[]   = { "sta", "stx", "sty", "sax", "sha", "shs", "shx", "shy" };
+    static const char   *modifies[] = { "asl", "lsr", "rol", "ror", "inc", "dec",
+                                        "slo", "rla", "sre", "rra", "dcp", "isb" };
+    unsigned int        i;
+
+    switch (op->addressing_mode)
+    {
+    case ZP:
+    case ZPX:
+    case ZPY:
+    case ABS:
+    case ABSX:
+    case ABSY:
+        break;
+    case ABSI:
+    case INDX:
+    case INDY:
+        return XREF_READ;
+    case REL:
+        return XREF_JUMP;
+    default:
+        return 0;
+    }
+
+    if (strcmp(op->name, "jsr") == 0)
+    {
+        return XREF_CALL;
+    }
+    if (strcmp(op->name, "jmp") == 0)
+    {
+        return XREF_JUMP;
+    }
+    for (i = 0; i < sizeof(writes) / sizeof(writes[0]); i++)
+    {
+        if (strcmp(op->name, writes[i]) == 0)
+        {
+            return XREF_WRITE;
+        }
+    }
+    for (i = 0; i < sizeof(modifies) / sizeof(modifies[0]); i++)
+    {
+        if (strcmp(op->name, modifies[i]) == 0)
+        {
+            return XREF_READ | XREF_WRITE;
+        }
+    }
+
+    return XREF_READ;
+}
+
+/* =============================================================================
+ * void build_xref(disass_context *ctx, xref_index *xref)
+ *
+ * replace the records of xref with the references of the code in ctx, the
+ * datamap must be complete (see disassemble()).
+ * =============================================================================
+ */
+void build_xref(disass_context *ctx, xref_index *xref)
+{
+    unsigned char   kinds[256];
+    unsigned char   *found;
+    unsigned char   *record;
+    int             *starts;
+    int             count       = 0;
+    int             pc          = ctx->pc_start;
+    int             target;
+    int             i;
+
+    for (i = 0; i < 256; i++)
+    {
+        kinds[i] = is_in_mode(ctx, i) ? access_kind(&opcodes[i]) : 0;
+    }
+
+    if (ctx->basic_end > ctx->pc_start)
+    {
+        pc = ctx->basic_end;
+    }
+
+    // at most one reference per byte
+    found = malloc((ctx->pc_end - pc + 1) * XREF_RECORD);
+    starts = calloc(0x10001, sizeof(int));
+    if (found == NULL || starts == NULL)
+    {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (pc < ctx->pc_end)
+    {
+        i = pc - ctx->pc_start;
+
+        if (!is_in_mode(ctx, ctx->assembly.data[i]) || get_datatype(ctx, pc) == DATATYPE_DATA)
+        {
+            pc++;
+            continue;
+        }
+
+        if (kinds[ctx->assembly.data[i]] != 0)
+        {
+            switch (opcodes[ctx->assembly.data[i]].addressing_mode)
+            {
+            case REL:
+                target = (pc + 2 + (signed char)get_byte(ctx, i+1)) & 0xFFFF;
+                break;
+            case ABS:
+            case ABSI:
+            case ABSX:
+            case ABSY:
+                target = get_byte(ctx, i+1) + (get_byte(ctx, i+2) << 8);
+                break;
+            default:
+                target = get_byte(ctx, i+1);
+                break;
+            }
+
+            record = found + count * XREF_RECORD;
+            record[0] = target & 0xFF;
+            record[1] = target >> 8;
+            record[2] = pc & 0xFF;
+            record[3] = pc >> 8;
+            record[4] = kinds[ctx->assembly.data[i]];
+            starts[target + 1]++;
+            count++;
+        }
+
+        pc += opcodes[ctx->assembly.data[i]].bytes;
+    }
+
+    for (i = 1; i <= 0x10000; i++)
+    {
+        starts[i] += starts[i - 1];
+    }
+
+    if (count > xref->size)
+    {
+        xref->size = count;
+        xref->records = realloc(xref->records, count * XREF_RECORD);
+        if (xref->records == NULL)
+        {
+            fprintf(stderr, "Error: out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    xref->count = count;
+
+    for (i = 0; i < count; i++)
+    {
+        record = found + i * XREF_RECORD;
+        target = record[0] | (record[1] << 8);
+        memcpy(xref->records + starts[target]++ * XREF_RECORD, record, XREF_RECORD);
+    }
+
+    free(starts);
+    free(found);
+}
+
+/* =============================================================================
+ * int find_xref(const xref_index *xref, int target)
+ *
+ * return i; // first record with a target >= target, xref->count if none
+ * =============================================================================
+ */
+int find_xref(const xref_index *xref, int target)
+{
+    int     low     = 0;
+    int     high    = xref->count;
+    int     middle;
+
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (xref_target(xref, middle) < target)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/* =============================================================================
+ * void free_xref(xref_index *xref)
+ * =============================================================================
+ */
+void free_xref(xref_index *xref)
+{
+    if (xref->size > 0)
+    {
+        free(xref->records);
+    }
+    else if (xref->records != NULL)
+    {
+        unmap_file(&xref->file);
+    }
+
+    memset(xref, 0, sizeof(xref_index));
+}
+
+/* =============================================================================
+ * int load_xref(xref_index *xref, const char *filename)
+ *
+ * return 0;  // on success
+ * return -1; // if filename couldn't be read or isn't an index file
+ *
+ * map an index written by save_xref(), free it with free_xref()
+ * =============================================================================
+ */
+int load_xref(xref_index *xref, const char *filename)
+{
+    const unsigned char *data;
+    long                count;
+
+    memset(xref, 0, sizeof(xref_index));
+
+    if (map_file(&xref->file, filename) != 0)
+    {
+        return -1;
+    }
+
+    data = xref->file.data;
+    if (xref->file.size < XREF_HEADER || memcmp(data, XREF_MAGIC, 8) != 0)
+    {
+        unmap_file(&xref->file);
+        return -1;
+    }
+
+    count = data[8] | (data[9] << 8) | (data[10] << 16) | ((long)data[11] << 24);
+    if (xref->file.size != XREF_HEADER + (size_t)count * XREF_RECORD)
+    {
+        unmap_file(&xref->file);
+        return -1;
+    }
+
+    // never written through, size stays 0
+    xref->records = (unsigned char *)data + XREF_HEADER;
+    xref->count = count;
+
+    return 0;
+}
+
+/* =============================================================================
+ * int save_xref(const xref_index *xref, const char *filename)
+ *
+ * return 0;  // on success
+ * return -1; // if filename couldn't be written
+ * =============================================================================
+ */
+int save_xref(const xref_index *xref, const char *filename)
+{
+    FILE            *file;
+    unsigned char   header[XREF_HEADER];
+    int             i;
+    int             result;
+
+    memcpy(header, XREF_MAGIC, 8);
+    for (i = 0; i < 4; i++)
+    {
+        header[8 + i] = (xref->count >> (i * 8)) & 0xFF;
+    }
+
+    file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    result = (fwrite(header, XREF_HEADER, 1, file) == 1
+        && (xref->count == 0 || fwrite(xref->records, XREF_RECORD, xref->count, file) == (size_t)xref->count))
+        ? 0 : -1;
+
+    if (fclose(file) != 0)
+    {
+        result = -1;
+    }
+
+    return result;
+}
@@ -0,0 +1,57 @@
+#ifndef XREF_H_
+#define XREF_H_
+
+#include "disass.h"
+#include "input.h"
+
+#define XREF_RECORD     5           // target, pc (lo first) and kind
+
+enum {
+    XREF_READ   = 1,
+    XREF_WRITE  = 2,
+    XREF_JUMP   = 4,
+    XREF_CALL   = 8
+}; // kinds of reference, read-modify-write instructions are XREF_READ | XREF_WRITE
+
+/* every address referenced by the code of one file and who references it,
+ * see build_xref(). the records are sorted by target, then pc, so a lookup
+ * is a binary search. a loaded index is used straight from the mapped file.
+ */
+struct xref_index
+{
+    unsigned char   *records;       // count * XREF_RECORD bytes
+    int             count;
+    int             size;           // allocated records, 0 if loaded
+    mapped_file     file;           // see load_xref()
+};
+
+/* =============================================================================
+ * int xref_target(const xref_index *xref, int i)
+ * int xref_pc(const xref_index *xref, int i)
+ * int xref_kind(const xref_index *xref, int i)
+ *
+ * the fields of record i
+ * =============================================================================
+ */
+static inline int xref_target(const xref_index *xref, int i)
+{
+    return xref->records[i * XREF_RECORD] | (xref->records[i * XREF_RECORD + 1] << 8);
+}
+
+static inline int xref_pc(const xref_index *xref, int i)
+{
+    return xref->records[i * XREF_RECORD + 2] | (xref->records[i * XREF_RECORD + 3] << 8);
+}
+
+static inline int xref_kind(const xref_index *xref, int i)
+{
+    return xref->records[i * XREF_RECORD + 4];
+}
+
+void build_xref(disass_context *ctx, xref_index *xref);
+int find_xref(const xref_index *xref, int target);
+void free_xref(xref_index *xref);
+int load_xref(xref_index *xref, const char *filename);
+int save_xref(const xref_index *xref, const char *filename);
+
+#endif // XREF_H_